@@ -25,20 +25,21 @@ static struct APIHandlerRegistrar {
 
 std::unique_ptr<reply> APIHandler::handle_request(const request& request) {
   // Parse the URI to get the entity type and ID if it's a part of the request
-  std::string entity_type, id;
-  if (!ParseUri(request.uri, entity_type, id)) {
+  std::string_view entity_type_view, id_view;
+  if (!ParseUri(request, entity_type_view, id_view)) {
     return BuildResponse(reply::bad_request, "Invalid API request URI");
   }
+  std::string entity_type(entity_type_view), id(id_view);
   
   // Routes the HTTP method in request
   if (request.method == "POST" && !entity_type.empty() && id.empty()) {
-    return HandleCreate(entity_type, request.body);
+    return HandleCreate(entity_type, std::string(request.body));
   } 
   else if (request.method == "GET" && !entity_type.empty() && !id.empty()) {
     return HandleRetrieve(entity_type, id);
   }
   else if (request.method == "PUT" && !entity_type.empty() && !id.empty()) {
-    return HandleUpdate(entity_type, id, request.body);
+    return HandleUpdate(entity_type, id, std::string(request.body));
   }
   else if (request.method == "DELETE" && !entity_type.empty() && !id.empty()) {
     return HandleDelete(entity_type, id);
@@ -51,21 +52,37 @@ std::unique_ptr<reply> APIHandler::handle_request(const request& request) {
   return BuildResponse(reply::not_found, "404 Not Found");
 }
 
-bool APIHandler::ParseUri(const std::string& uri, std::string& entity_type, std::string& id) {
-  if (uri.compare(0, path_prefix_.length(), path_prefix_) != 0) {
-    return false;
+bool APIHandler::ParseUri(const request& request, std::string_view& entity_type, std::string_view& id) {
+  std::string_view path;
+  if (request.route.matched()) {
+    // The router already knows where the location ends
+    path = request.path_remainder();
+  } else {
+    std::string_view uri = request.uri;
+    if (uri.compare(0, path_prefix_.length(), path_prefix_) != 0) {
+      return false;
+    }
+    path = uri.substr(path_prefix_.length());
   }
-  
-  std::string path = uri.substr(path_prefix_.length());
   if (!path.empty() && path[0] == '/') {
-    path = path.substr(1);
+    path.remove_prefix(1);
+  }
+
+  // A location like "/api/{entity}" or "/api/{entity}/{id}" captures them
+  entity_type = request.path_param("entity");
+  if (!entity_type.empty()) {
+    id = request.path_param("id");
+    if (id.empty()) {
+      id = path;
+    }
+    return true;
   }
   
   // Gets entity type and id if it exists
   size_t slash_pos = path.find('/');
-  if (slash_pos == std::string::npos) {
+  if (slash_pos == std::string_view::npos) {
     entity_type = path;
-    id = "";
+    id = std::string_view();
   } else {
     entity_type = path.substr(0, slash_pos);
     id = path.substr(slash_pos + 1);
@@ -2,6 +2,7 @@
 #define API_HANDLER_H
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <boost/json.hpp>
 #include "request_handler.hpp"
@@ -38,13 +39,16 @@ public:
 
   // Main request handler
   std::unique_ptr<reply> handle_request(const request& request) override;
+  bool is_reusable() const override { return true; }
 
 private:
   std::string path_prefix_;
   std::unique_ptr<EntityProcessor> entity_processor_;
   
   // Helper methods
-  bool ParseUri(const std::string& uri, std::string& entity_type, std::string& id);
+  // Splits the path after the location into entity type and id, unless the
+  // location captures them as {entity} and {id}
+  bool ParseUri(const request& request, std::string_view& entity_type, std::string_view& id);
   bool IsValidJson(const std::string& json_data);
   
   // Request handlers for different CRUD operations
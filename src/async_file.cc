@@ -0,0 +1,31 @@
+#include "async_file.h"
+
+#ifdef HTTP_HAS_ASYNC_FILE
+#include <boost/asio/random_access_file.hpp>
+#include <boost/asio/read_at.hpp>
+#include <unistd.h>
+#endif
+
+namespace http {
+namespace server {
+
+#ifdef HTTP_HAS_ASYNC_FILE
+boost::asio::awaitable<bool> async_read_file(int fd, std::size_t offset, char* out,
+                                             std::size_t size) {
+  // The file object closes its descriptor, so it gets a copy of ours
+  int own_fd = ::dup(fd);
+  if (own_fd < 0) {
+    co_return false;
+  }
+  boost::asio::random_access_file file(co_await boost::asio::this_coro::executor, own_fd);
+
+  boost::system::error_code ec;
+  std::size_t count = co_await boost::asio::async_read_at(file, offset,
+      boost::asio::buffer(out, size),
+      boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+  co_return !ec && count == size;
+}
+#endif
+
+} // namespace server
+} // namespace http
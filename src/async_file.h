@@ -0,0 +1,36 @@
+#ifndef HTTP_ASYNC_FILE_H
+#define HTTP_ASYNC_FILE_H
+
+#include <boost/asio.hpp>
+#include <cstddef>
+
+// Asio runs on io_uring instead of epoll when the whole server is built with
+// BOOST_ASIO_HAS_IO_URING and BOOST_ASIO_DISABLE_EPOLL defined and linked
+// against liburing (Boost 1.78 or later). That backend also provides file
+// handles whose reads are real asynchronous operations.
+#if defined(BOOST_ASIO_HAS_FILE)
+#define HTTP_HAS_ASYNC_FILE 1
+#endif
+
+namespace http {
+namespace server {
+
+// The reactor asio was built with, for the startup log
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+constexpr const char* io_backend = "io_uring";
+#else
+constexpr const char* io_backend = "epoll";
+#endif
+
+#ifdef HTTP_HAS_ASYNC_FILE
+// Reads size bytes at offset of the open file fd into out, suspending the
+// coroutine rather than blocking its thread while the kernel fetches them.
+// fd stays owned by the caller. Returns false on an error or a short file.
+boost::asio::awaitable<bool> async_read_file(int fd, std::size_t offset, char* out,
+                                             std::size_t size);
+#endif
+
+} // namespace server
+} // namespace http
+
+#endif // HTTP_ASYNC_FILE_H
@@ -0,0 +1,24 @@
+#include "blocking_handler.h"
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+namespace http {
+namespace server {
+
+BlockingRequestHandler::BlockingRequestHandler(std::unique_ptr<RequestHandler> handler,
+                                               std::shared_ptr<boost::asio::thread_pool> pool)
+  : handler_(std::move(handler)), pool_(std::move(pool)) {
+}
+
+boost::asio::awaitable<std::unique_ptr<reply>> BlockingRequestHandler::handle_request_async(const request& request) {
+  // The inner coroutine runs on a pool thread; awaiting it resumes this one
+  // on the connection's strand, with any exception rethrown here
+  co_return co_await boost::asio::co_spawn(pool_->get_executor(),
+      [this, &request]() -> boost::asio::awaitable<std::unique_ptr<reply>> {
+        co_return handler_->handle_request(request);
+      },
+      boost::asio::use_awaitable);
+}
+
+} // namespace server
+} // namespace http
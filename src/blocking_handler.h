@@ -0,0 +1,41 @@
+#ifndef HTTP_BLOCKING_HANDLER_HPP
+#define HTTP_BLOCKING_HANDLER_HPP
+
+#include "request_handler.hpp"
+#include <boost/asio/thread_pool.hpp>
+#include <memory>
+
+namespace http {
+namespace server {
+
+// Runs a synchronous handler on the blocking thread pool instead of an io
+// thread. Locations marked "blocking on;" are wrapped in this, so a handler
+// that shells out, touches the disk or waits on SQLite only occupies one of
+// the pool's threads while cheap endpoints keep being served. The reply is
+// posted back to the connection's strand.
+class BlockingRequestHandler : public AsyncRequestHandler {
+public:
+  BlockingRequestHandler(std::unique_ptr<RequestHandler> handler,
+                         std::shared_ptr<boost::asio::thread_pool> pool);
+
+  boost::asio::awaitable<std::unique_ptr<reply>> handle_request_async(const request& request) override;
+  bool is_reusable() const override { return handler_->is_reusable(); }
+
+  // Streamed bodies arrive piece by piece on the io thread, so the hooks
+  // are called inline; only the requests without a body go to the pool
+  bool streams_body() const override { return handler_->streams_body(); }
+  std::unique_ptr<reply> on_headers(const request_view& request) override {
+    return handler_->on_headers(request);
+  }
+  void on_body_chunk(std::string_view chunk) override { handler_->on_body_chunk(chunk); }
+  std::unique_ptr<reply> on_complete() override { return handler_->on_complete(); }
+
+private:
+  std::unique_ptr<RequestHandler> handler_;
+  std::shared_ptr<boost::asio::thread_pool> pool_;
+};
+
+} // namespace server
+} // namespace http
+
+#endif // HTTP_BLOCKING_HANDLER_HPP
@@ -0,0 +1,104 @@
+#include "body_source.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace http {
+namespace server {
+
+string_body::string_body(std::string content)
+  : content_(std::move(content)) {
+}
+
+std::optional<std::size_t> string_body::size() const {
+  return content_.size();
+}
+
+std::size_t string_body::read(char* out, std::size_t capacity) {
+  std::size_t count = std::min(capacity, content_.size() - offset_);
+  std::memcpy(out, content_.data() + offset_, count);
+  offset_ += count;
+  return count;
+}
+
+file_body::file_body(int fd, std::size_t offset, std::size_t length)
+  : fd_(fd), offset_(offset), remaining_(length), length_(length) {
+}
+
+file_body::~file_body() {
+  ::close(fd_);
+}
+
+std::unique_ptr<file_body> file_body::open(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    ::close(fd);
+    return nullptr;
+  }
+  return std::unique_ptr<file_body>(new file_body(fd, 0, info.st_size));
+}
+
+std::unique_ptr<file_body> file_body::open(const std::string& path,
+                                           std::size_t offset, std::size_t length) {
+  std::unique_ptr<file_body> body = open(path);
+  if (!body || offset > body->length_ || length > body->length_ - offset) {
+    return nullptr;
+  }
+  body->offset_ = offset;
+  body->remaining_ = body->length_ = length;
+  return body;
+}
+
+std::optional<std::size_t> file_body::size() const {
+  return length_;
+}
+
+std::size_t file_body::read(char* out, std::size_t capacity) {
+  if (remaining_ == 0) {
+    return 0;
+  }
+  ssize_t count;
+  do {
+    count = ::pread(fd_, out, std::min(capacity, remaining_), offset_);
+  } while (count < 0 && errno == EINTR);
+  if (count <= 0) {
+    // Truncated under us; the promised Content-Length can no longer be met
+    throw std::runtime_error(count < 0 ? std::strerror(errno) : "file shrank while being sent");
+  }
+  offset_ += count;
+  remaining_ -= count;
+  return count;
+}
+
+std::optional<body_source::file_range> file_body::file() const {
+  return file_range{fd_, offset_, remaining_};
+}
+
+void file_body::consume(std::size_t count) {
+  count = std::min(count, remaining_);
+  offset_ += count;
+  remaining_ -= count;
+}
+
+generator_body::generator_body(generator next)
+  : next_(std::move(next)) {
+}
+
+std::optional<std::size_t> generator_body::size() const {
+  return std::nullopt;
+}
+
+std::size_t generator_body::read(char* out, std::size_t capacity) {
+  return next_(out, capacity);
+}
+
+} // namespace server
+} // namespace http
@@ -0,0 +1,102 @@
+#ifndef HTTP_BODY_SOURCE_H
+#define HTTP_BODY_SOURCE_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace http {
+namespace server {
+
+// Where a reply's body comes from when it is not held in reply::content.
+// The session pulls the body through its output buffer as the client
+// accepts it, so however large the body, only one buffer of it is in
+// memory at a time.
+class body_source {
+public:
+  virtual ~body_source() = default;
+
+  // Length of the whole body, or nullopt if it is only known once read()
+  // returns 0. HTTP/1.1 replies of unknown length are sent chunked.
+  virtual std::optional<std::size_t> size() const = 0;
+
+  // Copies up to capacity of the next bytes to out and returns how many;
+  // 0 means the body is complete. Throws std::runtime_error if the body
+  // cannot be produced, which ends the connection mid-reply.
+  virtual std::size_t read(char* out, std::size_t capacity) = 0;
+
+  // The part of a file that holds the rest of the body, for bodies backed
+  // by one. The session then has the kernel copy it straight to the socket
+  // with sendfile(2), and calls consume() for what was sent, instead of
+  // pulling it through read().
+  struct file_range {
+    int fd;
+    std::size_t offset;
+    std::size_t length;
+  };
+  virtual std::optional<file_range> file() const { return std::nullopt; }
+
+  // Marks the next count bytes of file() as sent
+  virtual void consume(std::size_t count) {}
+};
+
+// A body built in memory but kept out of the reply's arena, such as a large
+// rendered document handed over without copying
+class string_body : public body_source {
+public:
+  explicit string_body(std::string content);
+
+  std::optional<std::size_t> size() const override;
+  std::size_t read(char* out, std::size_t capacity) override;
+
+private:
+  std::string content_;
+  std::size_t offset_ = 0;
+};
+
+// length bytes of a file starting at offset. The file is opened when the
+// body is created, so a missing file can still get a 404.
+class file_body : public body_source {
+public:
+  ~file_body() override;
+
+  // Returns nullptr if path cannot be opened as a regular file
+  static std::unique_ptr<file_body> open(const std::string& path);
+  static std::unique_ptr<file_body> open(const std::string& path,
+                                         std::size_t offset, std::size_t length);
+
+  std::optional<std::size_t> size() const override;
+  std::size_t read(char* out, std::size_t capacity) override;
+  std::optional<file_range> file() const override;
+  void consume(std::size_t count) override;
+
+private:
+  file_body(int fd, std::size_t offset, std::size_t length);
+
+  int fd_;
+  std::size_t offset_;
+  std::size_t remaining_;
+  std::size_t length_;
+};
+
+// A body produced on demand by a function with read()'s signature, for
+// output whose length is not known up front
+class generator_body : public body_source {
+public:
+  typedef std::function<std::size_t(char* out, std::size_t capacity)> generator;
+
+  explicit generator_body(generator next);
+
+  std::optional<std::size_t> size() const override;
+  std::size_t read(char* out, std::size_t capacity) override;
+
+private:
+  generator next_;
+};
+
+} // namespace server
+} // namespace http
+
+#endif // HTTP_BODY_SOURCE_H
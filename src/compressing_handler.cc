@@ -0,0 +1,54 @@
+#include "compressing_handler.h"
+#include "compression.h"
+
+namespace http {
+namespace server {
+
+namespace {
+
+// The first Accept-Encoding header of a request or request_view
+template <typename Request>
+std::string_view accept_encoding(const Request& request) {
+  const auto* h = request.find_header(known_header::accept_encoding);
+  return h ? std::string_view(h->value) : std::string_view();
+}
+
+} // namespace
+
+CompressingRequestHandler::CompressingRequestHandler(std::unique_ptr<RequestHandler> handler,
+                                                     const CompressionOptions& options)
+  : handler_(std::move(handler)), options_(options) {
+}
+
+std::unique_ptr<reply> CompressingRequestHandler::handle_request(const request& request) {
+  return compress(handler_->handle_request(request), accept_encoding(request));
+}
+
+std::unique_ptr<reply> CompressingRequestHandler::handle_request_view(const request_view& request) {
+  return compress(handler_->handle_request_view(request), accept_encoding(request));
+}
+
+boost::asio::awaitable<std::unique_ptr<reply>> CompressingRequestHandler::handle_request_async(const request& request) {
+  std::unique_ptr<reply> rep = co_await handler_->handle_request_async(request);
+  co_return compress(std::move(rep), accept_encoding(request));
+}
+
+std::unique_ptr<reply> CompressingRequestHandler::on_headers(const request_view& request) {
+  accept_encoding_ = accept_encoding(request);
+  return compress(handler_->on_headers(request), accept_encoding_);
+}
+
+std::unique_ptr<reply> CompressingRequestHandler::on_complete() {
+  return compress(handler_->on_complete(), accept_encoding_);
+}
+
+std::unique_ptr<reply> CompressingRequestHandler::compress(std::unique_ptr<reply> rep,
+                                                           std::string_view accept_encoding) {
+  if (rep) {
+    compress_reply(*rep, accept_encoding, options_);
+  }
+  return rep;
+}
+
+} // namespace server
+} // namespace http
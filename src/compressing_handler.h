@@ -0,0 +1,48 @@
+#ifndef HTTP_COMPRESSING_HANDLER_HPP
+#define HTTP_COMPRESSING_HANDLER_HPP
+
+#include "config_parser.h"
+#include "request_handler.hpp"
+#include <memory>
+#include <string>
+
+namespace http {
+namespace server {
+
+// Compresses the replies of another handler according to the request's
+// Accept-Encoding. Locations with "gzip on;" are wrapped in this; every
+// other call, including the streaming body hooks, goes straight through,
+// so the wrapped handler behaves exactly as it would unwrapped.
+class CompressingRequestHandler : public RequestHandler {
+public:
+  // options must outlive the handler; the registry's copy does
+  CompressingRequestHandler(std::unique_ptr<RequestHandler> handler,
+                            const CompressionOptions& options);
+
+  std::unique_ptr<reply> handle_request(const request& request) override;
+  std::unique_ptr<reply> handle_request_view(const request_view& request) override;
+
+  bool is_async() const override { return handler_->is_async(); }
+  // A streamed body keeps the request's Accept-Encoding between calls
+  bool is_reusable() const override { return !streams_body() && handler_->is_reusable(); }
+  boost::asio::awaitable<std::unique_ptr<reply>> handle_request_async(const request& request) override;
+
+  bool streams_body() const override { return handler_->streams_body(); }
+  std::unique_ptr<reply> on_headers(const request_view& request) override;
+  void on_body_chunk(std::string_view chunk) override { handler_->on_body_chunk(chunk); }
+  std::unique_ptr<reply> on_complete() override;
+
+private:
+  std::unique_ptr<reply> compress(std::unique_ptr<reply> rep, std::string_view accept_encoding);
+
+  std::unique_ptr<RequestHandler> handler_;
+  const CompressionOptions& options_;
+
+  // Kept from on_headers() for on_complete(), when the request is gone
+  std::string accept_encoding_;
+};
+
+} // namespace server
+} // namespace http
+
+#endif // HTTP_COMPRESSING_HANDLER_HPP
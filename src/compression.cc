@@ -0,0 +1,195 @@
+#include "compression.h"
+#include <algorithm>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <zlib.h>
+
+namespace http {
+namespace server {
+
+namespace {
+
+// The q-value of one Accept-Encoding element, e.g. "gzip;q=0.5"; 1 if absent
+double quality(std::string_view params) {
+  while (!params.empty()) {
+    size_t end = params.find(';');
+    std::string param(boost::algorithm::trim_copy(std::string(params.substr(0, end))));
+    if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+      return std::strtod(param.c_str() + 2, nullptr);
+    }
+    params = end == std::string_view::npos ? std::string_view() : params.substr(end + 1);
+  }
+  return 1.0;
+}
+
+// The first header named name in headers, a reply's or a prebuilt response's
+template <typename Headers>
+auto find_header(Headers& headers, std::string_view name) -> decltype(&*headers.begin()) {
+  for (auto& h : headers) {
+    if (boost::algorithm::iequals(h.name, name)) {
+      return &h;
+    }
+  }
+  return nullptr;
+}
+
+template <typename Headers>
+bool compressible_type(const Headers& headers, const CompressionOptions& options) {
+  std::string type;
+  if (const header* h = find_header(headers, "Content-Type")) {
+    type = boost::algorithm::trim_copy(std::string(h->value.substr(0, h->value.find(';'))));
+  }
+  std::transform(type.begin(), type.end(), type.begin(), ::tolower);
+  return std::any_of(options.types.begin(), options.types.end(),
+      [&type](const std::string& allowed) { return allowed == "*" || allowed == type; });
+}
+
+// Whether a body of size bytes with these headers may be compressed at all
+template <typename Headers>
+bool eligible(const Headers& headers, size_t size, const CompressionOptions& options) {
+  return size >= options.min_length && !find_header(headers, "Content-Encoding") &&
+         compressible_type(headers, options);
+}
+
+// Compresses content with zlib into out; windowBits 31 writes a gzip
+// wrapper and 15 a zlib one, which is what HTTP calls deflate
+bool deflate_content(std::string_view content, content_coding coding, int level,
+                     std::pmr::string& out) {
+  z_stream stream{};
+  int window_bits = coding == content_coding::gzip ? 15 + 16 : 15;
+  if (deflateInit2(&stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  out.resize(deflateBound(&stream, content.size()));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(content.data()));
+  stream.avail_in = content.size();
+  stream.next_out = reinterpret_cast<Bytef*>(out.data());
+  stream.avail_out = out.size();
+  int result = deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return result == Z_STREAM_END;
+}
+
+void add_vary(reply& rep) {
+  if (header* vary = find_header(rep.headers, "Vary")) {
+    if (vary->value != "*" && !boost::algorithm::icontains(vary->value, "Accept-Encoding")) {
+      vary->value += ", Accept-Encoding";
+    }
+  } else {
+    rep.headers.push_back({"Vary", "Accept-Encoding"});
+  }
+}
+
+// Replaces rep's content with its compressed form, unless that would not
+// be smaller
+bool compress_content(reply& rep, content_coding coding, int level) {
+  std::pmr::string compressed(rep.get_allocator());
+  if (!deflate_content(rep.content, coding, level, compressed) ||
+      compressed.size() >= rep.content.size()) {
+    return false;
+  }
+  rep.content = std::move(compressed);
+
+  if (header* length = find_header(rep.headers, "Content-Length")) {
+    length->value = std::to_string(rep.content.size());
+  } else {
+    rep.headers.push_back({"Content-Length", std::to_string(rep.content.size())});
+  }
+  rep.headers.push_back({"Content-Encoding", coding == content_coding::gzip ? "gzip" : "deflate"});
+  return true;
+}
+
+// A prebuilt reply is switched to a variant of its response, built the
+// first time it is needed, so each request only picks the right bytes.
+// Variants are keyed by coding and level; one with no coding is the
+// response plus Vary, sent when the client takes no coding or compressing
+// does not help.
+bool compress_prebuilt(reply& rep, std::string_view accept_encoding,
+                       const CompressionOptions& options) {
+  const prebuilt_response& response = *rep.prebuilt;
+  if (!eligible(response.headers(), response.content().size(), options)) {
+    return false;
+  }
+
+  auto derive = [&rep](const std::function<bool(reply&)>& change) {
+    reply derived;
+    derived.prebuilt = rep.prebuilt;
+    derived.expand();
+    add_vary(derived);
+    return change(derived) ? std::make_shared<const prebuilt_response>(derived) : nullptr;
+  };
+
+  content_coding coding = negotiate_coding(accept_encoding);
+  std::shared_ptr<const prebuilt_response> variant;
+  if (coding != content_coding::identity) {
+    int key = static_cast<int>(coding) * 16 + options.level;
+    variant = response.variant(key, [&] {
+      return derive([&](reply& r) { return compress_content(r, coding, options.level); });
+    });
+  }
+  bool compressed = variant != nullptr;
+  if (!compressed) {
+    variant = response.variant(0, [&] { return derive([](reply&) { return true; }); });
+  }
+  rep.prebuilt = std::move(variant);
+  return compressed;
+}
+
+} // namespace
+
+content_coding negotiate_coding(std::string_view accept_encoding) {
+  double gzip = -1, deflate = -1, any = -1;
+  while (!accept_encoding.empty()) {
+    size_t end = accept_encoding.find(',');
+    std::string_view element = accept_encoding.substr(0, end);
+    accept_encoding = end == std::string_view::npos ? std::string_view()
+                                                    : accept_encoding.substr(end + 1);
+
+    size_t params = element.find(';');
+    std::string name(boost::algorithm::trim_copy(std::string(element.substr(0, params))));
+    double q = params == std::string_view::npos ? 1.0 : quality(element.substr(params + 1));
+    if (boost::algorithm::iequals(name, "gzip") || boost::algorithm::iequals(name, "x-gzip")) {
+      gzip = q;
+    } else if (boost::algorithm::iequals(name, "deflate")) {
+      deflate = q;
+    } else if (name == "*") {
+      any = q;
+    }
+  }
+
+  // Codings not named explicitly take the q-value of "*", if any
+  if (gzip < 0) gzip = any;
+  if (deflate < 0) deflate = any;
+  if (gzip > 0 && gzip >= deflate) {
+    return content_coding::gzip;
+  }
+  if (deflate > 0) {
+    return content_coding::deflate;
+  }
+  return content_coding::identity;
+}
+
+bool compress_reply(reply& rep, std::string_view accept_encoding,
+                    const CompressionOptions& options) {
+  if (rep.prebuilt) {
+    return compress_prebuilt(rep, accept_encoding, options);
+  }
+  if (rep.body || !eligible(rep.headers, rep.content.size(), options)) {
+    return false;
+  }
+
+  add_vary(rep);
+  content_coding coding = negotiate_coding(accept_encoding);
+  if (coding == content_coding::identity) {
+    return false;
+  }
+  return compress_content(rep, coding, options.level);
+}
+
+} // namespace server
+} // namespace http
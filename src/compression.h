@@ -0,0 +1,33 @@
+#ifndef HTTP_COMPRESSION_H
+#define HTTP_COMPRESSION_H
+
+#include "config_parser.h"
+#include "reply.hpp"
+#include <string_view>
+
+namespace http {
+namespace server {
+
+enum class content_coding { identity, gzip, deflate };
+
+// Picks the coding to answer a request with from its Accept-Encoding value.
+// gzip is preferred over deflate at equal q-values; a coding with q=0, or
+// one only matched by a "*;q=0", is never chosen.
+content_coding negotiate_coding(std::string_view accept_encoding);
+
+// Compresses rep's content in place with zlib when options allow it:
+// the content is held in memory (not streamed from a body source), at least
+// options.min_length long, of a listed Content-Type and not already encoded.
+// Such a reply also gets "Vary: Accept-Encoding", since its body depends on
+// that header whether or not this client accepts a compressed one. Content-
+// Length and Content-Encoding are updated. Returns true if rep was
+// compressed; a body that would not shrink is left alone. A prebuilt reply
+// is checked against its response's headers and, if eligible, pointed at a
+// variant of that response that is compressed once and then shared.
+bool compress_reply(reply& rep, std::string_view accept_encoding,
+                    const CompressionOptions& options);
+
+} // namespace server
+} // namespace http
+
+#endif // HTTP_COMPRESSION_H
@@ -1,12 +1,17 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <stack>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "config_parser.h"
+#include "router.h"
 
 // Helper function to find a token value in the configuration
 std::string NginxConfig::FindConfigToken(const std::string& token_name) const {
@@ -30,12 +35,258 @@ std::string NginxConfig::FindConfigToken(const std::string& token_name) const {
   return "";
 }
 
+// Helper function to find a token value outside of any location block
+std::string NginxConfig::FindServerToken(const std::string& token_name) const {
+  for (const auto& statement : statements_) {
+    if (statement->tokens_.size() >= 2 && statement->tokens_[0] == token_name) {
+      return statement->tokens_[1];
+    }
+  }
+
+  return "";
+}
+
 // Gets port number from config file
 bool NginxConfig::ExtractPort(std::string& port_num) {
   port_num = FindConfigToken("port");
   return !port_num.empty();
 }
 
+// Parses a size such as "512", "8k" or "16m" into bytes
+static bool ParseSize(const std::string& value, size_t& size) {
+  if (value.empty()) {
+    return false;
+  }
+
+  size_t multiplier = 1;
+  std::string digits = value;
+  char suffix = std::tolower(value.back());
+  if (suffix == 'k') {
+    multiplier = 1024;
+    digits.pop_back();
+  } else if (suffix == 'm') {
+    multiplier = 1024 * 1024;
+    digits.pop_back();
+  }
+
+  if (digits.empty() || !std::all_of(digits.begin(), digits.end(), ::isdigit)) {
+    return false;
+  }
+  unsigned long long value_before_suffix;
+  try {
+    value_before_suffix = std::stoull(digits);
+  } catch (const std::exception& e) {
+    return false;
+  }
+  if (value_before_suffix > SIZE_MAX / multiplier) {
+    return false;
+  }
+  size = value_before_suffix * multiplier;
+  return true;
+}
+
+// Reads an optional size directive into size; returns false if it is malformed
+static bool ExtractSize(const NginxConfig& config, const std::string& token_name, size_t& size) {
+  std::string value = config.FindServerToken(token_name);
+  if (value.empty()) {
+    return true;
+  }
+  if (!ParseSize(value, size) || size == 0) {
+    std::cerr << "Error: Invalid size '" << value << "' for " << token_name << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Reads an optional non-negative count directive; returns false if it is malformed
+static bool ExtractCount(const NginxConfig& config, const std::string& token_name, size_t& count) {
+  std::string value = config.FindServerToken(token_name);
+  if (value.empty()) {
+    return true;
+  }
+  if (!std::all_of(value.begin(), value.end(), ::isdigit)) {
+    std::cerr << "Error: Invalid value '" << value << "' for " << token_name << std::endl;
+    return false;
+  }
+  try {
+    count = std::stoull(value);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: Invalid value '" << value << "' for " << token_name << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Parses a duration such as "30", "30s", "500ms" or "2m"; plain numbers are seconds
+static bool ParseDuration(const std::string& value, std::chrono::milliseconds& duration) {
+  std::string digits = value;
+  long long multiplier = 1000;
+  if (digits.size() > 2 && digits.compare(digits.size() - 2, 2, "ms") == 0) {
+    multiplier = 1;
+    digits.resize(digits.size() - 2);
+  } else if (!digits.empty() && digits.back() == 's') {
+    digits.pop_back();
+  } else if (!digits.empty() && digits.back() == 'm') {
+    multiplier = 60 * 1000;
+    digits.pop_back();
+  }
+
+  if (digits.empty() || !std::all_of(digits.begin(), digits.end(), ::isdigit)) {
+    return false;
+  }
+  try {
+    duration = std::chrono::milliseconds(std::stoll(digits) * multiplier);
+  } catch (const std::exception& e) {
+    return false;
+  }
+  return true;
+}
+
+// Reads an optional timeout directive into duration; returns false if it is malformed
+static bool ExtractDuration(const NginxConfig& config, const std::string& token_name,
+                            std::chrono::milliseconds& duration) {
+  std::string value = config.FindServerToken(token_name);
+  if (value.empty()) {
+    return true;
+  }
+  if (!ParseDuration(value, duration)) {
+    std::cerr << "Error: Invalid timeout '" << value << "' for " << token_name << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Gets server-wide options from config file
+bool NginxConfig::ExtractServerOptions(ServerOptions& options) const {
+  std::string threads = FindServerToken("threads");
+  if (threads == "auto") {
+    options.thread_count = std::max(1u, std::thread::hardware_concurrency());
+  } else if (!threads.empty()) {
+    try {
+      options.thread_count = std::stoi(threads);
+    } catch (const std::exception& e) {
+      std::cerr << "Error: Invalid thread count '" << threads << "'" << std::endl;
+      return false;
+    }
+    if (options.thread_count < 1) {
+      std::cerr << "Error: Thread count must be at least 1" << std::endl;
+      return false;
+    }
+  }
+
+  std::string io_model = FindServerToken("io_model");
+  if (!io_model.empty()) {
+    if (io_model != "shared" && io_model != "per_core") {
+      std::cerr << "Error: Unknown io_model '" << io_model << "'" << std::endl;
+      return false;
+    }
+    options.io_model = io_model;
+  }
+
+  std::string cpu_affinity = FindServerToken("cpu_affinity");
+  if (!cpu_affinity.empty()) {
+    if (cpu_affinity != "on" && cpu_affinity != "off") {
+      std::cerr << "Error: cpu_affinity must be 'on' or 'off'" << std::endl;
+      return false;
+    }
+    options.cpu_affinity = (cpu_affinity == "on");
+  }
+
+  std::string http2 = FindServerToken("http2");
+  if (!http2.empty()) {
+    if (http2 != "on" && http2 != "off") {
+      std::cerr << "Error: http2 must be 'on' or 'off'" << std::endl;
+      return false;
+    }
+    options.session.http2 = (http2 == "on");
+  }
+
+  std::string sendfile = FindServerToken("sendfile");
+  if (!sendfile.empty()) {
+    if (sendfile != "on" && sendfile != "off") {
+      std::cerr << "Error: sendfile must be 'on' or 'off'" << std::endl;
+      return false;
+    }
+    options.session.sendfile = (sendfile == "on");
+  }
+
+  if (!ExtractCount(*this, "max_connections", options.max_connections) ||
+      !ExtractCount(*this, "max_inflight_requests", options.max_inflight_requests) ||
+      !ExtractCount(*this, "blocking_threads", options.blocking_threads) ||
+      !ExtractCount(*this, "client_max_header_count", options.session.max_header_count)) {
+    return false;
+  }
+  if (options.blocking_threads < 1) {
+    std::cerr << "Error: blocking_threads must be at least 1" << std::endl;
+    return false;
+  }
+  if (options.session.max_header_count < 1) {
+    std::cerr << "Error: client_max_header_count must be at least 1" << std::endl;
+    return false;
+  }
+
+  if (!ExtractSize(*this, "client_header_buffer_size", options.session.header_buffer_size) ||
+      !ExtractSize(*this, "client_max_header_size", options.session.max_header_size) ||
+      !ExtractSize(*this, "client_max_body_size", options.session.max_body_size) ||
+      !ExtractSize(*this, "client_max_uri_length", options.session.max_uri_length) ||
+      !ExtractSize(*this, "client_max_header_line_size", options.session.max_header_line_size) ||
+      !ExtractSize(*this, "client_body_buffer_size", options.session.body_buffer_size) ||
+      !ExtractSize(*this, "output_buffer_size", options.session.output_buffer_size)) {
+    return false;
+  }
+  if (options.session.header_buffer_size > options.session.max_header_size) {
+    std::cerr << "Error: client_header_buffer_size exceeds client_max_header_size" << std::endl;
+    return false;
+  }
+
+  if (!ExtractDuration(*this, "client_header_timeout", options.session.header_timeout) ||
+      !ExtractDuration(*this, "keepalive_timeout", options.session.keepalive_timeout) ||
+      !ExtractDuration(*this, "send_timeout", options.session.send_timeout) ||
+      !ExtractDuration(*this, "drain_timeout", options.drain_timeout)) {
+    return false;
+  }
+
+  options.handoff_socket = FindServerToken("handoff_socket");
+
+  return true;
+}
+
+// Reads the gzip directives of a location block; returns false if one is malformed
+static bool ExtractCompressionOptions(const NginxConfig& config, CompressionOptions& options) {
+  std::string gzip = config.FindServerToken("gzip");
+  if (!gzip.empty() && gzip != "on" && gzip != "off") {
+    std::cerr << "Error: gzip must be 'on' or 'off'" << std::endl;
+    return false;
+  }
+  options.enabled = (gzip == "on");
+
+  std::string min_length = config.FindServerToken("gzip_min_length");
+  if (!min_length.empty() && !ParseSize(min_length, options.min_length)) {
+    std::cerr << "Error: Invalid size '" << min_length << "' for gzip_min_length" << std::endl;
+    return false;
+  }
+
+  std::string level = config.FindServerToken("gzip_comp_level");
+  if (!level.empty()) {
+    if (level.size() != 1 || level[0] < '1' || level[0] > '9') {
+      std::cerr << "Error: gzip_comp_level must be between 1 and 9" << std::endl;
+      return false;
+    }
+    options.level = level[0] - '0';
+  }
+
+  // Unlike the other directives this one takes a list
+  for (const auto& statement : config.statements_) {
+    if (!statement->tokens_.empty() && statement->tokens_[0] == "gzip_types") {
+      options.types.assign(statement->tokens_.begin() + 1, statement->tokens_.end());
+      for (std::string& type : options.types) {
+        std::transform(type.begin(), type.end(), type.begin(), ::tolower);
+      }
+    }
+  }
+  return true;
+}
+
 std::map<std::string, HandlerConfig> NginxConfig::ExtractHandlerConfigs() {
   std::map<std::string, HandlerConfig> handler_configs;
   
@@ -44,6 +295,13 @@ std::map<std::string, HandlerConfig> NginxConfig::ExtractHandlerConfigs() {
     if (statement->tokens_.size() >= 3 && statement->tokens_[0] == "location") {
       std::string location_path = statement->tokens_[1];
       std::string handler_type = statement->tokens_[2];
+
+      // A path with {param} segments is quoted, since '{' opens a block
+      if (location_path.length() >= 2 &&
+          (location_path.front() == '"' || location_path.front() == '\'') &&
+          location_path.back() == location_path.front()) {
+        location_path = location_path.substr(1, location_path.length() - 2);
+      }
       
       // Check for trailing slashes in the location path (prohibited)
       if (location_path.length() > 1 && location_path.back() == '/') {
@@ -51,6 +309,12 @@ std::map<std::string, HandlerConfig> NginxConfig::ExtractHandlerConfigs() {
                   << location_path << "'" << std::endl;
         continue;
       }
+
+      // The router takes whole segments only (see router.h)
+      if (!http::server::router::valid_pattern(location_path)) {
+        std::cerr << "Error: Invalid location path '" << location_path << "'" << std::endl;
+        continue;
+      }
       
       // Check for duplicate paths
       if (handler_configs.find(location_path) != handler_configs.end()) {
@@ -66,6 +330,26 @@ std::map<std::string, HandlerConfig> NginxConfig::ExtractHandlerConfigs() {
       if (statement->child_block_) {
         // Create a new NginxConfig object and copy the child_block contents
         handler_config.config = std::make_unique<NginxConfig>(*statement->child_block_);
+
+        std::string blocking = handler_config.config->FindServerToken("blocking");
+        if (!blocking.empty() && blocking != "on" && blocking != "off") {
+          std::cerr << "Error: blocking must be 'on' or 'off' in location '"
+                    << location_path << "'" << std::endl;
+          continue;
+        }
+        handler_config.blocking = (blocking == "on");
+
+        if (!ExtractCompressionOptions(*handler_config.config, handler_config.compression)) {
+          std::cerr << "Error: Invalid compression settings in location '"
+                    << location_path << "'" << std::endl;
+          continue;
+        }
+
+        if (!ExtractSize(*handler_config.config, "client_max_body_size", handler_config.max_body_size)) {
+          std::cerr << "Error: Invalid client_max_body_size in location '"
+                    << location_path << "'" << std::endl;
+          continue;
+        }
       }
       
       // Add to map - using move to avoid copy of unique_ptr
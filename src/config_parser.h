@@ -1,6 +1,7 @@
 #ifndef NGINX_CONFIG_PARSER_H
 #define NGINX_CONFIG_PARSER_H
 
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -11,9 +12,129 @@
 class NginxConfig;
 class NginxConfigStatement;
 
+// Response compression for one location, read from its block:
+//   gzip on;
+//   gzip_min_length 1k;
+//   gzip_types text/html application/json;
+//   gzip_comp_level 6;
+struct CompressionOptions {
+  // Compress replies to clients that accept gzip or deflate ("gzip on;")
+  bool enabled = false;
+
+  // Smaller bodies are sent as they are ("gzip_min_length")
+  size_t min_length = 1024;
+
+  // Content-Types worth compressing, without parameters ("gzip_types");
+  // "*" matches any type
+  std::vector<std::string> types = {"text/html", "text/plain", "text/css",
+                                    "application/javascript", "application/json"};
+
+  // zlib level from 1 (fastest) to 9 (smallest) ("gzip_comp_level")
+  int level = 6;
+};
+
 struct HandlerConfig {
   std::string type;
   std::unique_ptr<NginxConfig> config;
+
+  // Run the handler on the blocking thread pool ("blocking on;" in the
+  // location block)
+  bool blocking = false;
+
+  CompressionOptions compression;
+
+  // Largest request body for this location ("client_max_body_size" in the
+  // location block); 0 leaves the server-wide limit in force
+  size_t max_body_size = 0;
+};
+
+// Per-connection limits read from top-level directives. Sizes accept an
+// optional k or m suffix, e.g. "client_max_body_size 16m;". Timeouts are in
+// seconds unless suffixed with ms, s or m, e.g. "keepalive_timeout 75s;", and
+// 0 disables one.
+struct SessionOptions {
+  // Initial read buffer size ("client_header_buffer_size")
+  size_t header_buffer_size = 1024;
+
+  // Largest request line plus headers; the read buffer grows up to this
+  // ("client_max_header_size")
+  size_t max_header_size = 8 * 1024;
+
+  // Largest Content-Length accepted ("client_max_body_size"); a location
+  // may set its own. Larger requests get 413 before their body is read.
+  size_t max_body_size = 16 * 1024 * 1024;
+
+  // Limits the parser enforces as the request line and headers arrive:
+  // longer URIs get 414, and more or longer headers 431
+  // ("client_max_uri_length", "client_max_header_count",
+  // "client_max_header_line_size")
+  size_t max_uri_length = 8 * 1024;
+  size_t max_header_count = 100;
+  size_t max_header_line_size = 8 * 1024;
+
+  // Largest body kept in memory. A larger one that has not arrived with its
+  // headers is spooled to a temp file, and bodies streamed to a handler are
+  // read this much at a time ("client_body_buffer_size").
+  size_t body_buffer_size = 64 * 1024;
+
+  // Time allowed to receive a complete request line and headers, and the
+  // longest pause between reads of a request body ("client_header_timeout")
+  std::chrono::milliseconds header_timeout{60 * 1000};
+
+  // Time an idle connection is kept open waiting for its next request
+  // ("keepalive_timeout")
+  std::chrono::milliseconds keepalive_timeout{75 * 1000};
+
+  // Largest piece of a streamed reply body held in memory at once
+  // ("output_buffer_size")
+  size_t output_buffer_size = 16 * 1024;
+
+  // Time allowed for the client to accept a queued response ("send_timeout")
+  std::chrono::milliseconds send_timeout{60 * 1000};
+
+  // Accept cleartext HTTP/2, by prior knowledge or "Upgrade: h2c" ("http2 on;")
+  bool http2 = true;
+
+  // Send file-backed reply bodies with sendfile(2) rather than reading them
+  // into the output buffer ("sendfile on;")
+  bool sendfile = true;
+};
+
+// Server-wide options read from top-level directives. Defaults match the
+// behavior of a config file that sets none of them.
+struct ServerOptions {
+  // Number of io threads ("threads N;" or "threads auto;")
+  int thread_count = 4;
+
+  // "shared": every thread runs one io_service with one acceptor.
+  // "per_core": each thread gets its own io_service and SO_REUSEPORT acceptor.
+  std::string io_model = "shared";
+
+  // Pin io thread i to CPU i ("cpu_affinity on;")
+  bool cpu_affinity = false;
+
+  // Hard limit on open connections; past it the servers stop accepting
+  // ("max_connections N;", 0 for unlimited)
+  size_t max_connections = 0;
+
+  // Soft limit on requests being handled or written; past it requests get
+  // 503 Service Unavailable with Retry-After ("max_inflight_requests N;",
+  // 0 for unlimited)
+  size_t max_inflight_requests = 0;
+
+  // Threads that run handlers of "blocking on;" locations
+  // ("blocking_threads N;")
+  size_t blocking_threads = 4;
+
+  // On SIGTERM or a handoff, how long open connections may take to finish
+  // before the process exits anyway ("drain_timeout 30s;")
+  std::chrono::milliseconds drain_timeout{30 * 1000};
+
+  // Unix socket used to pass the listening sockets to a restarted server
+  // ("handoff_socket /run/server.sock;"); empty disables handoff
+  std::string handoff_socket;
+
+  SessionOptions session;
 };
 
 // The parsed representation of a single config statement.
@@ -34,9 +155,15 @@ class NginxConfig {
   
   // Extract handler configurations from the config file
   std::map<std::string, HandlerConfig> ExtractHandlerConfigs();
+
+  // Extract server-wide options; returns false if a directive has a bad value
+  bool ExtractServerOptions(ServerOptions& options) const;
   
   // Find a specific token value in the configuration (helper method)
   std::string FindConfigToken(const std::string& token_name) const;
+
+  // Find a token value in top-level statements only, skipping child blocks
+  std::string FindServerToken(const std::string& token_name) const;
   
   std::vector<std::shared_ptr<NginxConfigStatement>> statements_;
 };
@@ -0,0 +1,71 @@
+#include "connection_limiter.h"
+#include <algorithm>
+
+connection_limiter::connection_limiter(std::size_t max_connections,
+                                       std::size_t max_inflight_requests)
+  : max_connections_(max_connections),
+    max_inflight_requests_(max_inflight_requests) {
+}
+
+void connection_limiter::connection_opened() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++connections_;
+}
+
+void connection_limiter::connection_closed() {
+  std::vector<std::pair<const void*, std::function<void()>>> waiters;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --connections_;
+    if (max_connections_ == 0 || connections_ < max_connections_) {
+      waiters.swap(waiters_);
+    }
+  }
+
+  // Resume outside the lock; a resumed server may call back into us
+  for (auto& waiter : waiters) {
+    waiter.second();
+  }
+}
+
+bool connection_limiter::pause_accepting(const void* owner, std::function<void()> resume) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (max_connections_ == 0 || connections_ < max_connections_) {
+    return false;
+  }
+  waiters_.emplace_back(owner, std::move(resume));
+  return true;
+}
+
+void connection_limiter::cancel_wait(const void* owner) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  waiters_.erase(std::remove_if(waiters_.begin(), waiters_.end(),
+                                [owner](const std::pair<const void*, std::function<void()>>& waiter) {
+                                  return waiter.first == owner;
+                                }),
+                 waiters_.end());
+}
+
+bool connection_limiter::try_begin_request() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (max_inflight_requests_ != 0 && inflight_requests_ >= max_inflight_requests_) {
+    return false;
+  }
+  ++inflight_requests_;
+  return true;
+}
+
+void connection_limiter::end_requests(std::size_t count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  inflight_requests_ -= count;
+}
+
+std::size_t connection_limiter::connections() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return connections_;
+}
+
+std::size_t connection_limiter::inflight_requests() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return inflight_requests_;
+}
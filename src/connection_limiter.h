@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Process-wide connection and request limits shared by every server.
+//
+// max_connections is the hard limit: once that many connections are open,
+// servers stop accepting (new clients wait in the kernel's listen backlog)
+// until one closes. max_inflight_requests is the soft limit: a request that
+// arrives while that many are being handled or written is answered with a
+// cheap 503 instead of being run. A limit of 0 means unlimited.
+//
+// A server counts each connection as it accepts it, so a single server stops
+// at exactly max_connections. Each server keeps one accept outstanding,
+// though, so with several servers (io_model "per_core") up to one extra
+// connection per other server can get in before they have all paused.
+class connection_limiter {
+public:
+  connection_limiter(std::size_t max_connections, std::size_t max_inflight_requests);
+
+  connection_limiter(const connection_limiter&) = delete;
+  connection_limiter& operator=(const connection_limiter&) = delete;
+
+  // Counts an accepted connection, and releases one counted earlier
+  void connection_opened();
+  void connection_closed();
+
+  // Returns false if the server may keep accepting. Otherwise the limit is
+  // reached and resume will be called, from whichever thread closes a
+  // connection, once there is room again. owner identifies the waiter for
+  // cancel_wait().
+  bool pause_accepting(const void* owner, std::function<void()> resume);
+
+  // Forgets a waiter registered by pause_accepting()
+  void cancel_wait(const void* owner);
+
+  // Counts a request as in flight, or returns false if the soft limit is reached
+  bool try_begin_request();
+
+  // Releases count requests started by try_begin_request()
+  void end_requests(std::size_t count);
+
+  std::size_t connections();
+  std::size_t inflight_requests();
+
+private:
+  const std::size_t max_connections_;
+  const std::size_t max_inflight_requests_;
+
+  std::mutex mutex_;
+  std::size_t connections_ = 0;
+  std::size_t inflight_requests_ = 0;
+  std::vector<std::pair<const void*, std::function<void()>>> waiters_;
+};
@@ -5,9 +5,13 @@ namespace http {
 namespace server {
 
 std::unique_ptr<reply> EchoHandler::handle_request(const request& request) {
+    return handle_request_view(request_view(request, request.get_allocator()));
+}
+
+std::unique_ptr<reply> EchoHandler::handle_request_view(const request_view& request) {
     // Process request and generate content
     std::ostringstream oss;
-    oss << request.method << " " << request.uri << " HTTP/" 
+    oss << request.method_name << " " << request.uri << " HTTP/" 
         << request.http_version_major << "." << request.http_version_minor << "\r\n";
     
     for (const auto& header : request.headers) {
@@ -27,7 +31,7 @@ std::unique_ptr<reply> EchoHandler::handle_request(const request& request) {
     headers.push_back(content_type);
     
     // Create and return response
-    return BuildResponse(reply::ok, content, headers);
+    return BuildResponse(reply::ok, content, headers, request.get_allocator());
 }
 
 bool EchoHandler::Register() {
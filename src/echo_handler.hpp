@@ -18,6 +18,8 @@ public:
   static bool Register();
   
   std::unique_ptr<reply> handle_request(const request& request) override;
+  std::unique_ptr<reply> handle_request_view(const request_view& request) override;
+  bool is_reusable() const override { return true; }
 };
 
 } // namespace server
@@ -0,0 +1,189 @@
+#include "handoff.h"
+#include <boost/bind.hpp>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// More listening sockets than io threads is not a configuration we produce
+const std::size_t max_handoff_fds = 64;
+
+// How long a new process waits for a wedged old process before giving up
+const int receive_timeout_seconds = 5;
+
+}  // namespace
+
+bool send_fds(int socket_fd, const std::vector<int>& fds) {
+  if (fds.empty() || fds.size() > max_handoff_fds) {
+    return false;
+  }
+
+  // SCM_RIGHTS needs at least one byte of ordinary data to ride along
+  char payload = 'F';
+  struct iovec iov;
+  iov.iov_base = &payload;
+  iov.iov_len = 1;
+
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()), 0);
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+  std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+  return ::sendmsg(socket_fd, &msg, MSG_NOSIGNAL) == 1;
+}
+
+std::vector<int> receive_fds(int socket_fd) {
+  char payload = 0;
+  struct iovec iov;
+  iov.iov_base = &payload;
+  iov.iov_len = 1;
+
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * max_handoff_fds), 0);
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+
+  std::vector<int> fds;
+  if (::recvmsg(socket_fd, &msg, MSG_CMSG_CLOEXEC) != 1) {
+    return fds;
+  }
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      std::size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      fds.resize(count);
+      std::memcpy(fds.data(), CMSG_DATA(cmsg), sizeof(int) * count);
+    }
+  }
+  return fds;
+}
+
+handoff_listener::handoff_listener(boost::asio::io_service& io_service, const std::string& path,
+                                   std::function<std::vector<int>()> listen_handles,
+                                   std::function<void()> on_handoff)
+  : acceptor_(io_service),
+    peer_(io_service),
+    listen_handles_(std::move(listen_handles)),
+    on_handoff_(std::move(on_handoff)) {
+  // The previous process's socket file, if any, has served its purpose
+  ::unlink(path.c_str());
+
+  boost::asio::local::stream_protocol::endpoint endpoint(path);
+  acceptor_.open(endpoint.protocol());
+  acceptor_.bind(endpoint);
+  acceptor_.listen();
+  start_accept();
+}
+
+void handoff_listener::close() {
+  boost::system::error_code ignored_ec;
+  acceptor_.close(ignored_ec);
+  peer_.close(ignored_ec);
+}
+
+void handoff_listener::start_accept() {
+  acceptor_.async_accept(peer_,
+      boost::bind(&handoff_listener::handle_accept, this,
+        boost::asio::placeholders::error));
+}
+
+void handoff_listener::handle_accept(const boost::system::error_code& error) {
+  if (!acceptor_.is_open()) {
+    return;
+  }
+  if (error) {
+    start_accept();
+    return;
+  }
+
+  if (!send_fds(peer_.native_handle(), listen_handles_())) {
+    std::cerr << "Warning: Failed to hand listening sockets to new process" << std::endl;
+    boost::system::error_code ignored_ec;
+    peer_.close(ignored_ec);
+    start_accept();
+    return;
+  }
+
+  // Keep serving until the new process confirms it is accepting
+  boost::asio::async_read(peer_, boost::asio::buffer(&acknowledgement_, 1),
+      boost::bind(&handoff_listener::handle_acknowledge, this,
+        boost::asio::placeholders::error,
+        boost::asio::placeholders::bytes_transferred));
+}
+
+void handoff_listener::handle_acknowledge(const boost::system::error_code& error,
+                                          std::size_t bytes_transferred) {
+  if (!acceptor_.is_open()) {
+    return;
+  }
+  if (error || bytes_transferred != 1) {
+    // The new process went away; wait for another one
+    boost::system::error_code ignored_ec;
+    peer_.close(ignored_ec);
+    start_accept();
+    return;
+  }
+
+  close();
+  on_handoff_();
+}
+
+handoff_client::~handoff_client() {
+  if (socket_fd_ >= 0) {
+    ::close(socket_fd_);
+  }
+}
+
+std::vector<int> handoff_client::inherit(const std::string& path) {
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    return std::vector<int>();
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size());
+
+  socket_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (socket_fd_ < 0) {
+    return std::vector<int>();
+  }
+  if (::connect(socket_fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+    // Nobody is serving there; this is a cold start
+    ::close(socket_fd_);
+    socket_fd_ = -1;
+    return std::vector<int>();
+  }
+
+  struct timeval timeout;
+  timeout.tv_sec = receive_timeout_seconds;
+  timeout.tv_usec = 0;
+  ::setsockopt(socket_fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  return receive_fds(socket_fd_);
+}
+
+void handoff_client::acknowledge() {
+  if (socket_fd_ < 0) {
+    return;
+  }
+  char acknowledgement = 'A';
+  if (::send(socket_fd_, &acknowledgement, 1, MSG_NOSIGNAL) != 1) {
+    std::cerr << "Warning: Failed to acknowledge listening socket handoff" << std::endl;
+  }
+  ::close(socket_fd_);
+  socket_fd_ = -1;
+}
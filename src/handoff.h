@@ -0,0 +1,74 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Zero-downtime restart. A running server listens on a Unix domain socket
+// ("handoff_socket" in the config); a new process started with the same
+// config connects to it, receives the listening sockets (SCM_RIGHTS), starts
+// accepting on them and acknowledges. Only then does the old process stop
+// accepting and drain, so the port never goes unserved.
+//
+//   new process                        old process
+//   handoff_client::inherit()  ---->   handoff_listener accepts
+//                              <----   listening fds
+//   servers adopt the fds
+//   handoff_client::acknowledge() -->  on_handoff(): stop accepting, drain
+//
+// If the new process goes away before acknowledging, the old one keeps serving.
+
+// Sends fds over a connected Unix socket in a single message; false on failure
+bool send_fds(int socket_fd, const std::vector<int>& fds);
+
+// Receives fds sent by send_fds(); empty on failure
+std::vector<int> receive_fds(int socket_fd);
+
+// Old-process side: hands the listening sockets to the next process
+class handoff_listener {
+public:
+  // listen_handles is called for each handoff to get the sockets to send;
+  // on_handoff runs once a new process has acknowledged them. Any stale
+  // socket file at path is replaced.
+  handoff_listener(boost::asio::io_service& io_service, const std::string& path,
+                   std::function<std::vector<int>()> listen_handles,
+                   std::function<void()> on_handoff);
+
+  handoff_listener(const handoff_listener&) = delete;
+  handoff_listener& operator=(const handoff_listener&) = delete;
+
+  // Stops listening for new processes. The socket file is left in place
+  // because the next process has already bound its own at the same path.
+  void close();
+
+private:
+  void start_accept();
+  void handle_accept(const boost::system::error_code& error);
+  void handle_acknowledge(const boost::system::error_code& error, std::size_t bytes_transferred);
+
+  boost::asio::local::stream_protocol::acceptor acceptor_;
+  boost::asio::local::stream_protocol::socket peer_;
+  std::function<std::vector<int>()> listen_handles_;
+  std::function<void()> on_handoff_;
+  char acknowledgement_ = 0;
+};
+
+// New-process side: takes over the listening sockets of a running server
+class handoff_client {
+public:
+  handoff_client() = default;
+  ~handoff_client();
+
+  handoff_client(const handoff_client&) = delete;
+  handoff_client& operator=(const handoff_client&) = delete;
+
+  // Receives the listening sockets of the process serving at path. Returns
+  // an empty vector if no process is listening there.
+  std::vector<int> inherit(const std::string& path);
+
+  // Tells the old process the sockets are being served so it can drain
+  void acknowledge();
+
+private:
+  int socket_fd_ = -1;
+};
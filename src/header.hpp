@@ -11,15 +11,49 @@
 #ifndef HTTP_HEADER_HPP
 #define HTTP_HEADER_HPP
 
+#include <memory_resource>
 #include <string>
+#include <string_view>
 
 namespace http {
 namespace server {
 
+/// A header name and value. The strings use the allocator of the request or
+/// reply that holds the header.
 struct header
 {
-  std::string name;
-  std::string value;
+  typedef std::pmr::polymorphic_allocator<char> allocator_type;
+
+  header() = default;
+
+  explicit header(const allocator_type& alloc)
+    : name(alloc), value(alloc)
+  {
+  }
+
+  header(std::string_view n, std::string_view v, const allocator_type& alloc = {})
+    : name(n, alloc), value(v, alloc)
+  {
+  }
+
+  header(const header& other) = default;
+  header(header&& other) = default;
+
+  header(const header& other, const allocator_type& alloc)
+    : name(other.name, alloc), value(other.value, alloc)
+  {
+  }
+
+  header(header&& other, const allocator_type& alloc)
+    : name(std::move(other.name), alloc), value(std::move(other.value), alloc)
+  {
+  }
+
+  header& operator=(const header& other) = default;
+  header& operator=(header&& other) = default;
+
+  std::pmr::string name;
+  std::pmr::string value;
 };
 
 } // namespace server
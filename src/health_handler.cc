@@ -6,11 +6,16 @@ namespace http {
 namespace server {
 
 std::unique_ptr<reply> HealthHandler::handle_request(const request& request) {
-    // ok payload
-    std::string content = "OK\r\n";
-    
-    // Create and return response
-    return BuildResponse(reply::ok, content);
+    std::unique_ptr<reply> rep = handle_request_view(request_view(request, request.get_allocator()));
+    rep->expand();
+    return rep;
+}
+
+std::unique_ptr<reply> HealthHandler::handle_request_view(const request_view& request) {
+    // Load balancers poll this constantly, so the bytes are built once
+    static const std::shared_ptr<const prebuilt_response> ok_response =
+        BuildPrebuiltResponse(reply::ok, "OK\r\n");
+    return reply::prebuilt_reply(ok_response);
 }
 
 bool HealthHandler::Register() {
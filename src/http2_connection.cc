@@ -0,0 +1,320 @@
+#include "http2_connection.h"
+#include <nghttp2/nghttp2.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <exception>
+
+namespace {
+
+// Streams one client may have open at once
+const std::uint32_t max_concurrent_streams = 100;
+
+// HTTP/1 connection-specific headers have no meaning in HTTP/2 and make
+// clients treat the response as malformed
+bool is_connection_header(const std::string& name) {
+  static const char* const names[] = {
+    "connection", "keep-alive", "proxy-connection", "transfer-encoding", "upgrade"
+  };
+  for (const char* connection_header : names) {
+    if (name == connection_header) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// "content-type" -> "Content-Type", the spelling handlers look up
+std::string title_case(const std::string& name) {
+  std::string result = name;
+  bool start = true;
+  for (char& c : result) {
+    c = start ? std::toupper(static_cast<unsigned char>(c)) : c;
+    start = (c == '-');
+  }
+  return result;
+}
+
+std::string lower_case(std::string_view name) {
+  std::string result(name);
+  std::transform(result.begin(), result.end(), result.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return result;
+}
+
+// HTTP2-Settings is the SETTINGS payload in base64url without padding
+bool decode_base64url(const std::string& input, std::string& output) {
+  output.clear();
+  std::uint32_t bits = 0;
+  int bit_count = 0;
+  for (char c : input) {
+    int value;
+    if (c >= 'A' && c <= 'Z') {
+      value = c - 'A';
+    } else if (c >= 'a' && c <= 'z') {
+      value = c - 'a' + 26;
+    } else if (c >= '0' && c <= '9') {
+      value = c - '0' + 52;
+    } else if (c == '-') {
+      value = 62;
+    } else if (c == '_') {
+      value = 63;
+    } else if (c == '=') {
+      break;
+    } else {
+      return false;
+    }
+    bits = (bits << 6) | value;
+    bit_count += 6;
+    if (bit_count >= 8) {
+      bit_count -= 8;
+      output.push_back(static_cast<char>((bits >> bit_count) & 0xff));
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+const std::string http2_connection::client_preface(NGHTTP2_CLIENT_MAGIC, NGHTTP2_CLIENT_MAGIC_LEN);
+
+struct http2_connection::incoming_stream {
+  http::server::request request;
+  std::size_t header_bytes = 0;
+};
+
+struct http2_connection::outgoing_stream {
+  std::unique_ptr<http::server::reply> reply;
+  std::size_t offset = 0;
+};
+
+struct http2_connection::callbacks {
+  static int on_begin_headers(nghttp2_session* session, const nghttp2_frame* frame, void* user_data) {
+    if (frame->hd.type != NGHTTP2_HEADERS || frame->headers.cat != NGHTTP2_HCAT_REQUEST) {
+      return 0;
+    }
+    auto* connection = static_cast<http2_connection*>(user_data);
+    auto stream = std::make_unique<incoming_stream>();
+    stream->request.http_version_major = 2;
+    stream->request.http_version_minor = 0;
+    connection->incoming_[frame->hd.stream_id] = std::move(stream);
+    return 0;
+  }
+
+  static int on_header(nghttp2_session* session, const nghttp2_frame* frame,
+                       const std::uint8_t* name, std::size_t namelen,
+                       const std::uint8_t* value, std::size_t valuelen,
+                       std::uint8_t flags, void* user_data) {
+    auto* connection = static_cast<http2_connection*>(user_data);
+    auto it = connection->incoming_.find(frame->hd.stream_id);
+    if (it == connection->incoming_.end()) {
+      return 0;
+    }
+
+    // Resets just this stream
+    incoming_stream& stream = *it->second;
+    stream.header_bytes += namelen + valuelen;
+    if (stream.header_bytes > connection->max_header_size_) {
+      connection->incoming_.erase(it);
+      return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+    }
+
+    std::string header_name(reinterpret_cast<const char*>(name), namelen);
+    std::string header_value(reinterpret_cast<const char*>(value), valuelen);
+    if (header_name == ":method") {
+      stream.request.method = header_value;
+    } else if (header_name == ":path") {
+      stream.request.uri = header_value;
+    } else if (header_name == ":authority") {
+      stream.request.headers.push_back({"Host", header_value});
+    } else if (header_name[0] != ':') {
+      stream.request.headers.push_back({title_case(header_name), header_value});
+    }
+    return 0;
+  }
+
+  static int on_data_chunk(nghttp2_session* session, std::uint8_t flags, std::int32_t stream_id,
+                           const std::uint8_t* data, std::size_t len, void* user_data) {
+    auto* connection = static_cast<http2_connection*>(user_data);
+    auto it = connection->incoming_.find(stream_id);
+    if (it == connection->incoming_.end()) {
+      return 0;
+    }
+
+    std::pmr::string& body = it->second->request.body;
+    if (body.size() + len > connection->max_body_size_) {
+      connection->incoming_.erase(it);
+      nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_CANCEL);
+      return 0;
+    }
+    body.append(reinterpret_cast<const char*>(data), len);
+    return 0;
+  }
+
+  static int on_frame_recv(nghttp2_session* session, const nghttp2_frame* frame, void* user_data) {
+    if ((frame->hd.type != NGHTTP2_HEADERS && frame->hd.type != NGHTTP2_DATA) ||
+        !(frame->hd.flags & NGHTTP2_FLAG_END_STREAM)) {
+      return 0;
+    }
+    auto* connection = static_cast<http2_connection*>(user_data);
+    auto it = connection->incoming_.find(frame->hd.stream_id);
+    if (it == connection->incoming_.end()) {
+      return 0;
+    }
+    connection->completed_.push_back({frame->hd.stream_id, std::move(it->second->request)});
+    connection->incoming_.erase(it);
+    return 0;
+  }
+
+  static int on_stream_close(nghttp2_session* session, std::int32_t stream_id,
+                             std::uint32_t error_code, void* user_data) {
+    auto* connection = static_cast<http2_connection*>(user_data);
+    connection->incoming_.erase(stream_id);
+    connection->outgoing_.erase(stream_id);
+    return 0;
+  }
+
+  static ssize_t read_body(nghttp2_session* session, std::int32_t stream_id,
+                           std::uint8_t* buf, std::size_t length, std::uint32_t* data_flags,
+                           nghttp2_data_source* source, void* user_data) {
+    auto* stream = static_cast<outgoing_stream*>(source->ptr);
+    if (stream->reply->body) {
+      // Pulled straight into the frame; nghttp2 asks again while the
+      // stream's flow-control window allows
+      std::size_t count;
+      try {
+        count = stream->reply->body->read(reinterpret_cast<char*>(buf), length);
+      } catch (const std::exception&) {
+        return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+      }
+      if (count == 0) {
+        *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+      }
+      return count;
+    }
+
+    const std::pmr::string& content = stream->reply->content;
+    std::size_t count = std::min(length, content.size() - stream->offset);
+    std::memcpy(buf, content.data() + stream->offset, count);
+    stream->offset += count;
+    if (stream->offset == content.size()) {
+      *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    }
+    return count;
+  }
+};
+
+http2_connection::http2_connection(const SessionOptions& options)
+  : max_header_size_(options.max_header_size),
+    max_body_size_(options.max_body_size) {
+  nghttp2_session_callbacks* cbs;
+  nghttp2_session_callbacks_new(&cbs);
+  nghttp2_session_callbacks_set_on_begin_headers_callback(cbs, callbacks::on_begin_headers);
+  nghttp2_session_callbacks_set_on_header_callback(cbs, callbacks::on_header);
+  nghttp2_session_callbacks_set_on_data_chunk_recv_callback(cbs, callbacks::on_data_chunk);
+  nghttp2_session_callbacks_set_on_frame_recv_callback(cbs, callbacks::on_frame_recv);
+  nghttp2_session_callbacks_set_on_stream_close_callback(cbs, callbacks::on_stream_close);
+  nghttp2_session_server_new(&session_, cbs, this);
+  nghttp2_session_callbacks_del(cbs);
+
+  // The server's SETTINGS must be the first frame it sends
+  nghttp2_settings_entry settings[] = {
+    {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, max_concurrent_streams},
+    {NGHTTP2_SETTINGS_MAX_HEADER_LIST_SIZE, static_cast<std::uint32_t>(max_header_size_)},
+  };
+  nghttp2_submit_settings(session_, NGHTTP2_FLAG_NONE, settings, 2);
+}
+
+http2_connection::~http2_connection() {
+  nghttp2_session_del(session_);
+}
+
+bool http2_connection::upgrade(const std::string& settings, bool head_request) {
+  std::string payload;
+  if (!decode_base64url(settings, payload)) {
+    return false;
+  }
+  return nghttp2_session_upgrade2(session_, reinterpret_cast<const std::uint8_t*>(payload.data()),
+                                  payload.size(), head_request ? 1 : 0, nullptr) == 0;
+}
+
+bool http2_connection::receive(const char* data, std::size_t size) {
+  ssize_t result = nghttp2_session_mem_recv(session_, reinterpret_cast<const std::uint8_t*>(data), size);
+  return result >= 0;
+}
+
+std::vector<http2_connection::stream_request> http2_connection::take_requests() {
+  std::vector<stream_request> requests;
+  requests.swap(completed_);
+  return requests;
+}
+
+void http2_connection::submit_reply(std::int32_t stream_id, std::unique_ptr<http::server::reply> rep) {
+  // Prebuilt bytes are HTTP/1.1; HTTP/2 frames the response from its fields
+  rep->expand();
+  std::vector<std::string> names;
+  std::vector<std::string> values;
+  names.push_back(":status");
+  values.push_back(std::to_string(static_cast<int>(rep->status)));
+  for (const auto& header : rep->headers) {
+    std::string name = lower_case(header.name);
+    if (!is_connection_header(name)) {
+      names.push_back(name);
+      values.emplace_back(header.value);
+    }
+  }
+
+  // nghttp2 copies the header block when the response is submitted
+  std::vector<nghttp2_nv> nva;
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    nva.push_back({reinterpret_cast<std::uint8_t*>(&names[i][0]),
+                   reinterpret_cast<std::uint8_t*>(&values[i][0]),
+                   names[i].size(), values[i].size(), NGHTTP2_NV_FLAG_NONE});
+  }
+
+  if (rep->content.empty() && !rep->body) {
+    nghttp2_submit_response(session_, stream_id, nva.data(), nva.size(), nullptr);
+    return;
+  }
+
+  // The body is read out of the reply as DATA frames are sent
+  auto stream = std::make_unique<outgoing_stream>();
+  stream->reply = std::move(rep);
+  nghttp2_data_provider provider;
+  provider.source.ptr = stream.get();
+  provider.read_callback = callbacks::read_body;
+  if (nghttp2_submit_response(session_, stream_id, nva.data(), nva.size(), &provider) == 0) {
+    outgoing_[stream_id] = std::move(stream);
+  }
+}
+
+bool http2_connection::send(std::string& out) {
+  for (;;) {
+    const std::uint8_t* data;
+    ssize_t length = nghttp2_session_mem_send(session_, &data);
+    if (length < 0) {
+      return false;
+    }
+    if (length == 0) {
+      return true;
+    }
+    out.append(reinterpret_cast<const char*>(data), length);
+  }
+}
+
+void http2_connection::shutdown() {
+  if (goaway_sent_) {
+    return;
+  }
+  goaway_sent_ = true;
+  nghttp2_submit_goaway(session_, NGHTTP2_FLAG_NONE, nghttp2_session_get_last_proc_stream_id(session_),
+                        NGHTTP2_NO_ERROR, nullptr, 0);
+}
+
+bool http2_connection::want_read() const {
+  return nghttp2_session_want_read(session_) != 0;
+}
+
+bool http2_connection::finished() const {
+  return nghttp2_session_want_read(session_) == 0 && nghttp2_session_want_write(session_) == 0;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "config_parser.h"
+#include "reply.hpp"
+#include "request.hpp"
+
+struct nghttp2_session;
+
+// The HTTP/2 framing and HPACK state of one cleartext (h2c) connection,
+// built on nghttp2. It does no I/O: session feeds it the bytes it reads,
+// collects the requests whose streams are complete, submits a reply per
+// stream in any order, and writes out whatever frames are pending.
+//
+// Requests are handed over in the form HTTP/1 handlers already expect:
+// version 2.0, pseudo-headers folded into method and uri, ":authority" as
+// Host and header names in Title-Case.
+class http2_connection {
+public:
+  // The client connection preface that starts every HTTP/2 connection
+  static const std::string client_preface;
+
+  // A request whose stream the client has finished sending
+  struct stream_request {
+    std::int32_t stream_id;
+    http::server::request request;
+  };
+
+  // Headers larger than max_header_size or bodies larger than max_body_size
+  // reset their stream
+  explicit http2_connection(const SessionOptions& options);
+  ~http2_connection();
+
+  http2_connection(const http2_connection&) = delete;
+  http2_connection& operator=(const http2_connection&) = delete;
+
+  // Takes over a connection upgraded from HTTP/1.1 with "Upgrade: h2c".
+  // settings is the request's HTTP2-Settings header; the request itself
+  // becomes stream 1. Returns false if settings cannot be decoded.
+  bool upgrade(const std::string& settings, bool head_request);
+
+  // Processes bytes read from the client. Returns false on a connection
+  // error; whatever send() still produces (typically a GOAWAY) should be
+  // written before closing.
+  bool receive(const char* data, std::size_t size);
+
+  // Requests completed since the last call, in the order they completed
+  std::vector<stream_request> take_requests();
+
+  // Queues the response on stream_id. A reply to a stream the client has
+  // since reset is dropped.
+  void submit_reply(std::int32_t stream_id, std::unique_ptr<http::server::reply> rep);
+
+  // Appends the frames waiting to be sent to out; false on a fatal error
+  bool send(std::string& out);
+
+  // Sends GOAWAY: streams already started are finished, no new ones accepted
+  void shutdown();
+
+  // Whether the connection still expects input from the client
+  bool want_read() const;
+
+  // True once there is nothing left to read or write and the connection
+  // can be closed
+  bool finished() const;
+
+private:
+  struct incoming_stream;
+  struct outgoing_stream;
+
+  // nghttp2 callbacks; defined with the nghttp2 types in the .cc
+  struct callbacks;
+
+  nghttp2_session* session_ = nullptr;
+  std::size_t max_header_size_;
+  std::size_t max_body_size_;
+  bool goaway_sent_ = false;
+
+  std::map<std::int32_t, std::unique_ptr<incoming_stream>> incoming_;
+  std::map<std::int32_t, std::unique_ptr<outgoing_stream>> outgoing_;
+  std::vector<stream_request> completed_;
+};
@@ -0,0 +1,86 @@
+#include "io_service_pool.h"
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+
+io_service_pool::io_service_pool(std::size_t pool_size, std::size_t threads_per_service,
+                                 bool pin_threads)
+  : threads_per_service_(threads_per_service), pin_threads_(pin_threads) {
+  if (pool_size == 0 || threads_per_service == 0) {
+    throw std::runtime_error("io_service_pool size must be greater than 0");
+  }
+
+  for (std::size_t i = 0; i < pool_size; ++i) {
+    // Hint a concurrency of 1 so asio can skip locking when one thread owns the io_service
+    int concurrency_hint = threads_per_service == 1 ? 1 : BOOST_ASIO_CONCURRENCY_HINT_DEFAULT;
+    io_services_.push_back(std::make_shared<boost::asio::io_service>(concurrency_hint));
+  }
+}
+
+std::size_t io_service_pool::size() const {
+  return io_services_.size();
+}
+
+boost::asio::io_service& io_service_pool::get_io_service(std::size_t index) {
+  return *io_services_.at(index);
+}
+
+void io_service_pool::run() {
+  std::vector<std::thread> threads_container;
+  std::exception_ptr thread_exception_ptr = nullptr;
+  std::mutex exception_mutex;
+
+  std::size_t cpu = 0;
+  for (auto& io_service : io_services_) {
+    for (std::size_t i = 0; i < threads_per_service_; ++i, ++cpu) {
+      threads_container.emplace_back([this, io_service, cpu, &thread_exception_ptr, &exception_mutex]() {
+        if (pin_threads_) {
+          pin_current_thread(cpu);
+        }
+        try {
+          io_service->run();
+        } catch (std::exception& e) {
+          std::lock_guard<std::mutex> lock(exception_mutex);
+          if (!thread_exception_ptr) {
+            thread_exception_ptr = std::current_exception();
+          }
+        }
+      });
+    }
+  }
+
+  // Check if all threads have completed their operations
+  for (std::thread& t : threads_container) {
+    t.join();
+  }
+
+  // Rethrow exceptions caught during threading
+  if (thread_exception_ptr) {
+    std::rethrow_exception(thread_exception_ptr);
+  }
+}
+
+void io_service_pool::stop() {
+  for (auto& io_service : io_services_) {
+    io_service->stop();
+  }
+}
+
+void io_service_pool::pin_current_thread(std::size_t cpu) {
+  unsigned int cpu_count = std::thread::hardware_concurrency();
+  if (cpu_count == 0) {
+    return;
+  }
+
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu % cpu_count, &cpu_set);
+  int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+  if (rc != 0) {
+    std::cerr << "Warning: Failed to pin io thread to CPU " << cpu % cpu_count << std::endl;
+  }
+}
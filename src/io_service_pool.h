@@ -0,0 +1,40 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// A pool of io_services, each run by one or more dedicated threads.
+//
+// With io_model "shared" the pool holds a single io_service run by every
+// thread. With io_model "per_core" it holds one io_service per thread so
+// completions never cross a shared reactor queue.
+class io_service_pool {
+public:
+  io_service_pool(std::size_t pool_size, std::size_t threads_per_service,
+                  bool pin_threads);
+
+  io_service_pool(const io_service_pool&) = delete;
+  io_service_pool& operator=(const io_service_pool&) = delete;
+
+  // Number of io_services in the pool
+  std::size_t size() const;
+
+  // Access the io_service at index (0 <= index < size())
+  boost::asio::io_service& get_io_service(std::size_t index);
+
+  // Run every io_service on its threads and block until all of them return.
+  // Rethrows the first exception thrown by any io thread.
+  void run();
+
+  // Stop all io_services
+  void stop();
+
+private:
+  // Pin the calling thread to a single CPU
+  static void pin_current_thread(std::size_t cpu);
+
+  std::vector<std::shared_ptr<boost::asio::io_service>> io_services_;
+  std::size_t threads_per_service_;
+  bool pin_threads_;
+};
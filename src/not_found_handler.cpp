@@ -4,9 +4,15 @@ namespace http {
 namespace server {
 
 std::unique_ptr<reply> NotFoundHandler::handle_request(const request& request) {
+  return handle_request_view(request_view(request, request.get_allocator()));
+}
+
+std::unique_ptr<reply> NotFoundHandler::handle_request_view(const request_view& request) {
   // Create a simple 404 error message
   std::string content = "404 Not Found\n";
-  content += "The requested resource '" + request.uri + "' was not found on this server.";
+  content += "The requested resource '";
+  content += request.uri;
+  content += "' was not found on this server.";
   
   // Define headers for the response
   std::vector<header> headers;
@@ -16,7 +22,7 @@ std::unique_ptr<reply> NotFoundHandler::handle_request(const request& request) {
   headers.push_back(content_type);
   
   // Create and return a 404 response
-  return BuildResponse(reply::not_found, content, headers);
+  return BuildResponse(reply::not_found, content, headers, request.get_allocator());
 }
 
 bool NotFoundHandler::Register() {
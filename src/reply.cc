@@ -9,6 +9,8 @@
 //
 
 #include "reply.hpp"
+#include <cstring>
+#include <stdexcept>
 #include <string>
 #include <memory>
 
@@ -41,6 +43,12 @@ const std::string forbidden =
   "HTTP/1.1 403 Forbidden\r\n";
 const std::string not_found =
   "HTTP/1.1 404 Not Found\r\n";
+const std::string payload_too_large =
+  "HTTP/1.1 413 Payload Too Large\r\n";
+const std::string uri_too_long =
+  "HTTP/1.1 414 URI Too Long\r\n";
+const std::string request_header_fields_too_large =
+  "HTTP/1.1 431 Request Header Fields Too Large\r\n";
 const std::string internal_server_error =
   "HTTP/1.1 500 Internal Server Error\r\n";
 const std::string not_implemented =
@@ -50,87 +58,58 @@ const std::string bad_gateway =
 const std::string service_unavailable =
   "HTTP/1.1 503 Service Unavailable\r\n";
 
-std::string to_string(reply::status_type status)
+const std::string& status_line(reply::status_type status)
 {
   switch (status)
   {
   case reply::ok:
     return ok;
-  // case reply::created:
-  //   return created;
-  // case reply::accepted:
-  //   return accepted;
-  // case reply::no_content:
-  //   return no_content;
-  // case reply::multiple_choices:
-  //   return multiple_choices;
-  // case reply::moved_permanently:
-  //   return moved_permanently;
-  // case reply::moved_temporarily:
-  //   return moved_temporarily;
-  // case reply::not_modified:
-  //   return not_modified;
-  case reply::bad_request:
-    return bad_request;
-  // case reply::unauthorized:
-  //   return unauthorized;
-  // case reply::forbidden:
-  //   return forbidden;
-  case reply::not_found:
-    return not_found;
-  case reply::internal_server_error:
-    return internal_server_error;
-  case reply::not_implemented:
-    return not_implemented;
-  // case reply::bad_gateway:
-  //   return bad_gateway;
-  // case reply::service_unavailable:
-  //   return service_unavailable;
-  // default:
-  //   return internal_server_error;
-  }
-}
-boost::asio::const_buffer to_buffer(reply::status_type status)
-{
-  switch (status)
-  {
-  case reply::ok:
-    return boost::asio::buffer(ok);
   case reply::created:
-    return boost::asio::buffer(created);
+    return created;
   case reply::accepted:
-    return boost::asio::buffer(accepted);
+    return accepted;
   case reply::no_content:
-    return boost::asio::buffer(no_content);
+    return no_content;
   case reply::multiple_choices:
-    return boost::asio::buffer(multiple_choices);
+    return multiple_choices;
   case reply::moved_permanently:
-    return boost::asio::buffer(moved_permanently);
+    return moved_permanently;
   case reply::moved_temporarily:
-    return boost::asio::buffer(moved_temporarily);
+    return moved_temporarily;
   case reply::not_modified:
-    return boost::asio::buffer(not_modified);
+    return not_modified;
   case reply::bad_request:
-    return boost::asio::buffer(bad_request);
+    return bad_request;
   case reply::unauthorized:
-    return boost::asio::buffer(unauthorized);
+    return unauthorized;
   case reply::forbidden:
-    return boost::asio::buffer(forbidden);
+    return forbidden;
   case reply::not_found:
-    return boost::asio::buffer(not_found);
+    return not_found;
+  case reply::payload_too_large:
+    return payload_too_large;
+  case reply::uri_too_long:
+    return uri_too_long;
+  case reply::request_header_fields_too_large:
+    return request_header_fields_too_large;
   case reply::internal_server_error:
-    return boost::asio::buffer(internal_server_error);
+    return internal_server_error;
   case reply::not_implemented:
-    return boost::asio::buffer(not_implemented);
+    return not_implemented;
   case reply::bad_gateway:
-    return boost::asio::buffer(bad_gateway);
+    return bad_gateway;
   case reply::service_unavailable:
-    return boost::asio::buffer(service_unavailable);
+    return service_unavailable;
   default:
-    return boost::asio::buffer(internal_server_error);
+    return internal_server_error;
   }
 }
 
+std::string to_string(reply::status_type status)
+{
+  return status_line(status);
+}
+
 } // namespace status_strings
 
 namespace misc_strings {
@@ -140,21 +119,144 @@ const char crlf[] = { '\r', '\n' };
 
 } // namespace misc_strings
 
+namespace {
+
+char* put(char* out, const char* data, std::size_t size)
+{
+  std::memcpy(out, data, size);
+  return out + size;
+}
+
+} // namespace
+
+const std::pmr::string& reply::serialize_head()
+{
+  const std::string& status_line = status_strings::status_line(status);
+
+  // Size the block first so it is filled with a single allocation
+  std::size_t size = status_line.size() + sizeof(misc_strings::crlf);
+  for (const header& h : headers)
+  {
+    size += h.name.size() + sizeof(misc_strings::name_value_separator)
+      + h.value.size() + sizeof(misc_strings::crlf);
+  }
+  head_.resize(size);
+
+  char* out = put(head_.data(), status_line.data(), status_line.size());
+  for (const header& h : headers)
+  {
+    out = put(out, h.name.data(), h.name.size());
+    out = put(out, misc_strings::name_value_separator, sizeof(misc_strings::name_value_separator));
+    out = put(out, h.value.data(), h.value.size());
+    out = put(out, misc_strings::crlf, sizeof(misc_strings::crlf));
+  }
+  put(out, misc_strings::crlf, sizeof(misc_strings::crlf));
+  return head_;
+}
+
+void reply::append_buffers(std::vector<boost::asio::const_buffer>& buffers)
+{
+  if (prebuilt)
+  {
+    std::string_view head = prebuilt->head(keep_alive_);
+    std::string_view content = prebuilt->content();
+    buffers.push_back(boost::asio::buffer(head.data(), head.size()));
+    buffers.push_back(boost::asio::buffer(content.data(), content.size()));
+    return;
+  }
+  buffers.push_back(boost::asio::buffer(serialize_head()));
+  if (!body)
+  {
+    buffers.push_back(boost::asio::buffer(content));
+  }
+}
+
 std::vector<boost::asio::const_buffer> reply::to_buffers()
 {
   std::vector<boost::asio::const_buffer> buffers;
-  buffers.push_back(status_strings::to_buffer(status));
-  for (std::size_t i = 0; i < headers.size(); ++i)
+  buffers.reserve(2);
+  append_buffers(buffers);
+  return buffers;
+}
+
+void reply::set_keep_alive(bool keep_alive)
+{
+  if (prebuilt)
+  {
+    keep_alive_ = keep_alive;
+    return;
+  }
+  headers.push_back({"Connection", keep_alive ? "keep-alive" : "close"});
+}
+
+void reply::expand()
+{
+  if (!prebuilt)
+  {
+    return;
+  }
+  status = prebuilt->status();
+  headers.assign(prebuilt->headers().begin(), prebuilt->headers().end());
+  content.assign(prebuilt->content());
+  prebuilt.reset();
+}
+
+std::unique_ptr<reply> reply::prebuilt_reply(std::shared_ptr<const prebuilt_response> response)
+{
+  auto rep = std::make_unique<reply>();
+  rep->status = response->status();
+  rep->prebuilt = std::move(response);
+  return rep;
+}
+
+prebuilt_response::prebuilt_response(const reply& rep)
+  : status_(rep.status),
+    headers_(rep.headers.begin(), rep.headers.end()),
+    content_(rep.content)
+{
+  if (rep.body || rep.prebuilt)
+  {
+    throw std::invalid_argument("prebuilt_response needs a reply with its content in memory");
+  }
+
+  reply head;
+  head.status = status_;
+  head.headers.reserve(headers_.size() + 1);
+  head.headers.assign(headers_.begin(), headers_.end());
+  head.headers.push_back({"Connection", "keep-alive"});
+  keep_alive_head_ = head.serialize_head();
+  head.headers.back().value = "close";
+  close_head_ = head.serialize_head();
+}
+
+std::shared_ptr<const prebuilt_response> prebuilt_response::variant(int key,
+    const std::function<std::shared_ptr<const prebuilt_response>()>& make) const
+{
   {
-    header& h = headers[i];
-    buffers.push_back(boost::asio::buffer(h.name));
-    buffers.push_back(boost::asio::buffer(misc_strings::name_value_separator));
-    buffers.push_back(boost::asio::buffer(h.value));
-    buffers.push_back(boost::asio::buffer(misc_strings::crlf));
+    std::shared_lock<std::shared_mutex> lock(variants_mutex_);
+    for (const auto& v : variants_)
+    {
+      if (v.first == key)
+      {
+        return v.second;
+      }
+    }
   }
-  buffers.push_back(boost::asio::buffer(misc_strings::crlf));
-  buffers.push_back(boost::asio::buffer(content));
-  return buffers;}
+
+  // Built outside the lock; if another thread got there first, its
+  // variant is the one kept
+  std::shared_ptr<const prebuilt_response> built = make();
+  std::unique_lock<std::shared_mutex> lock(variants_mutex_);
+  for (const auto& v : variants_)
+  {
+    if (v.first == key)
+    {
+      return v.second;
+    }
+  }
+  variants_.emplace_back(key, built);
+  return built;
+}
 
 namespace stock_replies {
 
@@ -278,9 +380,10 @@ const char service_unavailable[] =
 
 } // namespace stock_replies
 
-std::unique_ptr<reply> reply::stock_reply(reply::status_type status, std::string content)
+std::unique_ptr<reply> reply::stock_reply(reply::status_type status, std::string_view content,
+                                          const allocator_type& alloc)
 {
-  auto rep = std::make_unique<reply>();
+  auto rep = std::make_unique<reply>(alloc);
   rep->status = status;
   rep->content = content;
   rep->headers.resize(2);
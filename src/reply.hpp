@@ -11,17 +11,35 @@
 #ifndef HTTP_REPLY_HPP
 #define HTTP_REPLY_HPP
 
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <boost/asio.hpp>
+#include "body_source.h"
 #include "header.hpp"
 
 namespace http {
 namespace server {
 
-/// A reply to be sent to a client.
+class prebuilt_response;
+
+/// A reply to be sent to a client. Like request, it can be built in a
+/// request's arena by passing request::get_allocator().
 struct reply
 {
+  typedef std::pmr::polymorphic_allocator<char> allocator_type;
+
+  reply() = default;
+
+  explicit reply(const allocator_type& alloc)
+    : headers(alloc), content(alloc), head_(alloc)
+  {
+  }
+
   /// The status of the reply.
   enum status_type
   {
@@ -37,30 +55,116 @@ struct reply
     unauthorized = 401,
     forbidden = 403,
     not_found = 404,
+    payload_too_large = 413,
+    uri_too_long = 414,
+    request_header_fields_too_large = 431,
     internal_server_error = 500,
     not_implemented = 501,
     bad_gateway = 502,
     service_unavailable = 503
-  } status;
+  } status = ok;
 
   /// The headers to be included in the reply.
-  std::vector<header> headers;
+  std::pmr::vector<header> headers;
 
   /// The content to be sent in the reply.
-  std::string content;
+  std::pmr::string content;
+
+  /// When set, the body is streamed from here and content is not sent. The
+  /// session writes it a buffer at a time, chunked if its size is unknown.
+  std::unique_ptr<body_source> body;
 
-  /// Convert the reply into a vector of buffers. The buffers do not own the
-  /// underlying memory blocks, therefore the reply object must remain valid and
-  /// not be changed until the write operation has completed.
+  /// When set, the reply sends this response's bytes as they were serialized
+  /// when it was built; status is copied from it, and headers and content are
+  /// left empty. See prebuilt_reply().
+  std::shared_ptr<const prebuilt_response> prebuilt;
+
+  allocator_type get_allocator() const { return headers.get_allocator(); }
+
+  /// Serialize the status line and headers, with the blank line that ends
+  /// them, into one contiguous block. The block is sized before it is filled
+  /// and is rebuilt on every call, so headers may change in between.
+  const std::pmr::string& serialize_head();
+
+  /// Append the reply to a scatter-gather list as at most two buffers: the
+  /// serialized head and, unless a body is streamed, the content. The buffers
+  /// do not own the underlying memory blocks, therefore the reply object must
+  /// remain valid and not be changed until the write operation has completed.
+  void append_buffers(std::vector<boost::asio::const_buffer>& buffers);
+
+  /// Convert the reply into a vector of buffers, as append_buffers() does.
   std::vector<boost::asio::const_buffer> to_buffers();
 
+  /// Add the Connection header saying whether the connection stays open
+  /// after this reply. A prebuilt reply picks the head that was serialized
+  /// with that header instead.
+  void set_keep_alive(bool keep_alive);
+
+  /// Turn a prebuilt reply into an ordinary one by copying the response's
+  /// status, headers and content into it, for code that reads or changes
+  /// them. Does nothing to other replies.
+  void expand();
+
   /// Get a stock reply.
-  static std::unique_ptr<reply> stock_reply(status_type status, std::string content);
+  static std::unique_ptr<reply> stock_reply(status_type status, std::string_view content,
+                                           const allocator_type& alloc = {});
+
+  /// Get a reply that sends response without copying it.
+  static std::unique_ptr<reply> prebuilt_reply(std::shared_ptr<const prebuilt_response> response);
 
   // send 400 bad request for incorrectly formatted requests
   std::unique_ptr<reply> build_malformed_req_response();
+
+private:
+  /// Backing store for serialize_head(); reused across calls.
+  std::pmr::string head_;
+
+  /// Which of the prebuilt heads to send
+  bool keep_alive_ = false;
+};
+
+/// A complete response that is the same every time it is sent, such as a
+/// health check or a fixed form. It is serialized once, for both values of
+/// the Connection header, and shared read-only by the replies that send it,
+/// so handlers build it at startup and every request reuses its bytes.
+class prebuilt_response
+{
+public:
+  /// Serialize rep, which must not stream its body.
+  explicit prebuilt_response(const reply& rep);
+
+  reply::status_type status() const { return status_; }
+  const std::vector<header>& headers() const { return headers_; }
+  std::string_view content() const { return content_; }
+
+  /// The status line and headers, ending with "Connection: keep-alive" or
+  /// "Connection: close" and the blank line.
+  std::string_view head(bool keep_alive) const
+  {
+    return keep_alive ? keep_alive_head_ : close_head_;
+  }
+
+  /// A response derived from this one, such as a compressed form of it. The
+  /// first call for a key builds it with make, and later calls, from any
+  /// thread, share that result; make may return null, which is kept too.
+  std::shared_ptr<const prebuilt_response> variant(int key,
+      const std::function<std::shared_ptr<const prebuilt_response>()>& make) const;
+
+private:
+  reply::status_type status_;
+  std::vector<header> headers_;
+  std::string content_;
+  std::string keep_alive_head_;
+  std::string close_head_;
+
+  /// Built on demand by variant(); a response has only a few
+  mutable std::shared_mutex variants_mutex_;
+  mutable std::vector<std::pair<int, std::shared_ptr<const prebuilt_response>>> variants_;
 };
 namespace status_strings {
+  /// The status line for status, "HTTP/1.1 200 OK\r\n". The strings are
+  /// built once; unknown statuses map to 500.
+  const std::string& status_line(reply::status_type status);
   std::string to_string(reply::status_type status);
 }
 } // namespace server
@@ -11,22 +11,157 @@
 #ifndef HTTP_REQUEST_HPP
 #define HTTP_REQUEST_HPP
 
+#include <memory_resource>
+#include <optional>
 #include <string>
 #include <vector>
 #include "header.hpp"
+#include "request_view.hpp"
+#include "url_decoding.h"
 
 namespace http {
 namespace server {
 
-/// A request received from a client.
+/// A request received from a client. Every string and the header list draw
+/// on one allocator, so a session can place the whole request in its
+/// per-request arena (request_arena.h). Unlike a request_view it owns its
+/// bytes, so it can outlive the buffer it was parsed from.
 struct request
 {
-  std::string method;
-  std::string uri;
-  int http_version_major;
-  int http_version_minor;
-  std::vector<header> headers;
-  std::string body;
+  typedef std::pmr::polymorphic_allocator<char> allocator_type;
+
+  request() = default;
+
+  explicit request(const allocator_type& alloc)
+    : method(alloc), uri(alloc), headers(alloc), body(alloc)
+  {
+  }
+
+  request(const request& other) = default;
+  request(request&& other) = default;
+
+  request(const request& other, const allocator_type& alloc)
+    : method(other.method, alloc),
+      uri(other.uri, alloc),
+      http_version_major(other.http_version_major),
+      http_version_minor(other.http_version_minor),
+      headers(other.headers, alloc),
+      body(other.body, alloc),
+      route(other.route)
+  {
+  }
+
+  /// Copies everything a view points at
+  explicit request(const request_view& view, const allocator_type& alloc = {})
+    : method(view.method_name, alloc),
+      uri(view.uri, alloc),
+      http_version_major(view.http_version_major),
+      http_version_minor(view.http_version_minor),
+      headers(alloc),
+      body(view.body, alloc),
+      route(view.route)
+  {
+    headers.reserve(view.headers.size());
+    for (const header_view& h : view.headers)
+    {
+      headers.emplace_back(h.name, h.value);
+    }
+  }
+
+  request& operator=(const request& other) = default;
+  request& operator=(request&& other) = default;
+
+  allocator_type get_allocator() const { return headers.get_allocator(); }
+
+  /// The first header named name, ignoring case, or nullptr. Handlers may
+  /// edit an owning request's headers, so unlike a view it keeps no index
+  /// and always scans.
+  const header* find_header(std::string_view name) const
+  {
+    for (const header& h : headers)
+    {
+      if (header_name_equals(h.name, name))
+      {
+        return &h;
+      }
+    }
+    return nullptr;
+  }
+
+  const header* find_header(known_header name) const
+  {
+    return name == known_header::other ? nullptr : find_header(known_header_name(name));
+  }
+
+  /// The raw value of a {name} segment of the location the request was
+  /// routed to; empty if it has none.
+  std::string_view path_param(std::string_view name) const { return route.get(name, uri); }
+
+  /// The path after the routed location: empty, or starting with '/'.
+  std::string_view path_remainder() const { return route.remainder(uri); }
+
+  /// The decoded parameters of the URI's query string
+  const parameter_map& query_params() const
+  {
+    if (!query_params_)
+    {
+      query_params_.emplace(get_allocator());
+      parse_query(uri_query(uri), *query_params_);
+    }
+    return *query_params_;
+  }
+
+  /// The decoded fields of an application/x-www-form-urlencoded body. A
+  /// body with any other Content-Type has none.
+  const parameter_map& form_params() const
+  {
+    if (!form_params_)
+    {
+      form_params_.emplace(get_allocator());
+      const header* content_type = find_header(known_header::content_type);
+      if (!content_type ||
+          header_name_equals(std::string_view(content_type->value).substr(0, 33),
+                             "application/x-www-form-urlencoded"))
+      {
+        parse_query(body, *form_params_);
+      }
+    }
+    return *form_params_;
+  }
+
+  /// The cookies of every Cookie header. HTTP/2 clients may send several.
+  const parameter_map& cookies() const
+  {
+    if (!cookies_)
+    {
+      cookies_.emplace(get_allocator());
+      for (const header& h : headers)
+      {
+        if (header_name_equals(h.name, "Cookie"))
+        {
+          parse_cookies(h.value, *cookies_);
+        }
+      }
+    }
+    return *cookies_;
+  }
+
+  std::pmr::string method;
+  std::pmr::string uri;
+  int http_version_major = 0;
+  int http_version_minor = 0;
+  std::pmr::vector<header> headers;
+  std::pmr::string body;
+
+  /// Set by the session once the request is routed (router.h).
+  route_params route;
+
+private:
+  /// Parsed on first use, so handlers that never ask pay nothing. Changing
+  /// uri, headers or body afterwards does not update them.
+  mutable std::optional<parameter_map> query_params_;
+  mutable std::optional<parameter_map> form_params_;
+  mutable std::optional<parameter_map> cookies_;
 };
 
 } // namespace server
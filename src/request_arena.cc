@@ -0,0 +1,25 @@
+#include "request_arena.h"
+
+request_arena::request_arena()
+  : first_(first_block_, half_size, std::pmr::new_delete_resource()),
+    second_(second_block_, half_size, std::pmr::new_delete_resource()),
+    current_(&first_) {
+}
+
+void request_arena::release() {
+  first_.release();
+  second_.release();
+  current_ = &first_;
+}
+
+void* request_arena::do_allocate(std::size_t bytes, std::size_t alignment) {
+  return current_->allocate(bytes, alignment);
+}
+
+void request_arena::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+  // Reclaimed wholesale by release()
+}
+
+bool request_arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+  return this == &other;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+// Per-connection memory for requests and the replies built for them.
+// Allocation bumps a pointer through a block held inline in the session and
+// only falls back to the heap for requests larger than the block;
+// deallocation does nothing. Everything is freed in one step by release()
+// once the replies that used it have been written.
+//
+// The arena is split into two halves so that a pipelined request still
+// being parsed at that point survives: release() moves it into the other
+// half and frees the one it came from.
+//
+// Not thread-safe. The session only allocates from it on its strand, and
+// while a handler holds the request (even on another thread) the session
+// neither allocates from the arena nor releases it.
+class request_arena : public std::pmr::memory_resource {
+public:
+  typedef std::pmr::polymorphic_allocator<char> allocator_type;
+
+  // Bytes each half serves before spilling to the heap
+  static const std::size_t half_size = 4096;
+
+  request_arena();
+
+  request_arena(const request_arena&) = delete;
+  request_arena& operator=(const request_arena&) = delete;
+
+  allocator_type allocator() { return allocator_type(this); }
+
+  // Frees everything allocated so far except live, an allocator-aware object
+  // using this arena, which is moved into the other half first
+  template <typename T>
+  void release(T& live) {
+    std::pmr::monotonic_buffer_resource* previous = current_;
+    current_ = (current_ == &first_) ? &second_ : &first_;
+    // Rebuilt rather than assigned: assignment may keep live's old buffers
+    T moved(live, allocator());
+    std::destroy_at(&live);
+    std::construct_at(&live, std::move(moved));
+    previous->release();
+  }
+
+  // Frees everything; nothing may still point into the arena, so objects
+  // that used it must be destroyed (not merely cleared or assigned) first
+  void release();
+
+private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+  alignas(std::max_align_t) std::byte first_block_[half_size];
+  alignas(std::max_align_t) std::byte second_block_[half_size];
+  std::pmr::monotonic_buffer_resource first_;
+  std::pmr::monotonic_buffer_resource second_;
+  std::pmr::monotonic_buffer_resource* current_;
+};
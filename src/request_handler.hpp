@@ -2,9 +2,17 @@
 #define HTTP_REQUEST_HANDLER_HPP
 
 #include "request.hpp"
+#include "request_view.hpp"
 #include "reply.hpp"
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <exception>
 #include <memory>
+#include <optional>
 #include <iostream> 
+#include <string_view>
+#include <vector>
 
 namespace http {
 namespace server {
@@ -14,53 +22,100 @@ public:
     virtual ~RequestHandler() {}
     
     virtual std::unique_ptr<reply> handle_request(const request& request) = 0;
-    
+
+    // Zero-copy form of handle_request() for synchronous handlers: request
+    // points into the connection's read buffer and is only valid during the
+    // call. The default copies it into an owning request in the same arena;
+    // handlers on hot paths override this and read the views directly. Only
+    // this form may return a prebuilt reply (reply::prebuilt_reply());
+    // handle_request() returns ordinary ones, whose fields can be read.
+    virtual std::unique_ptr<reply> handle_request_view(const request_view& request) {
+        return handle_request(http::server::request(request, request.get_allocator()));
+    }
+
+    // True if the session should drive handle_request_async() rather than
+    // call handle_request() inline
+    virtual bool is_async() const { return false; }
+
+    // True if one instance can serve every request of its location. The
+    // registry then builds it once, at Init, and calls it from all io
+    // threads at once: handle_request(), handle_request_view() and
+    // handle_request_async() must keep no per-request state in members and
+    // must lock anything else they change. Handlers that keep state between
+    // calls, such as the streaming body hooks below, leave this false and
+    // get a new instance for every request.
+    virtual bool is_reusable() const { return false; }
+
+    // Coroutine form of handle_request(), run on the connection's strand.
+    // request stays valid until the coroutine completes. The default wraps
+    // the synchronous call so every handler can be awaited.
+    virtual boost::asio::awaitable<std::unique_ptr<reply>> handle_request_async(const request& request) {
+        co_return handle_request(request);
+    }
+
+    // Streaming request bodies. A handler that returns true here (also one
+    // wrapped to run on the blocking pool, whose hooks still run inline) is
+    // handed the body of each request that has one as it arrives,
+    // rather than buffered: on_headers() once the headers are parsed, then
+    // on_body_chunk() for every piece of the body in order, then
+    // on_complete() for the reply. Requests without a body still go to
+    // handle_request_view().
+    virtual bool streams_body() const { return false; }
+
+    // request.body is empty, and request is only valid during the call.
+    // Returning a reply answers the request without reading its body; the
+    // connection is closed after it if the body had not all arrived.
+    virtual std::unique_ptr<reply> on_headers(const request_view& request) {
+        return nullptr;
+    }
+
+    // chunk is only valid during the call
+    virtual void on_body_chunk(std::string_view chunk) {}
+
+    // The reply once the whole body has been passed to on_body_chunk()
+    virtual std::unique_ptr<reply> on_complete() { return nullptr; }
+
 protected:
-    // Helper method to build complete response
+    // Helper method to build complete response. Passing request.get_allocator()
+    // as alloc builds the reply in the request's arena.
     std::unique_ptr<reply> BuildResponse(reply::status_type status,
-                       const std::string& content,
-                       const std::vector<header>& headers = {}) {
+                       std::string_view content,
+                       const std::vector<header>& headers = {},
+                       const reply::allocator_type& alloc = {}) {
         try {
-            auto rep = std::make_unique<reply>();
+            auto rep = std::make_unique<reply>(alloc);
             rep->status = status;
             rep->content = content;
             
-            rep->headers = headers;
+            rep->headers.reserve(headers.size() + 2);
+            rep->headers.assign(headers.begin(), headers.end());
             
+            // One pass finds both headers the reply may still need
             bool has_content_length = false;
+            bool has_content_type = false;
             for (const auto& h : rep->headers) {
-                if (h.name == "Content-Length") {
-                    has_content_length = true;
-                    break;
-                }
+                has_content_length |= header_name_equals(h.name, "Content-Length");
+                has_content_type |= header_name_equals(h.name, "Content-Type");
             }
             
             if (!has_content_length) {
-                header content_length;
+                header content_length(alloc);
                 content_length.name = "Content-Length";
                 content_length.value = std::to_string(content.size());
-                rep->headers.push_back(content_length);
-            }
-            
-            bool has_content_type = false;
-            for (const auto& h : rep->headers) {
-                if (h.name == "Content-Type") {
-                    has_content_type = true;
-                    break;
-                }
+                rep->headers.push_back(std::move(content_length));
             }
             
             if (!has_content_type) {
-                header content_type;
+                header content_type(alloc);
                 content_type.name = "Content-Type";
                 content_type.value = "text/plain";
-                rep->headers.push_back(content_type);
+                rep->headers.push_back(std::move(content_type));
             }
             return rep;
         } catch (std::exception& e) {
             std::cerr << "BuildResponse Exception: " << e.what() << "\n";
 
-            auto rep = std::make_unique<reply>();
+            auto rep = std::make_unique<reply>(alloc);
             rep->status = reply::internal_server_error;
             rep->content = "BuildResponse() Failure: " + std::string(e.what());
             rep->headers = {{"Content-Length", std::to_string(rep->content.size())}, {"Content-Type", "text/plain"}};
@@ -68,6 +123,66 @@ protected:
             return rep;
         }
     }
+
+    // Like BuildResponse(), for a response that never changes. Build it once,
+    // when the handler is first used, and send it with
+    // reply::prebuilt_reply() so no request copies or serializes it again.
+    std::shared_ptr<const prebuilt_response> BuildPrebuiltResponse(reply::status_type status,
+                       std::string_view content,
+                       const std::vector<header>& headers = {}) {
+        return std::make_shared<const prebuilt_response>(*BuildResponse(status, content, headers));
+    }
+
+    // Like BuildResponse(), for a body streamed from body. Content-Length is
+    // set when the body's size is known; otherwise the session sends it
+    // chunked.
+    std::unique_ptr<reply> BuildStreamingResponse(reply::status_type status,
+                       std::unique_ptr<body_source> body,
+                       const std::vector<header>& headers = {},
+                       const reply::allocator_type& alloc = {}) {
+        auto rep = std::make_unique<reply>(alloc);
+        rep->status = status;
+        rep->headers.assign(headers.begin(), headers.end());
+        if (std::optional<std::size_t> size = body->size()) {
+            rep->headers.push_back({"Content-Length", std::to_string(*size)});
+        }
+        bool has_content_type = false;
+        for (const auto& h : rep->headers) {
+            has_content_type |= header_name_equals(h.name, "Content-Type");
+        }
+        if (!has_content_type) {
+            rep->headers.push_back({"Content-Type", "text/plain"});
+        }
+        rep->body = std::move(body);
+        return rep;
+    }
+};
+
+// Base for handlers that wait on timers or other asynchronous work instead
+// of blocking an io thread. Subclasses implement handle_request_async();
+// handle_request() adapts it for synchronous callers by running it to
+// completion on a private io_context.
+class AsyncRequestHandler : public RequestHandler {
+public:
+    bool is_async() const override { return true; }
+
+    boost::asio::awaitable<std::unique_ptr<reply>> handle_request_async(const request& request) override = 0;
+
+    std::unique_ptr<reply> handle_request(const request& request) override {
+        boost::asio::io_context io_context;
+        std::unique_ptr<reply> result;
+        std::exception_ptr error;
+        boost::asio::co_spawn(io_context, handle_request_async(request),
+            [&result, &error](std::exception_ptr e, std::unique_ptr<reply> rep) {
+                error = e;
+                result = std::move(rep);
+            });
+        io_context.run();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return result;
+    }
 };
 
 } // namespace server
@@ -1,10 +1,16 @@
 #include "request_handler_registry.h"
 #include <iostream>
+#include "blocking_handler.h"
+#include "compressing_handler.h"
 #include "not_found_handler.hpp"
 
 namespace http {
 namespace server {
 
+RequestHandlerRegistry::RequestHandlerRegistry()
+    : not_found_handler_(std::make_shared<NotFoundHandler>()) {
+}
+
 // Meyer's Singleton pattern to ensure the map exists when needed
 std::map<std::string, RequestHandlerFactory>& RequestHandlerRegistry::GetFactoryMap() {
     static std::map<std::string, RequestHandlerFactory> factory_map_;
@@ -17,12 +23,16 @@ bool RequestHandlerRegistry::RegisterHandler(const std::string& name, RequestHan
     return true;
 }
 
-bool RequestHandlerRegistry::Init(const std::map<std::string, HandlerConfig>& handler_configs) {
+bool RequestHandlerRegistry::Init(const std::map<std::string, HandlerConfig>& handler_configs,
+                                  std::shared_ptr<boost::asio::thread_pool> blocking_pool) {
     std::cout << "Initializing handler registry with " << handler_configs.size() << " configs" << std::endl;
     std::cout << "Available handlers: " << GetFactoryMap().size() << std::endl;
     
     // Clear existing configurations
     handler_configs_.clear();
+    locations_.clear();
+    router_ = router();
+    blocking_pool_ = std::move(blocking_pool);
     
     // Deep copy each HandlerConfig with proper handling of unique_ptr
     for (const auto& [path, config] : handler_configs) {
@@ -30,6 +40,9 @@ bool RequestHandlerRegistry::Init(const std::map<std::string, HandlerConfig>& ha
         
         HandlerConfig new_config;
         new_config.type = config.type;
+        new_config.blocking = config.blocking;
+        new_config.compression = config.compression;
+        new_config.max_body_size = config.max_body_size;
         
         // Deep copy the NginxConfig if it exists
         if (config.config) {
@@ -37,47 +50,76 @@ bool RequestHandlerRegistry::Init(const std::map<std::string, HandlerConfig>& ha
         }
         
         // Use move semantics to add to the map
-        handler_configs_[path] = std::move(new_config);
+        auto entry = handler_configs_.emplace(path, std::move(new_config)).first;
+        if (!router_.add(path, locations_.size())) {
+            std::cerr << "Error: Invalid or conflicting location: " << path << std::endl;
+            return false;
+        }
+
+        // A reusable handler is kept for every request; others are built
+        // per request, so this one is dropped
+        Location location{&entry->first, &entry->second, nullptr};
+        std::unique_ptr<RequestHandler> handler = BuildHandler(path, entry->second);
+        if (handler && handler->is_reusable()) {
+            location.shared = std::move(handler);
+        }
+        locations_.push_back(std::move(location));
     }
+    router_.compile();
     
     return true;
 }
 
-std::string RequestHandlerRegistry::FindBestMatch(const std::string& uri) const {
-    std::string best_match;
-    
-    for (const auto& [path_prefix, _] : handler_configs_) {
-        // Check if this path is a prefix of the URI
-        if (uri.compare(0, path_prefix.length(), path_prefix) == 0) {
-            // If this is a longer match than our current best, use it
-            if (path_prefix.length() > best_match.length()) {
-                best_match = path_prefix;
-            }
-        }
+const RequestHandlerRegistry::Location* RequestHandlerRegistry::Route(std::string_view uri,
+                                                                      route_params& params) const {
+    const std::size_t* index = router_.match(uri, params);
+    return index ? &locations_[*index] : nullptr;
+}
+
+size_t RequestHandlerRegistry::MaxBodySize(const Location* location, size_t default_size) const {
+    if (!location) {
+        return default_size;
     }
-    
-    return best_match;
+    size_t max_body_size = location->config->max_body_size;
+    return max_body_size > 0 ? max_body_size : default_size;
 }
 
-std::unique_ptr<RequestHandler> RequestHandlerRegistry::CreateHandler(const std::string& uri, std::string& handler_name) {
-    std::cout << "Creating handler for URI: " << uri << std::endl;
-    
-    // Find the best matching path prefix
-    std::string path_prefix = FindBestMatch(uri);
-    
+size_t RequestHandlerRegistry::MaxBodySize(std::string_view uri, size_t default_size) const {
+    route_params params;
+    return MaxBodySize(Route(uri, params), default_size);
+}
+
+std::shared_ptr<RequestHandler> RequestHandlerRegistry::CreateHandler(const Location* location,
+                                                                      std::string& handler_name) {
     // If no match found, return 404 handler
-    if (path_prefix.empty()) {
-        std::cout << "No matching path prefix found, using NotFoundHandler" << std::endl;
-        return std::make_unique<NotFoundHandler>();
+    if (!location) {
+        return not_found_handler_;
     }
     
-    std::cout << "Found matching path prefix: " << path_prefix << std::endl;
-    
-    // Get the handler config for this path
-    const auto& handler_config = handler_configs_.at(path_prefix);
-    std::cout << "Using handler type: " << handler_config.type << std::endl;
+    // Get the handler config for this location
+    const HandlerConfig& handler_config = *location->config;
     handler_name = handler_config.type; // store handler name for logging
 
+    if (location->shared) {
+        return location->shared;
+    }
+
+    std::unique_ptr<RequestHandler> handler = BuildHandler(*location->path, handler_config);
+    if (!handler) {
+        return not_found_handler_;
+    }
+    return handler;
+}
+
+std::shared_ptr<RequestHandler> RequestHandlerRegistry::CreateHandler(std::string_view uri, std::string& handler_name,
+                                                                      route_params* params) {
+    // Find the location whose segments lead the URI's path
+    route_params local_params;
+    return CreateHandler(Route(uri, params ? *params : local_params), handler_name);
+}
+
+std::unique_ptr<RequestHandler> RequestHandlerRegistry::BuildHandler(const std::string& path_prefix,
+                                                                     const HandlerConfig& handler_config) const {
     // Look up the factory in our registry
     auto& factory_map = GetFactoryMap();
     auto factory_it = factory_map.find(handler_config.type);
@@ -90,21 +132,29 @@ std::unique_ptr<RequestHandler> RequestHandlerRegistry::CreateHandler(const std:
         }
         std::cout << std::endl;
         
-        return std::make_unique<NotFoundHandler>();
+        return nullptr;
     }
     
-    std::cout << "Factory found for " << handler_config.type << std::endl;
-    
     // Create the handler using the factory function
     RequestHandler* handler = factory_it->second(path_prefix, handler_config.config.get());
     if (!handler) {
         std::cerr << "Error: Failed to create handler for " << handler_config.type << std::endl;
-        return std::make_unique<NotFoundHandler>();
+        return nullptr;
     }
     
-    std::cout << "Handler created successfully" << std::endl;
-    return std::unique_ptr<RequestHandler>(handler);
+    std::unique_ptr<RequestHandler> result(handler);
+    if (handler_config.compression.enabled) {
+        result = std::make_unique<CompressingRequestHandler>(std::move(result),
+                                                             handler_config.compression);
+    }
+
+    // Coroutine handlers already yield the io thread while they wait. Inside
+    // this wrapper, compression also runs on the pool.
+    if (handler_config.blocking && blocking_pool_ && !result->is_async()) {
+        return std::make_unique<BlockingRequestHandler>(std::move(result), blocking_pool_);
+    }
+    return result;
 }
 
 } // namespace server
-} // namespace http
\ No newline at end of file
+} // namespace http
@@ -3,10 +3,14 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <map>
 #include <functional>
+#include <vector>
+#include <boost/asio/thread_pool.hpp>
 #include "request_handler.hpp"
 #include "config_parser.h"
+#include "router.h"
 
 namespace http {
 namespace server {
@@ -20,14 +24,45 @@ typedef std::function<RequestHandler*(const std::string&, const NginxConfig*)> R
 // Registry class to create request handlers based on configuration
 class RequestHandlerRegistry {
 public:
-    RequestHandlerRegistry() {}
+    RequestHandlerRegistry();
     virtual ~RequestHandlerRegistry() {}
     
-    // Initialize the registry with handler configurations
-    bool Init(const std::map<std::string, HandlerConfig>& handler_configs);
+    // Initialize the registry with handler configurations. Handlers of
+    // "blocking on;" locations run on blocking_pool; without a pool they run
+    // inline like any other handler. Reusable handlers are built here, once
+    // per location, and the locations are compiled into a router; fails if
+    // a location is not a valid router pattern.
+    bool Init(const std::map<std::string, HandlerConfig>& handler_configs,
+              std::shared_ptr<boost::asio::thread_pool> blocking_pool = nullptr);
     
-    // Create a handler for the given request URI
-    std::unique_ptr<RequestHandler> CreateHandler(const std::string& uri, std::string& handler_name);
+    // A configured location, as Route() finds it
+    struct Location {
+        const std::string* path;
+        const HandlerConfig* config;
+        // Built at Init and shared by every request, if reusable
+        std::shared_ptr<RequestHandler> shared;
+    };
+
+    // The location uri matches, or nullptr; params receives what the URI
+    // matched (see router.h). A session routes each request once and passes
+    // the result to MaxBodySize() and CreateHandler().
+    const Location* Route(std::string_view uri, route_params& params) const;
+
+    // Get the handler of a routed location: the location's shared instance
+    // if its handler is reusable, otherwise a new one. Never null; no
+    // location, or one whose handler cannot be built, gets the
+    // NotFoundHandler.
+    std::shared_ptr<RequestHandler> CreateHandler(const Location* location, std::string& handler_name);
+
+    // Routes uri and gets its handler as above. If params is given, it
+    // receives what the URI matched.
+    std::shared_ptr<RequestHandler> CreateHandler(std::string_view uri, std::string& handler_name,
+                                                  route_params* params = nullptr);
+
+    // The largest body a routed location accepts, or default_size if there
+    // is no location or it does not set client_max_body_size
+    size_t MaxBodySize(const Location* location, size_t default_size) const;
+    size_t MaxBodySize(std::string_view uri, size_t default_size) const;
     
     // Static method to register handler factories - ensures the map exists
     static bool RegisterHandler(const std::string& name, RequestHandlerFactory factory);
@@ -38,9 +73,21 @@ public:
 private:
     // Map of URI prefixes to handler configs
     std::map<std::string, HandlerConfig> handler_configs_;
-    
-    // Find the best matching path prefix for a URI
-    std::string FindBestMatch(const std::string& uri) const;
+
+    // Runs the handlers of blocking locations
+    std::shared_ptr<boost::asio::thread_pool> blocking_pool_;
+
+    // One per entry of handler_configs_, indexed by the router's values
+    std::vector<Location> locations_;
+    router router_;
+
+    // Answers requests that match no location
+    std::shared_ptr<RequestHandler> not_found_handler_;
+
+    // Build the handler of the location at path_prefix, wrapped as its
+    // config asks; nullptr if it cannot be created
+    std::unique_ptr<RequestHandler> BuildHandler(const std::string& path_prefix,
+                                                 const HandlerConfig& handler_config) const;
 };
 
 } // namespace server
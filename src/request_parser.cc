@@ -10,46 +10,296 @@
 
 #include "request_parser.hpp"
 #include "request.hpp"
+#include <array>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace http {
 namespace server {
 
-request_parser::request_parser()
-  : state_(method_start)
+namespace {
+
+/// The first byte of [begin, end) that ends a run of URI or header value
+/// bytes: a control character, DEL, or (with stop_at_space, for the URI) a
+/// space. Bytes from 0x80 up belong to the run, as they do for consume().
+const char* find_field_end(const char* begin, const char* end, bool stop_at_space)
+{
+  const unsigned char limit = stop_at_space ? 0x20 : 0x1f;
+#if defined(__AVX2__)
+  const __m256i limit_32 = _mm256_set1_epi8(static_cast<char>(limit));
+  const __m256i del_32 = _mm256_set1_epi8(0x7f);
+  while (end - begin >= 32)
+  {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    // max(byte, limit) == limit exactly when byte <= limit, unsigned
+    __m256i low = _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, limit_32), limit_32);
+    __m256i del = _mm256_cmpeq_epi8(bytes, del_32);
+    unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(low, del));
+    if (mask != 0)
+      return begin + __builtin_ctz(mask);
+    begin += 32;
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i limit_16 = _mm_set1_epi8(static_cast<char>(limit));
+  const __m128i del_16 = _mm_set1_epi8(0x7f);
+  while (end - begin >= 16)
+  {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    __m128i low = _mm_cmpeq_epi8(_mm_max_epu8(bytes, limit_16), limit_16);
+    __m128i del = _mm_cmpeq_epi8(bytes, del_16);
+    unsigned mask = _mm_movemask_epi8(_mm_or_si128(low, del));
+    if (mask != 0)
+      return begin + __builtin_ctz(mask);
+    begin += 16;
+  }
+#endif
+  for (; begin != end; ++begin)
+  {
+    unsigned char c = *begin;
+    if (c <= limit || c == 0x7f)
+      return begin;
+  }
+  return begin;
+}
+
+/// The first byte of [begin, end) that is not a token byte, as a method or
+/// header name is made of: 0x21 to 0x7e less the separators. The vector
+/// loops test the printable range and the separators' ranges together, as
+/// signed bytes so that 0x80 and up fall outside every range.
+const char* find_token_bytes_end(const char* begin, const char* end)
+{
+#if defined(__AVX2__)
+  // lo <= bytes <= hi, for lo > 0 and hi < 0x7f
+  auto in_range_32 = [](__m256i bytes, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(lo - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), bytes));
+  };
+  auto equal_32 = [](__m256i bytes, char c) {
+    return _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(c));
+  };
+  while (end - begin >= 32)
+  {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    __m256i printable = in_range_32(bytes, 0x21, 0x7e);
+    __m256i separator = _mm256_or_si256(
+        _mm256_or_si256(_mm256_or_si256(in_range_32(bytes, '(', ')'), in_range_32(bytes, ':', '@')),
+                        _mm256_or_si256(in_range_32(bytes, '[', ']'), equal_32(bytes, '"'))),
+        _mm256_or_si256(_mm256_or_si256(equal_32(bytes, ','), equal_32(bytes, '/')),
+                        _mm256_or_si256(equal_32(bytes, '{'), equal_32(bytes, '}'))));
+    unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_andnot_si256(separator, printable)));
+    if (mask != 0)
+      return begin + __builtin_ctz(mask);
+    begin += 32;
+  }
+#endif
+#if defined(__SSE2__)
+  auto in_range_16 = [](__m128i bytes, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(lo - 1)),
+                         _mm_cmplt_epi8(bytes, _mm_set1_epi8(hi + 1)));
+  };
+  auto equal_16 = [](__m128i bytes, char c) {
+    return _mm_cmpeq_epi8(bytes, _mm_set1_epi8(c));
+  };
+  while (end - begin >= 16)
+  {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    __m128i printable = in_range_16(bytes, 0x21, 0x7e);
+    __m128i separator = _mm_or_si128(
+        _mm_or_si128(_mm_or_si128(in_range_16(bytes, '(', ')'), in_range_16(bytes, ':', '@')),
+                     _mm_or_si128(in_range_16(bytes, '[', ']'), equal_16(bytes, '"'))),
+        _mm_or_si128(_mm_or_si128(equal_16(bytes, ','), equal_16(bytes, '/')),
+                     _mm_or_si128(equal_16(bytes, '{'), equal_16(bytes, '}'))));
+    unsigned mask = ~_mm_movemask_epi8(_mm_andnot_si128(separator, printable)) & 0xffff;
+    if (mask != 0)
+      return begin + __builtin_ctz(mask);
+    begin += 16;
+  }
+#endif
+  return begin;
+}
+
+} // namespace
+
+request_parser::request_parser(const request_limits& limits)
+  : limits_(limits)
 {
+  reset();
 }
 
 void request_parser::reset()
 {
   state_ = method_start;
+  offset_ = 0;
+  error_ = malformed;
+  method_ = span();
+  uri_ = span();
+  http_version_major_ = 0;
+  http_version_minor_ = 0;
+  headers_.clear();
+  folded_values_.clear();
+  raw_.clear();
+}
+
+void request_parser::view(request_view& req, const char* request_begin) const
+{
+  auto field = [request_begin](const span& s) {
+    return std::string_view(request_begin + s.begin, s.end - s.begin);
+  };
+
+  req.method_name = field(method_);
+  req.method = to_request_method(req.method_name);
+  req.uri = field(uri_);
+  req.http_version_major = http_version_major_;
+  req.http_version_minor = http_version_minor_;
+  req.headers.clear();
+  req.header_index.fill(0);
+  for (const header_span& h : headers_)
+  {
+    std::string_view value = h.folded < 0 ? field(h.value) : std::string_view(folded_values_[h.folded]);
+    req.headers.push_back({field(h.name), value});
+    if (h.known != known_header::other && req.headers.size() <= UINT16_MAX)
+    {
+      std::uint16_t& slot = req.header_index[static_cast<std::size_t>(h.known)];
+      if (slot == 0)
+      {
+        slot = static_cast<std::uint16_t>(req.headers.size());
+      }
+    }
+  }
 }
 
-bool request_parser::parse_request_body(const char* data, size_t data_length, 
-                                      std::string& body, size_t content_length) {
-  // Look for the end of headers (double CRLF: \r\n\r\n)
-  const char* body_start = nullptr;
-  for (size_t i = 0; i < data_length - 3; ++i) {
-    if (data[i] == '\r' && data[i+1] == '\n' && data[i+2] == '\r' && data[i+3] == '\n') {
-      body_start = data + i + 4; // Point to the first byte after \r\n\r\n
+void request_parser::assign(request& req) const
+{
+  request_view parsed;
+  view(parsed, raw_.data());
+  req.method = parsed.method_name;
+  req.uri = parsed.uri;
+  req.http_version_major = parsed.http_version_major;
+  req.http_version_minor = parsed.http_version_minor;
+  req.headers.clear();
+  for (const header_view& h : parsed.headers)
+  {
+    req.headers.emplace_back(h.name, h.value);
+  }
+}
+
+std::tuple<request_parser::result_type, const char*> request_parser::parse(
+    const char* request_begin, const char* begin, const char* end)
+{
+  while (begin != end)
+  {
+    begin = skip_field_bytes(begin, end);
+    if (!within_limits())
+      return std::make_tuple(bad, begin);
+    if (begin == end)
       break;
+    result_type result = consume(request_begin, *begin++);
+    if (result == good || result == bad)
+      return std::make_tuple(result, begin);
+  }
+  return std::make_tuple(indeterminate, begin);
+}
+
+const char* request_parser::skip_field_bytes(const char* begin, const char* end)
+{
+  span* field;
+  const char* run_end;
+  switch (state_)
+  {
+  case method:
+    field = &method_;
+    run_end = find_token_end(begin, end);
+    break;
+  case uri:
+    field = &uri_;
+    run_end = find_field_end(begin, end, true);
+    break;
+  case header_name:
+    field = &headers_.back().name;
+    run_end = find_token_end(begin, end);
+    break;
+  case header_value:
+    // A folded value is being copied; consume() appends it byte by byte
+    if (headers_.back().folded >= 0)
+      return begin;
+    field = &headers_.back().value;
+    run_end = find_field_end(begin, end, false);
+    break;
+  default:
+    return begin;
+  }
+
+  // The same as extend() for every byte of the run
+  if (run_end != begin)
+  {
+    if (field->begin == field->end)
+    {
+      field->begin = offset_;
     }
+    offset_ += run_end - begin;
+    field->end = offset_;
+  }
+  return run_end;
+}
+
+bool request_parser::within_limits()
+{
+  if (uri_.end - uri_.begin > limits_.max_uri_length)
+  {
+    error_ = uri_too_long;
+    return false;
   }
-  
-  // If we found the body start and there's data available
-  if (body_start && body_start < data + data_length) {
-    // Calculate available body length (might be less than content_length)
-    size_t available_length = std::min(content_length, static_cast<size_t>(data + data_length - body_start));
-    
-    // Assign the body data
-    body.assign(body_start, available_length);
+  if (headers_.empty())
+  {
     return true;
   }
-  
-  return false;
+  const header_span& h = headers_.back();
+  std::size_t value_length = h.folded < 0 ? h.value.end - h.value.begin : folded_values_[h.folded].size();
+  if (headers_.size() > limits_.max_header_count ||
+      h.name.end - h.name.begin + value_length > limits_.max_header_line)
+  {
+    error_ = header_fields_too_large;
+    return false;
+  }
+  return true;
+}
+
+const char* request_parser::find_token_end(const char* begin, const char* end)
+{
+  static const std::array<bool, 256> token = [] {
+    std::array<bool, 256> bytes{};
+    for (int c = 0; c < 256; ++c)
+    {
+      // Classified as consume() sees the byte, as a (possibly signed) char
+      int input = static_cast<char>(c);
+      bytes[c] = is_char(input) && !is_ctl(input) && !is_tspecial(input);
+    }
+    return bytes;
+  }();
+  begin = find_token_bytes_end(begin, end);
+  while (begin != end && token[static_cast<unsigned char>(*begin)])
+  {
+    ++begin;
+  }
+  return begin;
 }
 
-request_parser::result_type request_parser::consume(request& req, char input)
+void request_parser::extend(span& field) const
 {
+  std::size_t position = offset_ - 1;
+  if (field.begin == field.end)
+  {
+    field.begin = position;
+  }
+  field.end = position + 1;
+}
+
+request_parser::result_type request_parser::consume(const char* request_begin, char input)
+{
+  ++offset_;
   switch (state_)
   {
   case method_start:
@@ -60,7 +310,7 @@ request_parser::result_type request_parser::consume(request& req, char input)
     else
     {
       state_ = method;
-      req.method.push_back(input);
+      extend(method_);
       return indeterminate;
     }
   case method:
@@ -75,7 +325,7 @@ request_parser::result_type request_parser::consume(request& req, char input)
     }
     else
     {
-      req.method.push_back(input);
+      extend(method_);
       return indeterminate;
     }
   case uri:
@@ -90,7 +340,7 @@ request_parser::result_type request_parser::consume(request& req, char input)
     }
     else
     {
-      req.uri.push_back(input);
+      extend(uri_);
       return indeterminate;
     }
   case http_version_h:
@@ -136,8 +386,8 @@ request_parser::result_type request_parser::consume(request& req, char input)
   case http_version_slash:
     if (input == '/')
     {
-      req.http_version_major = 0;
-      req.http_version_minor = 0;
+      http_version_major_ = 0;
+      http_version_minor_ = 0;
       state_ = http_version_major_start;
       return indeterminate;
     }
@@ -148,7 +398,7 @@ request_parser::result_type request_parser::consume(request& req, char input)
   case http_version_major_start:
     if (is_digit(input))
     {
-      req.http_version_major = req.http_version_major * 10 + input - '0';
+      http_version_major_ = http_version_major_ * 10 + input - '0';
       state_ = http_version_major;
       return indeterminate;
     }
@@ -164,7 +414,7 @@ request_parser::result_type request_parser::consume(request& req, char input)
     }
     else if (is_digit(input))
     {
-      req.http_version_major = req.http_version_major * 10 + input - '0';
+      http_version_major_ = http_version_major_ * 10 + input - '0';
       return indeterminate;
     }
     else
@@ -174,7 +424,7 @@ request_parser::result_type request_parser::consume(request& req, char input)
   case http_version_minor_start:
     if (is_digit(input))
     {
-      req.http_version_minor = req.http_version_minor * 10 + input - '0';
+      http_version_minor_ = http_version_minor_ * 10 + input - '0';
       state_ = http_version_minor;
       return indeterminate;
     }
@@ -190,7 +440,7 @@ request_parser::result_type request_parser::consume(request& req, char input)
     }
     else if (is_digit(input))
     {
-      req.http_version_minor = req.http_version_minor * 10 + input - '0';
+      http_version_minor_ = http_version_minor_ * 10 + input - '0';
       return indeterminate;
     }
     else
@@ -213,7 +463,7 @@ request_parser::result_type request_parser::consume(request& req, char input)
       state_ = expecting_newline_3;
       return indeterminate;
     }
-    else if (!req.headers.empty() && (input == ' ' || input == '\t'))
+    else if (!headers_.empty() && (input == ' ' || input == '\t'))
     {
       state_ = header_lws;
       return indeterminate;
@@ -224,8 +474,8 @@ request_parser::result_type request_parser::consume(request& req, char input)
     }
     else
     {
-      req.headers.push_back(header());
-      req.headers.back().name.push_back(input);
+      headers_.push_back(header_span());
+      extend(headers_.back().name);
       state_ = header_name;
       return indeterminate;
     }
@@ -245,13 +495,24 @@ request_parser::result_type request_parser::consume(request& req, char input)
     }
     else
     {
+      // A folded value is no longer contiguous; join its lines from here on
+      header_span& folded = headers_.back();
+      if (folded.folded < 0)
+      {
+        folded.folded = static_cast<int>(folded_values_.size());
+        folded_values_.emplace_back(request_begin + folded.value.begin,
+                                    folded.value.end - folded.value.begin);
+      }
+      folded_values_[folded.folded].push_back(input);
       state_ = header_value;
-      req.headers.back().value.push_back(input);
       return indeterminate;
     }
   case header_name:
     if (input == ':')
     {
+      // Classify the name once, here, so views can index it for free
+      header_span& h = headers_.back();
+      h.known = to_known_header(std::string_view(request_begin + h.name.begin, h.name.end - h.name.begin));
       state_ = space_before_header_value;
       return indeterminate;
     }
@@ -261,7 +522,7 @@ request_parser::result_type request_parser::consume(request& req, char input)
     }
     else
     {
-      req.headers.back().name.push_back(input);
+      extend(headers_.back().name);
       return indeterminate;
     }
   case space_before_header_value:
@@ -284,9 +545,14 @@ request_parser::result_type request_parser::consume(request& req, char input)
     {
       return bad;
     }
+    else if (headers_.back().folded >= 0)
+    {
+      folded_values_[headers_.back().folded].push_back(input);
+      return indeterminate;
+    }
     else
     {
-      req.headers.back().value.push_back(input);
+      extend(headers_.back().value);
       return indeterminate;
     }
   case expecting_newline_2:
@@ -14,18 +14,37 @@
 #include <tuple>
 #include <string>
 #include <cstddef>
+#include <iterator>
+#include <vector>
+#include "request.hpp"
+#include "request_view.hpp"
 
 namespace http {
 namespace server {
 
-struct request;
+/// Bounds on a request's line and headers, checked as they are parsed so an
+/// oversized request is refused before it is buffered whole.
+struct request_limits
+{
+  /// Longest request URI
+  std::size_t max_uri_length = 8 * 1024;
+
+  /// Most header fields
+  std::size_t max_header_count = 100;
+
+  /// Longest single header, name and value together
+  std::size_t max_header_line = 8 * 1024;
+};
 
-/// Parser for incoming requests.
+/// Parser for incoming requests. Rather than copying each field out as it
+/// goes, the parser records where the fields lie relative to the first byte
+/// of the request, so the bytes may move between calls (a session compacts
+/// its read buffer) and the finished request can be viewed in place.
 class request_parser
 {
 public:
   /// Construct ready to parse the request method.
-  request_parser();
+  explicit request_parser(const request_limits& limits = request_limits());
 
   /// Reset to initial parser state.
   void reset();
@@ -33,28 +52,67 @@ public:
   /// Result of parse.
   enum result_type { good, bad, indeterminate };
 
-  /// Parse some data. The enum return value is good when a complete request has
-  /// been parsed, bad if the data is invalid, indeterminate when more data is
-  /// required. The InputIterator return value indicates how much of the input
-  /// has been consumed.
-  template <typename InputIterator>
-  std::tuple<result_type, InputIterator> parse(request& req,
-      InputIterator begin, InputIterator end)
+  /// Why parse() last returned bad: a syntax error, or a request that broke
+  /// one of the limits.
+  enum error_type { malformed, uri_too_long, header_fields_too_large };
+
+  error_type error() const { return error_; }
+
+  /// Parse some data of the request whose first byte is at request_begin;
+  /// [begin, end) continues from where the previous call stopped. The enum
+  /// return value is good when the request line and headers are complete,
+  /// bad if the data is invalid, indeterminate when more data is required.
+  /// The pointer return value indicates how much of the input has been
+  /// consumed. Runs of method, URI, header name and header value bytes are
+  /// scanned 16 or 32 bytes at a time; everything else, including the byte
+  /// that ends each run, goes through the byte-at-a-time state machine, so
+  /// the result is the same as feeding it every byte.
+  std::tuple<result_type, const char*> parse(const char* request_begin,
+      const char* begin, const char* end);
+
+  /// Points req at what has been parsed so far of the request at
+  /// request_begin; after good that is everything but the body. The view
+  /// stays valid until those bytes move or the parser is reset.
+  void view(request_view& req, const char* request_begin) const;
+
+  /// Parse some data into an owning request, copying every field. For
+  /// callers that do not keep the bytes they parse.
+  template <typename ForwardIterator>
+  std::tuple<result_type, ForwardIterator> parse(request& req,
+      ForwardIterator begin, ForwardIterator end)
   {
-    while (begin != end)
-    {
-      result_type result = consume(req, *begin++);
-      if (result == good || result == bad)
-        return std::make_tuple(result, begin);
-    }
-    return std::make_tuple(indeterminate, begin);
+    std::size_t parsed = raw_.size();
+    raw_.append(begin, end);
+    const char* start = raw_.data() + parsed;
+    auto [result, stop] = parse(raw_.data(), start, raw_.data() + raw_.size());
+    std::size_t consumed = stop - start;
+
+    // Bytes past the end of the headers are left to the caller
+    raw_.resize(parsed + consumed);
+    assign(req);
+    return std::make_tuple(result, std::next(begin, consumed));
   }
 
-  bool parse_request_body(const char* data, size_t data_length, std::string& body, size_t content_length);
-
 private:
   /// Handle the next character of input.
-  result_type consume(request& req, char input);
+  result_type consume(const char* request_begin, char input);
+
+  /// In a state that only extends a field, takes the bytes from begin up to
+  /// the first one consume() would treat differently and returns where it
+  /// stopped.
+  const char* skip_field_bytes(const char* begin, const char* end);
+
+  /// The first byte of [begin, end) that cannot be part of a method or
+  /// header name.
+  static const char* find_token_end(const char* begin, const char* end);
+
+  /// Returns false, setting error_, once the fields parsed so far break a
+  /// limit. Only the URI and the latest header can have grown since the
+  /// last check.
+  bool within_limits();
+
+  /// Copies what has been parsed so far from raw_ into req.
+  void assign(request& req) const;
 
   /// Check if a byte is an HTTP character.
   static bool is_char(int c);
@@ -92,6 +150,42 @@ private:
     expecting_newline_2,
     expecting_newline_3
   } state_;
+
+  /// Where a field lies, as offsets from the first byte of the request.
+  struct span
+  {
+    std::size_t begin = 0;
+    std::size_t end = 0;
+  };
+
+  /// A header whose value was folded over several lines has no single span;
+  /// its joined value is kept in folded_values_ instead.
+  struct header_span
+  {
+    span name;
+    span value;
+    int folded = -1;
+    known_header known = known_header::other;
+  };
+
+  /// Extends field to cover the byte just consumed.
+  void extend(span& field) const;
+
+  /// Bytes consumed since the last reset.
+  std::size_t offset_;
+
+  request_limits limits_;
+  error_type error_;
+
+  span method_;
+  span uri_;
+  int http_version_major_;
+  int http_version_minor_;
+  std::vector<header_span> headers_;
+  std::vector<std::string> folded_values_;
+
+  /// The bytes parsed so far by the owning-request form of parse().
+  std::string raw_;
 };
 
 } // namespace server
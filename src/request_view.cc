@@ -0,0 +1,185 @@
+#include "request_view.hpp"
+#include "request.hpp"
+#include <algorithm>
+
+namespace http {
+namespace server {
+
+request_method to_request_method(std::string_view name)
+{
+  switch (name.size())
+  {
+  case 3:
+    if (name == "GET") return request_method::get;
+    if (name == "PUT") return request_method::put;
+    break;
+  case 4:
+    if (name == "HEAD") return request_method::head;
+    if (name == "POST") return request_method::post;
+    break;
+  case 5:
+    if (name == "PATCH") return request_method::patch;
+    break;
+  case 6:
+    if (name == "DELETE") return request_method::delete_;
+    break;
+  case 7:
+    if (name == "OPTIONS") return request_method::options;
+    break;
+  }
+  return request_method::other;
+}
+
+namespace {
+
+constexpr std::string_view known_header_names[known_header_count] = {
+  "Host",
+  "Connection",
+  "Content-Length",
+  "Content-Type",
+  "Transfer-Encoding",
+  "Accept-Encoding",
+  "Cookie",
+  "Upgrade",
+  "HTTP2-Settings",
+  "Expect",
+  "Authorization",
+};
+
+char to_lower(char c)
+{
+  return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+} // namespace
+
+bool header_name_equals(std::string_view a, std::string_view b)
+{
+  if (a.size() != b.size())
+  {
+    return false;
+  }
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    if (to_lower(a[i]) != to_lower(b[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+known_header to_known_header(std::string_view name)
+{
+  switch (name.size())
+  {
+  case 4:
+    if (header_name_equals(name, "Host")) return known_header::host;
+    break;
+  case 6:
+    if (header_name_equals(name, "Cookie")) return known_header::cookie;
+    if (header_name_equals(name, "Expect")) return known_header::expect;
+    break;
+  case 7:
+    if (header_name_equals(name, "Upgrade")) return known_header::upgrade;
+    break;
+  case 10:
+    if (header_name_equals(name, "Connection")) return known_header::connection;
+    break;
+  case 12:
+    if (header_name_equals(name, "Content-Type")) return known_header::content_type;
+    break;
+  case 13:
+    if (header_name_equals(name, "Authorization")) return known_header::authorization;
+    break;
+  case 14:
+    if (header_name_equals(name, "Content-Length")) return known_header::content_length;
+    if (header_name_equals(name, "HTTP2-Settings")) return known_header::http2_settings;
+    break;
+  case 15:
+    if (header_name_equals(name, "Accept-Encoding")) return known_header::accept_encoding;
+    break;
+  case 17:
+    if (header_name_equals(name, "Transfer-Encoding")) return known_header::transfer_encoding;
+    break;
+  }
+  return known_header::other;
+}
+
+std::string_view known_header_name(known_header name)
+{
+  if (name == known_header::other)
+  {
+    return std::string_view();
+  }
+  return known_header_names[static_cast<std::size_t>(name)];
+}
+
+const header_view* request_view::find_header(known_header name) const
+{
+  if (name == known_header::other)
+  {
+    return nullptr;
+  }
+  std::uint16_t slot = header_index[static_cast<std::size_t>(name)];
+  // A stale index past the end means headers shrank without index_headers()
+  return slot == 0 || slot > headers.size() ? nullptr : &headers[slot - 1];
+}
+
+const header_view* request_view::find_header(std::string_view name) const
+{
+  known_header known = to_known_header(name);
+  if (known != known_header::other)
+  {
+    return find_header(known);
+  }
+  for (const header_view& h : headers)
+  {
+    if (header_name_equals(h.name, name))
+    {
+      return &h;
+    }
+  }
+  return nullptr;
+}
+
+void request_view::index_headers()
+{
+  header_index.fill(0);
+  // Positions past the slot range cannot be indexed; such requests are
+  // far beyond any header limit
+  std::size_t count = std::min<std::size_t>(headers.size(), UINT16_MAX);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    known_header known = to_known_header(headers[i].name);
+    if (known != known_header::other)
+    {
+      std::uint16_t& slot = header_index[static_cast<std::size_t>(known)];
+      if (slot == 0)
+      {
+        slot = static_cast<std::uint16_t>(i + 1);
+      }
+    }
+  }
+}
+
+request_view::request_view(const request& req, const allocator_type& alloc)
+  : method(to_request_method(req.method)),
+    method_name(req.method),
+    uri(req.uri),
+    http_version_major(req.http_version_major),
+    http_version_minor(req.http_version_minor),
+    headers(alloc),
+    body(req.body),
+    route(req.route)
+{
+  headers.reserve(req.headers.size());
+  for (const header& h : req.headers)
+  {
+    headers.push_back({h.name, h.value});
+  }
+  index_headers();
+}
+
+} // namespace server
+} // namespace http
@@ -0,0 +1,130 @@
+#ifndef HTTP_REQUEST_VIEW_HPP
+#define HTTP_REQUEST_VIEW_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+#include "router.h"
+
+namespace http {
+namespace server {
+
+struct request;
+
+/// Request methods the server tells apart. Any other token decodes to other
+/// and is still available as request_view::method_name.
+enum class request_method
+{
+  get,
+  head,
+  post,
+  put,
+  delete_,
+  options,
+  patch,
+  other
+};
+
+/// Decodes a method token. Methods are case-sensitive, so "get" is other.
+request_method to_request_method(std::string_view name);
+
+/// Headers the server itself reads. The parser classifies them as it reads
+/// each name, so a request_view finds them without scanning.
+enum class known_header
+{
+  host,
+  connection,
+  content_length,
+  content_type,
+  transfer_encoding,
+  accept_encoding,
+  cookie,
+  upgrade,
+  http2_settings,
+  expect,
+  authorization,
+  other
+};
+
+constexpr std::size_t known_header_count = static_cast<std::size_t>(known_header::other);
+
+/// Classifies a header name. Header names are case-insensitive.
+known_header to_known_header(std::string_view name);
+
+/// The usual spelling of a known header's name; empty for other.
+std::string_view known_header_name(known_header name);
+
+/// Compares header names, ignoring ASCII case.
+bool header_name_equals(std::string_view a, std::string_view b);
+
+/// A header whose name and value point into the bytes it was parsed from.
+struct header_view
+{
+  std::string_view name;
+  std::string_view value;
+};
+
+/// A request as it was parsed, without copying: method, URI, headers and
+/// body point into the connection's read buffer, so a view is only valid
+/// while the session is handling that request. Handlers that keep the
+/// request longer (async handlers, HTTP/2 streams) get an owning request
+/// (request.hpp) instead.
+struct request_view
+{
+  typedef std::pmr::polymorphic_allocator<char> allocator_type;
+
+  request_view() = default;
+
+  /// The header list is the only part of a view that allocates.
+  explicit request_view(const allocator_type& alloc)
+    : headers(alloc)
+  {
+  }
+
+  /// Views the fields of an owning request, which must outlive the view.
+  explicit request_view(const request& req, const allocator_type& alloc = {});
+
+  allocator_type get_allocator() const { return headers.get_allocator(); }
+
+  /// The first header with a known name, or nullptr, in constant time.
+  const header_view* find_header(known_header name) const;
+
+  /// The first header named name, ignoring case, or nullptr. Known names go
+  /// through header_index; any other name scans the headers.
+  const header_view* find_header(std::string_view name) const;
+
+  /// Rebuilds header_index from headers. The parser and the constructor
+  /// from a request keep it current; code that fills in headers by hand
+  /// calls this afterwards.
+  void index_headers();
+
+  /// The raw value of a {name} segment of the location the request was
+  /// routed to; empty if it has none.
+  std::string_view path_param(std::string_view name) const { return route.get(name, uri); }
+
+  /// The path after the routed location: empty, or starting with '/'.
+  std::string_view path_remainder() const { return route.remainder(uri); }
+
+  request_method method = request_method::other;
+  std::string_view method_name;
+  std::string_view uri;
+  int http_version_major = 0;
+  int http_version_minor = 0;
+  std::pmr::vector<header_view> headers;
+  std::string_view body;
+
+  /// For each known_header, one past the position in headers of its first
+  /// occurrence, or 0 if the request has none.
+  std::array<std::uint16_t, known_header_count> header_index{};
+
+  /// Set by the session once the request is routed (router.h).
+  route_params route;
+};
+
+} // namespace server
+} // namespace http
+
+#endif // HTTP_REQUEST_VIEW_HPP
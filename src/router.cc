@@ -0,0 +1,223 @@
+#include "router.h"
+#include "url_decoding.h"
+
+namespace http {
+namespace server {
+
+std::string_view route_params::get(std::string_view name, std::string_view uri) const {
+  for (std::size_t i = 0; i < size_; ++i) {
+    if (params_[i].name == name) {
+      return uri.substr(params_[i].offset, params_[i].length);
+    }
+  }
+  return std::string_view();
+}
+
+std::string_view route_params::remainder(std::string_view uri) const {
+  return matched_ ? uri.substr(remainder_offset_, remainder_length_) : std::string_view();
+}
+
+// A literal node's label is one or more whole segments, each with its
+// leading '/'. Siblings never share their first segment, since add() gives
+// each segment one node and compile() only merges a node with an only child.
+// A {name} node matches one segment of any value and has no label.
+struct router::node {
+  std::string label;
+  std::vector<std::unique_ptr<node>> children;
+  std::unique_ptr<node> param;
+  std::string param_name;
+  bool terminal = false;
+  std::size_t value = 0;
+};
+
+namespace {
+
+// Segment boundaries: the end of the path or a '/'
+bool at_boundary(std::string_view path, std::size_t pos) {
+  return pos == path.size() || path[pos] == '/';
+}
+
+bool is_param(std::string_view segment) {
+  return segment.size() > 2 && segment.front() == '{' && segment.back() == '}';
+}
+
+} // namespace
+
+router::router() : root_(std::make_unique<node>()) {}
+router::~router() = default;
+router::router(router&&) noexcept = default;
+router& router::operator=(router&&) noexcept = default;
+
+bool router::valid_pattern(std::string_view pattern) {
+  if (pattern.empty() || pattern[0] != '/') {
+    return false;
+  }
+  if (pattern == "/") {
+    return true;
+  }
+  std::size_t params = 0;
+  std::size_t pos = 0;
+  while (pos < pattern.size()) {
+    std::size_t end = pattern.find('/', pos + 1);
+    if (end == std::string_view::npos) {
+      end = pattern.size();
+    }
+    std::string_view segment = pattern.substr(pos + 1, end - pos - 1);
+    if (segment.empty()) {
+      return false;
+    }
+    if (segment.find_first_of("{}") != std::string_view::npos) {
+      if (!is_param(segment) ||
+          segment.substr(1, segment.size() - 2).find_first_of("{}") != std::string_view::npos ||
+          ++params > route_params::max_params) {
+        return false;
+      }
+    }
+    pos = end;
+  }
+  return true;
+}
+
+bool router::add(std::string_view pattern, std::size_t value) {
+  if (!valid_pattern(pattern)) {
+    return false;
+  }
+  node* current = root_.get();
+  std::size_t pos = pattern == "/" ? pattern.size() : 0;
+  while (pos < pattern.size()) {
+    std::size_t end = pattern.find('/', pos + 1);
+    if (end == std::string_view::npos) {
+      end = pattern.size();
+    }
+    std::string_view segment = pattern.substr(pos + 1, end - pos - 1);
+    std::string_view label = pattern.substr(pos, end - pos);
+    pos = end;
+
+    if (is_param(segment)) {
+      std::string_view name = segment.substr(1, segment.size() - 2);
+      if (!current->param) {
+        current->param = std::make_unique<node>();
+        current->param->param_name = name;
+      } else if (current->param->param_name != name) {
+        return false;
+      }
+      current = current->param.get();
+      continue;
+    }
+
+    node* next = nullptr;
+    for (const auto& child : current->children) {
+      if (child->label == label) {
+        next = child.get();
+        break;
+      }
+    }
+    if (!next) {
+      current->children.push_back(std::make_unique<node>());
+      next = current->children.back().get();
+      next->label = label;
+    }
+    current = next;
+  }
+
+  if (current->terminal) {
+    return false;
+  }
+  current->terminal = true;
+  current->value = value;
+  return true;
+}
+
+namespace {
+
+template <typename Node>
+void compress(Node& n, bool literal) {
+  // A literal node that is not a location and leads only to one literal
+  // takes over that child's label and everything under it
+  while (literal && !n.terminal && !n.param && n.children.size() == 1) {
+    std::unique_ptr<Node> child = std::move(n.children.front());
+    n.label += child->label;
+    n.children = std::move(child->children);
+    n.param = std::move(child->param);
+    n.terminal = child->terminal;
+    n.value = child->value;
+  }
+  for (const auto& child : n.children) {
+    compress(*child, true);
+  }
+  if (n.param) {
+    compress(*n.param, false);
+  }
+}
+
+} // namespace
+
+void router::compile() {
+  // The root matches no label of its own, so it is never merged
+  compress(*root_, false);
+}
+
+namespace {
+
+// Matches path from pos, a boundary just past n's label: deeper locations
+// first, literals before {name}, and n itself if nothing below matches
+template <typename Node, typename Push, typename Pop, typename Done>
+const Node* match_node(const Node& n, std::string_view path, std::size_t pos,
+                       Push push, Pop pop, Done done) {
+  if (pos < path.size()) {
+    std::size_t end = path.find('/', pos + 1);
+    if (end == std::string_view::npos) {
+      end = path.size();
+    }
+    for (const auto& child : n.children) {
+      const std::string& label = child->label;
+      if (path.compare(pos, label.size(), label) == 0 && at_boundary(path, pos + label.size())) {
+        if (const Node* found = match_node(*child, path, pos + label.size(), push, pop, done)) {
+          return found;
+        }
+      }
+    }
+    if (n.param && end > pos + 1 && push(n.param->param_name, pos + 1, end - pos - 1)) {
+      if (const Node* found = match_node(*n.param, path, end, push, pop, done)) {
+        return found;
+      }
+      pop();
+    }
+  }
+  if (n.terminal) {
+    done(pos);
+    return &n;
+  }
+  return nullptr;
+}
+
+} // namespace
+
+const std::size_t* router::match(std::string_view uri, route_params& params) const {
+  params.clear();
+  std::string_view path = uri_path(uri);
+  if (path.empty() || path[0] != '/') {
+    return nullptr;
+  }
+
+  auto push = [&params](std::string_view name, std::size_t offset, std::size_t length) {
+    if (params.size_ == route_params::max_params) {
+      return false;
+    }
+    params.params_[params.size_++] = {name, static_cast<std::uint32_t>(offset),
+                                      static_cast<std::uint32_t>(length)};
+    return true;
+  };
+  auto pop = [&params]() { --params.size_; };
+  auto done = [&params, &path](std::size_t pos) {
+    params.matched_ = true;
+    params.remainder_offset_ = static_cast<std::uint32_t>(pos);
+    params.remainder_length_ = static_cast<std::uint32_t>(path.size() - pos);
+  };
+
+  const node* found = match_node(*root_, path, 0, push, pop, done);
+  return found ? &found->value : nullptr;
+}
+
+} // namespace server
+} // namespace http
@@ -0,0 +1,96 @@
+#ifndef HTTP_ROUTER_H
+#define HTTP_ROUTER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace http {
+namespace server {
+
+// What a request's path matched: the value of each {name} segment of its
+// location, and where the location ended. Values are kept as offsets into
+// the request URI, so they stay right when the request is copied along with
+// its URI; names point into the router, which outlives its requests.
+class route_params {
+public:
+  static constexpr std::size_t max_params = 8;
+
+  // True once the request has been routed to a location
+  bool matched() const { return matched_; }
+  std::size_t size() const { return size_; }
+
+  // The raw (still percent-encoded) value of the parameter called name, or
+  // empty if the location has none
+  std::string_view get(std::string_view name, std::string_view uri) const;
+
+  // The path after the matched location: empty, or starting with '/'
+  std::string_view remainder(std::string_view uri) const;
+
+  void clear() { *this = route_params(); }
+
+private:
+  friend class router;
+
+  struct param {
+    std::string_view name;
+    std::uint32_t offset;
+    std::uint32_t length;
+  };
+
+  std::array<param, max_params> params_{};
+  std::uint8_t size_ = 0;
+  bool matched_ = false;
+  std::uint32_t remainder_offset_ = 0;
+  std::uint32_t remainder_length_ = 0;
+};
+
+// Maps request paths to locations. A location is a path of whole segments,
+// "/api/notes", where a segment written "{name}" matches any one segment
+// and is captured. Locations are compiled into a radix tree of segments, so
+// a lookup walks the path once whatever the number of locations, and does
+// not allocate.
+//
+// A path matches a location when the location's segments are a prefix of
+// its segments: "/echo" takes "/echo", "/echo/" and "/echo/a?b" but not
+// "/echoes". The longest matching location wins, and at each segment a
+// literal beats a {name}.
+class router {
+public:
+  router();
+  ~router();
+  router(router&&) noexcept;
+  router& operator=(router&&) noexcept;
+
+  // Adds a location, which matches to value. Returns false if pattern is
+  // malformed (see valid_pattern()), already added, or gives a {name}
+  // segment a different name than another location does at that point.
+  bool add(std::string_view pattern, std::size_t value);
+
+  // Merges runs of literal segments that lead to a single child into one
+  // edge. Call once, after every location has been added.
+  void compile();
+
+  // The value of the location that uri's path matches, or nullptr. params
+  // gets its captures.
+  const std::size_t* match(std::string_view uri, route_params& params) const;
+
+  // True if pattern is "/" or "/"-separated segments, none empty, where a
+  // segment holding '{' or '}' is exactly "{name}", with at most
+  // route_params::max_params of those
+  static bool valid_pattern(std::string_view pattern);
+
+private:
+  struct node;
+
+  std::unique_ptr<node> root_;
+};
+
+} // namespace server
+} // namespace http
+
+#endif // HTTP_ROUTER_H
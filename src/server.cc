@@ -1,5 +1,6 @@
 #include "server.h"
 #include "session.h"
+#include <algorithm>
 #include <boost/bind.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/log/utility/setup/common_attributes.hpp>
@@ -7,38 +8,116 @@
 
 using boost::asio::ip::tcp;
 
+typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port_option;
+
 server::server(boost::asio::io_service& io_service, short port,
-               const std::map<std::string, HandlerConfig>& handler_configs)
+               const std::map<std::string, HandlerConfig>& handler_configs,
+               const ServerOptions& options,
+               std::shared_ptr<connection_limiter> limiter,
+               std::shared_ptr<boost::asio::thread_pool> blocking_pool)
+  : server(io_service, open_acceptor(io_service, port, options), handler_configs, options,
+           std::move(limiter), std::move(blocking_pool)) {
+}
+
+server::server(boost::asio::io_service& io_service, tcp::acceptor acceptor,
+               const std::map<std::string, HandlerConfig>& handler_configs,
+               const ServerOptions& options,
+               std::shared_ptr<connection_limiter> limiter,
+               std::shared_ptr<boost::asio::thread_pool> blocking_pool)
   : io_service_(io_service),
-    acceptor_(io_service, tcp::endpoint(tcp::v4(), port)) {
-  
+    acceptor_(std::move(acceptor)),
+    session_options_(options.session),
+    limiter_(limiter ? std::move(limiter)
+                     : std::make_shared<connection_limiter>(options.max_connections,
+                                                            options.max_inflight_requests)) {
+  // Only start blocking threads if some location will use them
+  bool any_blocking = std::any_of(handler_configs.begin(), handler_configs.end(),
+      [](const auto& entry) { return entry.second.blocking; });
+  if (!blocking_pool && any_blocking) {
+    blocking_pool = std::make_shared<boost::asio::thread_pool>(options.blocking_threads);
+  }
+
   // Initialize the handler registry with the configs
-  if (!handler_registry_.Init(handler_configs)) {
+  if (!handler_registry_.Init(handler_configs, std::move(blocking_pool))) {
     throw std::runtime_error("Failed to initialize handler registry");
   }
+  session_pool_ = session_pool::create(io_service_, handler_registry_, session_options_, limiter_);
   
   // Start accepting connections
   start_accept();
 }
 
+server::~server() {
+  limiter_->cancel_wait(this);
+}
+
+tcp::acceptor server::open_acceptor(boost::asio::io_service& io_service, short port,
+                                    const ServerOptions& options) {
+  // Open and bind the acceptor by hand so SO_REUSEPORT is set before bind()
+  tcp::acceptor acceptor(io_service);
+  tcp::endpoint endpoint(tcp::v4(), port);
+  acceptor.open(endpoint.protocol());
+  acceptor.set_option(tcp::acceptor::reuse_address(true));
+  if (options.io_model == "per_core") {
+    acceptor.set_option(reuse_port_option(true));
+  }
+  acceptor.bind(endpoint);
+  acceptor.listen();
+  return acceptor;
+}
+
+int server::listen_handle() {
+  return acceptor_.native_handle();
+}
+
+void server::shutdown() {
+  boost::asio::post(io_service_, boost::bind(&server::handle_shutdown, this));
+}
+
+void server::handle_shutdown() {
+  // Connections still queued on the socket stay there for whichever
+  // process has inherited it
+  boost::system::error_code ignored_ec;
+  acceptor_.close(ignored_ec);
+  limiter_->cancel_wait(this);
+  session_pool_->drain();
+}
+
 void server::start_accept() {
-  session* new_session = new session(io_service_, handler_registry_);
+  std::shared_ptr<session> new_session = session_pool_->acquire();
   acceptor_.async_accept(new_session->socket(),
       boost::bind(&server::handle_accept, this, new_session,
         boost::asio::placeholders::error));
 }
 
-void server::handle_accept(session* new_session, const boost::system::error_code& error) {
+void server::handle_accept(std::shared_ptr<session> new_session, const boost::system::error_code& error) {
+  // shutdown() closed the acceptor
+  if (!acceptor_.is_open()) {
+    return;
+  }
+
   server_log log;
   if (!error) {
     boost::asio::ip::tcp::endpoint remote_ep = new_session->socket().remote_endpoint();
     std::string client_ip = remote_ep.address().to_string();
     std::string client_port = std::to_string(remote_ep.port());
     log.log_new_client_connection(client_ip, client_port);
-    
-    new_session->start();
-  } else {
-    delete new_session;
+
+    // Counted here rather than in start(), which may be queued on the
+    // strand, so the check below already includes this connection
+    limiter_->connection_opened();
+
+    // On the session's strand so a concurrent shutdown() cannot race it
+    boost::asio::dispatch(new_session->strand(), boost::bind(&session::start, new_session, true));
+  }
+
+  // Past max_connections, stop pulling connections off the listen queue
+  // until one closes. The resume may run on another server's thread, so
+  // post it back to this server's io_service.
+  bool paused = limiter_->pause_accepting(this, [this]() {
+    boost::asio::post(io_service_, boost::bind(&server::start_accept, this));
+  });
+  if (!paused) {
+    start_accept();
   }
-  start_accept();
 }
\ No newline at end of file
@@ -1,17 +1,60 @@
 #pragma once
 #include <boost/asio.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <memory>
+#include "connection_limiter.h"
 #include "request_handler_registry.h"
+#include "session_pool.h"
+
+class session;
 
 class server {
 public:
+  // With io_model "per_core" the acceptor binds with SO_REUSEPORT so several
+  // servers (one per io_service) can listen on the same port. Servers that
+  // share a limiter enforce max_connections and max_inflight_requests
+  // together, and servers that share a blocking pool bound the threads
+  // running "blocking on;" handlers together. Without them the server makes
+  // its own from options.
   server(boost::asio::io_service& io_service, short port, 
-         const std::map<std::string, HandlerConfig>& handler_configs);
+         const std::map<std::string, HandlerConfig>& handler_configs,
+         const ServerOptions& options = ServerOptions(),
+         std::shared_ptr<connection_limiter> limiter = nullptr,
+         std::shared_ptr<boost::asio::thread_pool> blocking_pool = nullptr);
+
+  // Serves connections from an acceptor that is already listening, e.g. one
+  // built around a socket inherited from the previous process. The acceptor
+  // must belong to io_service.
+  server(boost::asio::io_service& io_service, boost::asio::ip::tcp::acceptor acceptor,
+         const std::map<std::string, HandlerConfig>& handler_configs,
+         const ServerOptions& options = ServerOptions(),
+         std::shared_ptr<connection_limiter> limiter = nullptr,
+         std::shared_ptr<boost::asio::thread_pool> blocking_pool = nullptr);
+  ~server();
+
+  // Opens a listening acceptor on port the way the first constructor does
+  static boost::asio::ip::tcp::acceptor open_acceptor(boost::asio::io_service& io_service, short port,
+                                                      const ServerOptions& options);
+
+  // The listening socket, for handing over to a new process
+  int listen_handle();
+
+  // Stops accepting and drains every open session. Returns immediately;
+  // the io_service runs out of work once the last connection has closed.
+  // Safe to call from any thread.
+  void shutdown();
 
 private:
+  // Accepts the next connection unless max_connections is reached, in which
+  // case accepting resumes once a connection closes
   void start_accept();
-  void handle_accept(class session* new_session, const boost::system::error_code& error);
+  void handle_accept(std::shared_ptr<session> new_session, const boost::system::error_code& error);
+  void handle_shutdown();
 
   boost::asio::io_service& io_service_;
   boost::asio::ip::tcp::acceptor acceptor_;
+  SessionOptions session_options_;
+  std::shared_ptr<connection_limiter> limiter_;
   http::server::RequestHandlerRegistry handler_registry_;
+  std::shared_ptr<session_pool> session_pool_;
 };
\ No newline at end of file
@@ -38,34 +38,59 @@ void server_log::log_close_client_connection(std::string client_ip, std::string
                                 + " port:" + client_port;
 }
 
+void server_log::log_client_timeout(std::string client_ip, std::string client_port, std::string timeout_name) {
+    BOOST_LOG_TRIVIAL(info) << "[ConnectionTimeout] message:\"Client connection TIMED OUT\" timeout:" + timeout_name
+                                + " ip:" + client_ip + " port:" + client_port;
+}
+
+void server_log::log_server_drain(std::string reason) {
+    BOOST_LOG_TRIVIAL(info) << "[ServerDrain] message:\"Server has stopped accepting and is draining connections\" reason:" + reason;
+}
+
 void server_log::log_server_close() {
     BOOST_LOG_TRIVIAL(info) << "[ServerClose] message:\"Server has shutdown\"";
 }
 
-void server_log::log_request(http::server::request req, std::string client_ip, std::string client_port) {
-    std::string message = "[RequestMetrics] message:\"Client sent a REQUEST to server\" request_method:" 
-                            + req.method
-                            + " request_path:" + req.uri
-                            + " request_http_version:" + std::to_string(req.http_version_major) + "."+ std::to_string(req.http_version_minor)
-                            + " request_body:" + req.body
-                            + " ip:" + client_ip 
-                            + " port:" + client_port;
-    BOOST_LOG_TRIVIAL(info) << message;
+// The per-request records are streamed field by field rather than
+// concatenated, so logging a request builds no intermediate strings. Owning
+// requests and views print the same fields.
+namespace {
+
+std::string_view method_name(const http::server::request& req) {
+    return req.method;
+}
+
+std::string_view method_name(const http::server::request_view& req) {
+    return req.method_name;
+}
+
+template <typename Request>
+void write_request(const Request& req, const std::string& client_ip, const std::string& client_port) {
+    BOOST_LOG_TRIVIAL(info) << "[RequestMetrics] message:\"Client sent a REQUEST to server\" request_method:" 
+                            << method_name(req)
+                            << " request_path:" << req.uri
+                            << " request_http_version:" << req.http_version_major << "." << req.http_version_minor
+                            << " request_body:" << req.body
+                            << " ip:" << client_ip 
+                            << " port:" << client_port;
 }
 
-void server_log::log_invalid_request(http::server::request req, std::string client_ip, std::string client_port) {
-    std::string message = "[RequestMetrics] message:\"Client sent an INVALID REQUEST to server\" request_method:" 
-                        + req.method
-                        + " request_path:" + req.uri
-                        + " request_http_version:" + std::to_string(req.http_version_major) + "."+ std::to_string(req.http_version_minor)
-                        + " request_body:" + req.body
-                        + " ip:" + client_ip 
-                        + " port:" + client_port;
-    BOOST_LOG_TRIVIAL(error) << message;
+template <typename Request>
+void write_invalid_request(const Request& req, const std::string& client_ip, const std::string& client_port) {
+    BOOST_LOG_TRIVIAL(error) << "[RequestMetrics] message:\"Client sent an INVALID REQUEST to server\" request_method:" 
+                             << method_name(req)
+                             << " request_path:" << req.uri
+                             << " request_http_version:" << req.http_version_major << "." << req.http_version_minor
+                             << " request_body:" << req.body
+                             << " ip:" << client_ip 
+                             << " port:" << client_port;
 }
 
-void server_log::log_reply(http::server::request req, http::server::reply rep, std::string handler_name, std::string client_ip, std::string client_port) {
-    std::string full_response = http::server::status_strings::to_string(rep.status) + rep.content;
+template <typename Request>
+void write_reply(const Request& req, const http::server::reply& rep, const std::string& handler_name,
+                 const std::string& client_ip, const std::string& client_port) {
+    std::string full_response = http::server::status_strings::to_string(rep.status);
+    full_response.append(rep.prebuilt ? rep.prebuilt->content() : std::string_view(rep.content));
     
     // remove trailing return + newline
     full_response = std::regex_replace(full_response, std::regex("(\r\n)$"), "");
@@ -73,17 +98,43 @@ void server_log::log_reply(http::server::request req, http::server::reply rep, s
     // replace return + newlines with spaces
     full_response = std::regex_replace(full_response, std::regex("\r\n{1,}"), " ");
     full_response = std::regex_replace(full_response, std::regex("\r|\n"), " ");
-    full_response = "\"" + full_response + "\"";
-
-    std::string message = "[ResponseMetrics] message:\"Server sent a REPLY to client\" response_code:"
-                            + std::to_string(static_cast<int>(rep.status)) 
-                            + " full_response:" + full_response
-                            + " request_handler:" + handler_name
-                            + " request_method:" + req.method
-                            + " request_path:" + req.uri
-                            + " request_http_version:" + std::to_string(req.http_version_major) + "."+ std::to_string(req.http_version_minor)
-                            + " request_body:" + req.body
-                            + " ip:" + client_ip 
-                            + " port:" + client_port ;
-    BOOST_LOG_TRIVIAL(info) << message;
-}
\ No newline at end of file
+
+    BOOST_LOG_TRIVIAL(info) << "[ResponseMetrics] message:\"Server sent a REPLY to client\" response_code:"
+                            << static_cast<int>(rep.status) 
+                            << " full_response:\"" << full_response << "\""
+                            << " request_handler:" << handler_name
+                            << " request_method:" << method_name(req)
+                            << " request_path:" << req.uri
+                            << " request_http_version:" << req.http_version_major << "." << req.http_version_minor
+                            << " request_body:" << req.body
+                            << " ip:" << client_ip 
+                            << " port:" << client_port;
+}
+
+}  // namespace
+
+void server_log::log_request(const http::server::request& req, const std::string& client_ip, const std::string& client_port) {
+    write_request(req, client_ip, client_port);
+}
+
+void server_log::log_request(const http::server::request_view& req, const std::string& client_ip, const std::string& client_port) {
+    write_request(req, client_ip, client_port);
+}
+
+void server_log::log_invalid_request(const http::server::request& req, const std::string& client_ip, const std::string& client_port) {
+    write_invalid_request(req, client_ip, client_port);
+}
+
+void server_log::log_invalid_request(const http::server::request_view& req, const std::string& client_ip, const std::string& client_port) {
+    write_invalid_request(req, client_ip, client_port);
+}
+
+void server_log::log_reply(const http::server::request& req, const http::server::reply& rep, const std::string& handler_name,
+                           const std::string& client_ip, const std::string& client_port) {
+    write_reply(req, rep, handler_name, client_ip, client_port);
+}
+
+void server_log::log_reply(const http::server::request_view& req, const http::server::reply& rep, const std::string& handler_name,
+                           const std::string& client_ip, const std::string& client_port) {
+    write_reply(req, rep, handler_name, client_ip, client_port);
+}
@@ -7,6 +7,7 @@
 #include <boost/log/utility/setup/console.hpp>
 #include <string>
 #include "request.hpp"
+#include "request_view.hpp"
 #include "reply.hpp"
 #include <algorithm>
 
@@ -29,17 +30,28 @@ class server_log {
         // TODO: log for closing client connection
         void log_close_client_connection(std::string client_ip, std::string client_port); 
 
+        // log for a client connection closed because a timeout expired
+        void log_client_timeout(std::string client_ip, std::string client_port, std::string timeout_name);
+
+        // log for the start of a graceful shutdown (reason: signal or handoff)
+        void log_server_drain(std::string reason);
+
         // log for closing server
         void log_server_close();
 
         // log for receiving requests
-        void log_request(http::server::request req, std::string client_ip, std::string client_port); 
+        void log_request(const http::server::request& req, const std::string& client_ip, const std::string& client_port); 
+        void log_request(const http::server::request_view& req, const std::string& client_ip, const std::string& client_port);
 
         // log for receiving INVALID requests
-        void log_invalid_request(http::server::request req, std::string client_ip, std::string client_port); 
+        void log_invalid_request(const http::server::request& req, const std::string& client_ip, const std::string& client_port); 
+        void log_invalid_request(const http::server::request_view& req, const std::string& client_ip, const std::string& client_port);
 
         // log for replying to requests
-        void log_reply(http::server::request req, http::server::reply rep, std::string handler_name, std::string client_ip, std::string client_port);
+        void log_reply(const http::server::request& req, const http::server::reply& rep, const std::string& handler_name,
+                       const std::string& client_ip, const std::string& client_port);
+        void log_reply(const http::server::request_view& req, const http::server::reply& rep, const std::string& handler_name,
+                       const std::string& client_ip, const std::string& client_port);
 };
 
 #endif
\ No newline at end of file
@@ -5,7 +5,15 @@
 #include "server_log.h"
 #include <signal.h>
 #include "request_handler_registry.h" // Add this include
-#include <thread>
+#include "io_service_pool.h"
+#include "handoff.h"
+#include "async_file.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <unistd.h>
 #include <vector>
 
 // Initialize handlers to ensure they're registered
@@ -22,25 +30,25 @@ void init_handlers() {
     std::cout << std::endl;
 }
 
-// Close server after Ctrl + C input
-void interrupt_handler(const boost::system::error_code& error, int signal_number) {
-  server_log log;
-  log.log_server_close();
-  exit(signal_number);
-}
-
-void thread_handler(boost::asio::io_service& io_service, std::exception_ptr& thread_exception_ptr) {
-  try {
-    io_service.run();
-  } catch (std::exception& e) {
-    thread_exception_ptr = std::current_exception();
+// Polls until every connection has closed or the drain deadline passes,
+// then stops the io threads
+void watch_drain(boost::asio::steady_timer& timer, io_service_pool& pool,
+                 std::shared_ptr<connection_limiter> limiter,
+                 std::chrono::steady_clock::time_point deadline) {
+  if (limiter->connections() == 0 || std::chrono::steady_clock::now() >= deadline) {
+    pool.stop();
+    return;
   }
+  timer.expires_after(std::chrono::milliseconds(100));
+  timer.async_wait([&timer, &pool, limiter, deadline](const boost::system::error_code& error) {
+    if (!error) {
+      watch_drain(timer, pool, limiter, deadline);
+    }
+  });
 }
 
 int main(int argc, char* argv[])
 {
-  std::exception_ptr thread_exception_ptr = nullptr;
-
   // Initialize the handler registry first
   init_handlers();
   
@@ -54,8 +62,6 @@ int main(int argc, char* argv[])
       return 1;
     }
 
-    boost::asio::io_service io_service;
-
     NginxConfigParser config_parser;
     NginxConfig config;
     
@@ -82,37 +88,125 @@ int main(int argc, char* argv[])
       return 1;
     }
     
-    // Create and run the server
-    server s(io_service, std::stoi(port_num), handler_configs);
-    log.log_server_startup(port_num);
+    // Extract threading options
+    ServerOptions options;
+    if (!config.ExtractServerOptions(options)) {
+      std::cerr << "Invalid server options in config file" << std::endl;
+      return 1;
+    }
 
-    // Run interrupt_handler() when Ctrl + C is entered
-    boost::asio::signal_set signals(io_service, SIGINT, SIGTERM);
-    signals.async_wait(interrupt_handler);
+    // "shared" runs every thread on one io_service; "per_core" gives each
+    // thread its own io_service and its own SO_REUSEPORT acceptor
+    bool per_core = (options.io_model == "per_core");
+    std::size_t thread_count = options.thread_count;
+    io_service_pool pool(per_core ? thread_count : 1,
+                         per_core ? 1 : thread_count,
+                         options.cpu_affinity);
 
-    // Multithreading
-    std::vector<std::thread> threads_container;
-    int thread_count = 4;
+    // Take over the listening sockets of a running server, if one is
+    // serving at handoff_socket
+    handoff_client inherited;
+    std::vector<int> inherited_fds;
+    if (!options.handoff_socket.empty()) {
+      inherited_fds = inherited.inherit(options.handoff_socket);
+    }
 
-    // Runs request handlers in multiple threads
-    for (int i = 0; i < thread_count; i++) {
-        threads_container.emplace_back([&]() {
-          thread_handler(io_service, thread_exception_ptr);
-        });
+    // Create the servers; they share one limiter so connection and request
+    // limits apply to the whole process, and one pool for blocking handlers
+    // if some location has "blocking on;"
+    auto limiter = std::make_shared<connection_limiter>(options.max_connections,
+                                                        options.max_inflight_requests);
+    std::shared_ptr<boost::asio::thread_pool> blocking_pool;
+    if (std::any_of(handler_configs.begin(), handler_configs.end(),
+                    [](const auto& entry) { return entry.second.blocking; })) {
+      blocking_pool = std::make_shared<boost::asio::thread_pool>(options.blocking_threads);
     }
+    std::vector<std::unique_ptr<server>> servers;
+    if (inherited_fds.empty()) {
+      for (std::size_t i = 0; i < pool.size(); ++i) {
+        servers.push_back(std::make_unique<server>(pool.get_io_service(i), std::stoi(port_num),
+                                                   handler_configs, options, limiter,
+                                                   blocking_pool));
+      }
+    } else {
+      // Every inherited socket must keep being accepted on (a SO_REUSEPORT
+      // group routes connections to each of them), and every io_service
+      // needs an acceptor. Where a socket is shared, each acceptor gets its
+      // own descriptor for it.
+      std::size_t count = std::max(pool.size(), inherited_fds.size());
+      for (std::size_t i = 0; i < count; ++i) {
+        boost::asio::io_service& io_service = pool.get_io_service(i % pool.size());
+        int fd = i < inherited_fds.size() ? inherited_fds[i] : ::dup(inherited_fds[i % inherited_fds.size()]);
+        boost::asio::ip::tcp::acceptor acceptor(io_service, boost::asio::ip::tcp::v4(), fd);
+        servers.push_back(std::make_unique<server>(io_service, std::move(acceptor),
+                                                   handler_configs, options, limiter,
+                                                   blocking_pool));
+      }
+      inherited.acknowledge();
+    }
+    log.log_server_startup(port_num);
+    std::cout << "I/O backend: " << http::server::io_backend << std::endl;
 
-    // Rethrow exceptions caught during threading 
-    if (thread_exception_ptr) {
-      try {
-        std::rethrow_exception(thread_exception_ptr);
-      } catch(const std::exception &e) {
-        std::cerr << "Thread Exception: " << e.what() << "\n";
+    // Graceful shutdown: stop accepting, let open connections finish their
+    // current request, and exit once they are gone or drain_timeout passes
+    boost::asio::io_service& control = pool.get_io_service(0);
+    boost::asio::steady_timer drain_timer(control);
+    std::unique_ptr<handoff_listener> handoff;
+    std::atomic<bool> draining(false);
+    std::function<void(const std::string&)> begin_drain = [&](const std::string& reason) {
+      if (draining.exchange(true)) {
+        return;
+      }
+      log.log_server_drain(reason);
+      if (handoff) {
+        handoff->close();
+      }
+      for (auto& s : servers) {
+        s->shutdown();
       }
+      watch_drain(drain_timer, pool, limiter, std::chrono::steady_clock::now() + options.drain_timeout);
+    };
+
+    // Hand the listening sockets to the next process that asks, then drain
+    if (!options.handoff_socket.empty()) {
+      handoff = std::make_unique<handoff_listener>(control, options.handoff_socket,
+        [&servers]() {
+          std::vector<int> fds;
+          for (auto& s : servers) {
+            fds.push_back(s->listen_handle());
+          }
+          return fds;
+        },
+        [&begin_drain]() { begin_drain("handoff"); });
+    }
+
+    // SIGINT/SIGTERM drain; a second signal exits immediately
+    boost::asio::signal_set signals(control, SIGINT, SIGTERM);
+    std::function<void(const boost::system::error_code&, int)> signal_handler =
+      [&](const boost::system::error_code& error, int signal_number) {
+        if (error) {
+          return;
+        }
+        if (draining) {
+          log.log_server_close();
+          exit(signal_number);
+        }
+        begin_drain(signal_number == SIGTERM ? "SIGTERM" : "SIGINT");
+        signals.async_wait(signal_handler);
+      };
+    signals.async_wait(signal_handler);
+
+    // Runs request handlers in multiple threads
+    try {
+      pool.run();
+    } catch (const std::exception& e) {
+      std::cerr << "Thread Exception: " << e.what() << "\n";
     }
 
-    // Check if all threads have completed their operations
-    for (std::thread& t : threads_container)
-      t.join();
+    // Nothing is left to take blocking handlers' replies; drop queued ones
+    // and wait only for those already running
+    blocking_pool->stop();
+    blocking_pool->join();
   }
   catch (std::exception& e)
   {
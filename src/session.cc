@@ -1,6 +1,12 @@
 #include "session.h"
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
 #include <boost/bind.hpp>
+#include <cerrno>
+#include <cstdio>
 #include <iostream>
+#include <memory>
+#include <sys/sendfile.h>
 #include "reply.hpp"
 #include "request_parser.hpp"
 #include "request.hpp"
@@ -8,99 +14,1216 @@
 
 using boost::asio::ip::tcp;
 
+namespace {
+
+// Read size once a connection speaks HTTP/2; frames are not bounded by the
+// HTTP/1 header limits the initial buffer is sized for
+const size_t http2_read_size = 16 * 1024;
+
+const char http2_switching_protocols[] =
+  "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+
+// Ends every chunk of a chunked body
+const char chunk_trailer[] = "\r\n";
+
+// Most of a file body passed to one sendfile() call, so a fast client
+// cannot keep the strand from other work
+const size_t sendfile_chunk = 1024 * 1024;
+
+// Reads a Content-Length value: digits only, no sign or spaces, and small
+// enough for size_t
+bool parse_content_length(std::string_view value, size_t& length) {
+  if (value.empty()) {
+    return false;
+  }
+  length = 0;
+  for (char c : value) {
+    if (c < '0' || c > '9' || length > (SIZE_MAX - (c - '0')) / 10) {
+      return false;
+    }
+    length = length * 10 + (c - '0');
+  }
+  return true;
+}
+
+}  // namespace
+
 session::session(boost::asio::io_service& io_service, 
-                 http::server::RequestHandlerRegistry& handler_registry)
-  : socket_(io_service), handler_registry_(handler_registry) {
+                 http::server::RequestHandlerRegistry& handler_registry,
+                 const SessionOptions& options,
+                 std::shared_ptr<connection_limiter> limiter)
+  : socket_(io_service),
+    strand_(io_service.get_executor()),
+    options_(options),
+    wheel_(boost::asio::use_service<timing_wheel>(io_service)),
+    limiter_(std::move(limiter)),
+    buffer_(options.header_buffer_size),
+    parser_(http::server::request_limits{options.max_uri_length, options.max_header_count,
+                                         options.max_header_line_size}),
+    req_(arena_.allocator()),
+    handler_registry_(handler_registry) {
+}
+
+session::~session() {
+  // Disarm before the derived part is gone; the wheel may be expiring us
+  // on another thread right now
+  wheel_.cancel(*this);
+  release_limits();
 }
 
 tcp::socket& session::socket() {
   return socket_;
 }
 
-void session::start() {
-  socket_.async_read_some(boost::asio::buffer(data_, max_length),
-      boost::bind(&session::handle_read, this,
-        boost::asio::placeholders::error,
-        boost::asio::placeholders::bytes_transferred));
+session::strand_type& session::strand() {
+  return strand_;
+}
+
+void session::start(bool connection_counted) {
+  boost::system::error_code ec;
+  boost::asio::ip::tcp::endpoint remote_ep = socket_.remote_endpoint(ec);
+  if (!ec) {
+    client_ip_ = remote_ep.address().to_string();
+    client_port_ = std::to_string(remote_ep.port());
+  }
+  if (limiter_) {
+    if (!connection_counted) {
+      limiter_->connection_opened();
+    }
+    connection_counted_ = true;
+  }
+  do_read();
+}
+
+void session::drain() {
+  boost::asio::post(strand_, boost::bind(&session::handle_drain, shared_from_this()));
+}
+
+void session::handle_drain() {
+  draining_ = true;
+
+  if (http2_) {
+    // GOAWAY; streams the client has already started still get replies
+    http2_->shutdown();
+    continue_http2_io();
+    return;
+  }
+
+  // Otherwise continue_io() closes once the work in progress is done
+  if (idle() && socket_.is_open()) {
+    close();
+  }
+}
+
+bool session::idle() const {
+  // Waiting for a request that has not started to arrive; nothing to finish
+  return replies_.empty() && !writing_ && !streaming_ && !awaiting_handler_ &&
+         state_ == read_state::headers && buffer_start_ == buffer_end_;
+}
+
+void session::do_read() {
+  arm_read_timeout();
+
+  boost::asio::mutable_buffer target;
+  if (state_ == read_state::body && body_target_ == body_target::request) {
+    // Read the rest of the body directly into the request
+    target = boost::asio::buffer(&req_.body[body_received_], req_.body.size() - body_received_);
+  } else if (state_ == read_state::body) {
+    // Never past the end of the body; what follows is the next request's
+    body_buffer_.resize(options_.body_buffer_size);
+    target = boost::asio::buffer(body_buffer_.data(),
+                                 std::min(body_buffer_.size(), content_length_ - body_received_));
+  } else {
+    prepare_buffer();
+    target = boost::asio::buffer(buffer_.data() + buffer_end_, buffer_.size() - buffer_end_);
+  }
+  socket_.async_read_some(target,
+      boost::asio::bind_executor(strand_,
+        boost::bind(&session::handle_read, shared_from_this(),
+          boost::asio::placeholders::error,
+          boost::asio::placeholders::bytes_transferred)));
+}
+
+void session::prepare_buffer() {
+  if (buffer_end_ < buffer_.size()) {
+    return;
+  }
+
+  // Reclaim the space taken by requests that were already answered
+  if (buffer_start_ > 0) {
+    std::copy(buffer_.begin() + buffer_start_, buffer_.begin() + buffer_end_, buffer_.begin());
+    parse_pos_ -= buffer_start_;
+    buffer_end_ -= buffer_start_;
+    buffer_start_ = 0;
+  }
+
+  // Grow for a request whose headers do not fit yet. process_pending()
+  // rejects the request before it can outgrow the limit.
+  if (buffer_end_ == buffer_.size()) {
+    buffer_.resize(std::min(buffer_.size() * 2, options_.max_header_size + options_.header_buffer_size));
+  }
+}
+
+void session::do_write() {
+  // Gather queued replies into a single write so pipelined responses go out
+  // in request order. A streamed body ends the batch; the replies behind it
+  // wait until it has been written.
+  // Each reply adds at most two buffers, its serialized head and content.
+  std::vector<boost::asio::const_buffer> buffers;
+  buffers.reserve(2 * replies_.size());
+  batch_size_ = 0;
+  for (auto& rep : replies_) {
+    rep->append_buffers(buffers);
+    ++batch_size_;
+    if (rep->body) {
+      break;
+    }
+  }
+  arm_timeout(timeout_kind::send, options_.send_timeout);
+  writing_ = true;
+  boost::asio::async_write(socket_,
+    buffers,
+    boost::asio::bind_executor(strand_,
+      boost::bind(&session::handle_write, shared_from_this(),
+        boost::asio::placeholders::error)));
 }
 
 void session::handle_read(const boost::system::error_code& error, size_t bytes_transferred) {
-  server_log log;
-  if (!error) {
-    boost::asio::ip::tcp::endpoint remote_ep = socket_.remote_endpoint();
-    std::string client_ip = remote_ep.address().to_string();
-    std::string client_port = std::to_string(remote_ep.port());
-    std::string handler_name = "";
-
-    http::server::request req;
-    http::server::request_parser rp;
-    auto req_parse_results = rp.http::server::request_parser::parse(req, data_, data_ + bytes_transferred);
-    bool is_malformed = std::get<0>(req_parse_results); 
-
-    std::unique_ptr<http::server::reply> rep = std::make_unique<http::server::reply>();
-    if (is_malformed) { 
-      // malformed request
-      rep = rep->build_malformed_req_response();
-      log.log_invalid_request(req, client_ip, client_port);
-    } else {
+  if (error) {
+    close();
+    return;
+  }
+
+  if (state_ == read_state::body && body_target_ == body_target::request) {
+    body_received_ += bytes_transferred;
+  } else if (state_ == read_state::body) {
+    consume_body(body_buffer_.data(), bytes_transferred);
+  } else {
+    buffer_end_ += bytes_transferred;
+  }
+  process_pending();
+  continue_io();
+}
+
+void session::handle_write(const boost::system::error_code& error) {
+  writing_ = false;
+  if (error) {
+    close();
+    return;
+  }
+
+  // The last reply of the batch may have only had its headers written
+  std::unique_ptr<http::server::reply>& last = replies_[batch_size_ - 1];
+  if (last->body) {
+    start_body(std::move(last));
+  }
+  replies_.erase(replies_.begin(), replies_.begin() + batch_size_);
+  if (streaming_) {
+    write_body();
+    return;
+  }
+  finish_write();
+}
+
+void session::start_body(std::unique_ptr<http::server::reply> rep) {
+  streaming_ = std::move(rep);
+  streaming_remaining_ = streaming_->body->size();
+  streaming_chunked_ = false;
+  for (const auto& header : streaming_->headers) {
+    if (boost::algorithm::iequals(header.name, "Transfer-Encoding") &&
+        boost::algorithm::iequals(header.value, "chunked")) {
+      streaming_chunked_ = true;
+    }
+  }
+  // File bodies skip output_buffer_ unless they are framed in chunks
+  streaming_file_ = options_.sendfile && !streaming_chunked_ && streaming_->body->file();
+  body_ended_ = false;
+}
+
+void session::write_body() {
+  if (streaming_file_) {
+    send_file();
+    return;
+  }
+
+  std::size_t capacity = options_.output_buffer_size;
+  if (streaming_remaining_) {
+    capacity = std::min(capacity, *streaming_remaining_);
+  }
+  std::size_t count = 0;
+  if (capacity > 0) {
+    output_buffer_.resize(options_.output_buffer_size);
+    try {
+      count = streaming_->body->read(output_buffer_.data(), capacity);
+    } catch (const std::exception& e) {
+      // Too late for an error reply; the client sees the body cut short
+      std::cerr << "Body Exception: " << e.what() << "\n";
+      close();
+      return;
+    }
+  }
+
+  if (streaming_remaining_) {
+    if (count == 0) {
+      if (*streaming_remaining_ > 0) {
+        // Shorter than the Content-Length already sent
+        close();
+        return;
+      }
+      finish_body();
+      return;
+    }
+    *streaming_remaining_ -= std::min(count, *streaming_remaining_);
+  } else if (count == 0 && !streaming_chunked_) {
+    // An HTTP/1.0 client reads to the end of the connection, which
+    // close_after_write_ provides
+    finish_body();
+    return;
+  }
+
+  std::vector<boost::asio::const_buffer> buffers;
+  if (streaming_chunked_) {
+    // Size in hex, data, CRLF; the empty chunk ends the body
+    int length = std::snprintf(chunk_header_, sizeof(chunk_header_), "%zx\r\n", count);
+    buffers.push_back(boost::asio::buffer(chunk_header_, length));
+    buffers.push_back(boost::asio::buffer(output_buffer_.data(), count));
+    buffers.push_back(boost::asio::buffer(chunk_trailer, sizeof(chunk_trailer) - 1));
+    body_ended_ = count == 0;
+  } else {
+    buffers.push_back(boost::asio::buffer(output_buffer_.data(), count));
+  }
+
+  arm_timeout(timeout_kind::send, options_.send_timeout);
+  writing_ = true;
+  boost::asio::async_write(socket_,
+    buffers,
+    boost::asio::bind_executor(strand_,
+      boost::bind(&session::handle_body_write, shared_from_this(),
+        boost::asio::placeholders::error)));
+}
+
+void session::send_file() {
+  http::server::body_source::file_range range = *streaming_->body->file();
+  if (range.length == 0) {
+    finish_body();
+    return;
+  }
+
+  // sendfile() must not block the io thread; asio's own operations cope
+  // with the socket being non-blocking
+  if (!socket_.native_non_blocking()) {
+    boost::system::error_code ec;
+    socket_.native_non_blocking(true, ec);
+  }
+  off_t offset = range.offset;
+  ssize_t sent = ::sendfile(socket_.native_handle(), range.fd, &offset,
+                            std::min(range.length, sendfile_chunk));
+  if (sent < 0 && (errno == EINVAL || errno == ENOSYS)) {
+    // The file cannot be sent this way; copy it through output_buffer_
+    streaming_file_ = false;
+    write_body();
+    return;
+  }
+  if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+    close();
+    return;
+  }
+  if (sent == 0) {
+    // Truncated under us; the promised Content-Length can no longer be met
+    std::cerr << "Body Exception: file shrank while being sent\n";
+    close();
+    return;
+  }
+  if (sent > 0) {
+    streaming_->body->consume(sent);
+    if (streaming_remaining_) {
+      *streaming_remaining_ -= std::min<size_t>(sent, *streaming_remaining_);
+    }
+    if (static_cast<size_t>(sent) == range.length) {
+      finish_body();
+      return;
+    }
+  }
+
+  // Completes at once if the socket can still take more
+  arm_timeout(timeout_kind::send, options_.send_timeout);
+  writing_ = true;
+  socket_.async_wait(tcp::socket::wait_write,
+    boost::asio::bind_executor(strand_,
+      boost::bind(&session::handle_body_write, shared_from_this(),
+        boost::asio::placeholders::error)));
+}
+
+void session::handle_body_write(const boost::system::error_code& error) {
+  writing_ = false;
+  if (error) {
+    close();
+    return;
+  }
+  if (body_ended_) {
+    finish_body();
+  } else {
+    write_body();
+  }
+}
+
+void session::finish_body() {
+  streaming_.reset();
+  finish_write();
+}
+
+void session::finish_write() {
+  // Replies queued behind a streamed body go out before anything else
+  if (!replies_.empty()) {
+    continue_io();
+    return;
+  }
+
+  // Every written reply ends one in-flight request; a handler still being
+  // awaited stays in flight
+  if (!awaiting_handler_) {
+    // Frees the answered requests and their replies at once; a pipelined
+    // request already partly parsed is carried over
+    arena_.release(req_);
+  }
+  size_t finished = inflight_requests_ - (awaiting_handler_ ? 1 : 0);
+  if (limiter_ && finished > 0) {
+    limiter_->end_requests(finished);
+    inflight_requests_ -= finished;
+  }
+  if (close_after_write_) {
+    close();
+    return;
+  }
+
+  // Requests that arrived behind the ones just answered are already buffered
+  process_pending();
+  continue_io();
+}
+
+void session::continue_io() {
+  if (http2_) {
+    continue_http2_io();
+    return;
+  }
+  if (writing_) {
+    // handle_write() continues from here
+    return;
+  }
+  if (!replies_.empty()) {
+    do_write();
+  } else if (awaiting_handler_) {
+    // handle_async_reply() continues from here
+    cancel_timeout();
+  } else if (close_after_write_ || (draining_ && idle())) {
+    close();
+  } else {
+    do_read();
+  }
+}
+
+void session::process_pending() {
+  while (!close_after_write_ && !awaiting_handler_) {
+    if (state_ == read_state::headers) {
+      if (parse_pos_ == buffer_end_) {
+        return;
+      }
+
+      // A connection that opens with the HTTP/2 preface never speaks HTTP/1
+      if (options_.http2 && requests_served_ == 0 && parse_pos_ == 0) {
+        const std::string& preface = http2_connection::client_preface;
+        size_t compared = std::min(buffer_end_, preface.size());
+        if (std::equal(buffer_.begin(), buffer_.begin() + compared, preface.begin())) {
+          if (compared == preface.size()) {
+            start_http2();
+          }
+          return;
+        }
+      }
+
+      const char* begin = buffer_.data() + parse_pos_;
+      const char* end = buffer_.data() + buffer_end_;
+      auto req_parse_results = parser_.parse(buffer_.data() + buffer_start_, begin, end);
+      http::server::request_parser::result_type result = std::get<0>(req_parse_results);
+      parse_pos_ += std::get<1>(req_parse_results) - begin;
+
+      if (result == http::server::request_parser::indeterminate) {
+        // Wait for the rest of the headers unless they already overflow the limit
+        if (parse_pos_ - buffer_start_ <= options_.max_header_size) {
+          return;
+        }
+        reject_oversized(http::server::reply::request_header_fields_too_large);
+        return;
+      }
+
+      if (result == http::server::request_parser::bad) {
+        switch (parser_.error()) {
+        case http::server::request_parser::uri_too_long:
+          reject_oversized(http::server::reply::uri_too_long);
+          break;
+        case http::server::request_parser::header_fields_too_large:
+          reject_oversized(http::server::reply::request_header_fields_too_large);
+          break;
+        default:
+          reject_malformed();
+        }
+        return;
+      }
+
       // well formed HTTP request
 
-      // Checks for Content-Length header (request bodies)
+      // Checks for Content-Length header (request bodies). A value that is
+      // not a plain decimal number cannot frame the body, so the request is
+      // refused rather than read as having none.
+      http::server::request_view head(arena_.allocator());
+      parser_.view(head, buffer_.data() + buffer_start_);
+      const auto* length_header = head.find_header(http::server::known_header::content_length);
+
+      // A body framed by Transfer-Encoding would otherwise be read as the
+      // next request, and one framed two ways could be split differently by
+      // a proxy in front of us; both end the connection
+      if (head.find_header(http::server::known_header::transfer_encoding)) {
+        if (length_header) {
+          reject_malformed();
+        } else {
+          reject_transfer_encoding();
+        }
+        return;
+      }
+
       size_t content_length = 0;
-      for (const auto& header : req.headers) {
-        if (header.name == "Content-Length") {
-          try {
-            content_length = std::stoi(header.value);
-          } catch (...) {
-            // Invalid Content-Length, ignore
+      if (length_header) {
+        if (!parse_content_length(length_header->value, content_length)) {
+          reject_malformed();
+          return;
+        }
+        // Repeats must agree with the first
+        for (auto it = head.headers.begin() + (length_header - head.headers.data()) + 1;
+             it != head.headers.end(); ++it) {
+          size_t repeated = 0;
+          if (http::server::header_name_equals(it->name, "Content-Length") &&
+              (!parse_content_length(it->value, repeated) || repeated != content_length)) {
+            reject_malformed();
+            return;
           }
-          break;
         }
       }
-      
-      // Parses the request body
-      if (content_length > 0) {
-        rp.http::server::request_parser::parse_request_body(data_, bytes_transferred, req.body, content_length);
+
+      location_ = handler_registry_.Route(head.uri, path_params_);
+      if (content_length > handler_registry_.MaxBodySize(location_, options_.max_body_size)) {
+        reject_oversized(http::server::reply::payload_too_large);
+        return;
       }
 
-    boost::asio::ip::tcp::endpoint remote_ep = socket_.remote_endpoint();
-    std::string client_ip = remote_ep.address().to_string();
-    std::string client_port = std::to_string(remote_ep.port());
+      content_length_ = content_length;
+      state_ = read_state::body;
+      if (!start_request_body(head)) {
+        reset_request();
+        continue;
+      }
+    }
+
+    // Wait until the whole body has arrived
+    if (body_target_ != body_target::buffer && body_received_ < content_length_) {
+      return;
+    }
 
-    // Create handler for the request
-    std::unique_ptr<http::server::RequestHandler> handler = handler_registry_.CreateHandler(req.uri, handler_name);
-    
-    // Log the request
-    if (handler) {
-      log.log_request(req, client_ip, client_port);
+    // Everything but a body that did not fit the buffer still lies in
+    // buffer_ from buffer_start_ on
+    http::server::request_view view(arena_.allocator());
+    parser_.view(view, buffer_.data() + buffer_start_);
+    if (body_target_ == body_target::handler) {
+      finish_streamed_body(view);
+      reset_request();
+      continue;
+    }
+    if (body_target_ == body_target::request) {
+      view.body = req_.body;
+    } else if (body_target_ == body_target::spool) {
+      try {
+        view.body = body_spool_->contents();
+      } catch (const std::exception& e) {
+        std::cerr << "Body Exception: " << e.what() << "\n";
+        finish_request(view, failed_reply(nullptr), handler_name_);
+        reset_request();
+        continue;
+      }
     } else {
-      log.log_invalid_request(req, client_ip, client_port);
+      view.body = std::string_view(buffer_.data() + parse_pos_ - content_length_, content_length_);
     }
 
-      // Generate and send the reply
-      rep = handler->handle_request(req);
+    if (wants_http2_upgrade(view) && upgrade_to_http2(view)) {
+      return;
     }
-    std::vector<boost::asio::const_buffer> buffers = rep->to_buffers();
-    boost::asio::async_write(socket_,
-      buffers,
-      boost::bind(&session::handle_write, this,
-        boost::asio::placeholders::error));
-    log.log_reply(req, *rep, handler_name, client_ip, client_port);
 
+    dispatch(view);
+    if (awaiting_handler_) {
+      // req_ must outlive the handler's coroutine
+      return;
+    }
+    reset_request();
+  }
+}
+
+bool session::start_request_body(http::server::request_view& head) {
+  size_t buffered = std::min(content_length_, buffer_end_ - parse_pos_);
+  body_target_ = body_target::buffer;
+  if (content_length_ > 0) {
+    handler_ = handler_registry_.CreateHandler(location_, handler_name_);
+    head.route = path_params_;
+    if (handler_ && handler_->streams_body()) {
+      return start_streamed_body(head, buffered);
+    }
+  }
+
+  // A body that is already buffered is viewed in place. Otherwise the
+  // buffered part is copied out and the rest read after it.
+  if (buffered == content_length_) {
+    parse_pos_ += content_length_;
+    return true;
+  }
+  if (content_length_ > options_.body_buffer_size) {
+    try {
+      body_spool_ = std::make_unique<http::server::spooled_body>();
+    } catch (const std::exception& e) {
+      std::cerr << "Body Exception: " << e.what() << "\n";
+      answer_early(head, failed_reply(nullptr), handler_name_);
+      return false;
+    }
+    body_target_ = body_target::spool;
   } else {
-    delete this;
+    req_.body.resize(content_length_);
+    body_target_ = body_target::request;
   }
+  const char* begin = buffer_.data() + parse_pos_;
+  parse_pos_ += buffered;
+  return consume_body(begin, buffered);
 }
 
-void session::handle_write(const boost::system::error_code& error) {
-  if (!error) {
-    socket_.async_read_some(boost::asio::buffer(data_, max_length),
-        boost::bind(&session::handle_read, this,
+bool session::start_streamed_body(const http::server::request_view& head, size_t buffered) {
+  if (limiter_) {
+    if (!limiter_->try_begin_request()) {
+      answer_early(head, overloaded_reply(head.get_allocator()), "LoadShedding");
+      return false;
+    }
+    ++inflight_requests_;
+  }
+  server_log log;
+  log.log_request(head, client_ip_, client_port_);
+
+  body_target_ = body_target::handler;
+  std::unique_ptr<http::server::reply> rep;
+  try {
+    rep = handler_->on_headers(head);
+  } catch (...) {
+    rep = failed_reply(std::current_exception());
+  }
+  if (rep) {
+    answer_early(head, std::move(rep), handler_name_);
+    return false;
+  }
+
+  const char* begin = buffer_.data() + parse_pos_;
+  parse_pos_ += buffered;
+  return consume_body(begin, buffered);
+}
+
+bool session::consume_body(const char* data, size_t size) {
+  // Counted up front so a failed piece is not skipped again by answer_early()
+  size_t offset = body_received_;
+  body_received_ += size;
+  try {
+    switch (body_target_) {
+    case body_target::request:
+      std::copy(data, data + size, req_.body.begin() + offset);
+      break;
+    case body_target::spool:
+      body_spool_->append(data, size);
+      break;
+    case body_target::handler:
+      if (size > 0) {
+        handler_->on_body_chunk(std::string_view(data, size));
+      }
+      break;
+    case body_target::buffer:
+      break;
+    }
+  } catch (...) {
+    http::server::request_view head(arena_.allocator());
+    parser_.view(head, buffer_.data() + buffer_start_);
+    answer_early(head, failed_reply(std::current_exception()), handler_name_);
+    reset_request();
+    return false;
+  }
+  return true;
+}
+
+void session::answer_early(const http::server::request_view& head,
+                           std::unique_ptr<http::server::reply> rep,
+                           const std::string& handler_name) {
+  if (buffer_end_ - parse_pos_ >= content_length_ - body_received_) {
+    // The whole body is buffered; skipping it keeps the connection usable
+    parse_pos_ += content_length_ - body_received_;
+    finish_request(head, std::move(rep), handler_name);
+    return;
+  }
+  server_log log;
+  log.log_reply(head, *rep, handler_name, client_ip_, client_port_);
+  queue_reply(std::move(rep), false);
+  ++requests_served_;
+}
+
+void session::finish_streamed_body(const http::server::request_view& req) {
+  std::unique_ptr<http::server::reply> rep;
+  try {
+    rep = handler_->on_complete();
+  } catch (...) {
+    rep = failed_reply(std::current_exception());
+  }
+  if (!rep) {
+    rep = failed_reply(nullptr);
+  }
+  finish_request(req, std::move(rep), handler_name_);
+}
+
+void session::reject_malformed() {
+  // malformed request; the stream cannot be resynchronized so close after replying
+  server_log log;
+  http::server::reply malformed;
+  http::server::request_view parsed(arena_.allocator());
+  parser_.view(parsed, buffer_.data() + buffer_start_);
+  log.log_invalid_request(parsed, client_ip_, client_port_);
+  queue_reply(malformed.build_malformed_req_response(), false);
+}
+
+void session::reject_oversized(http::server::reply::status_type status) {
+  server_log log;
+  http::server::request_view parsed(arena_.allocator());
+  parser_.view(parsed, buffer_.data() + buffer_start_);
+  log.log_invalid_request(parsed, client_ip_, client_port_);
+  const char* message = status == http::server::reply::payload_too_large ? "Request body is too large\r\n"
+                      : status == http::server::reply::uri_too_long ? "Request URI is too long\r\n"
+                      : "Request headers are too large\r\n";
+  queue_reply(http::server::reply::stock_reply(status, message), false);
+}
+
+void session::reject_transfer_encoding() {
+  server_log log;
+  http::server::request_view parsed(arena_.allocator());
+  parser_.view(parsed, buffer_.data() + buffer_start_);
+  log.log_invalid_request(parsed, client_ip_, client_port_);
+  queue_reply(http::server::reply::stock_reply(http::server::reply::not_implemented,
+                                               "Transfer-Encoding is not supported\r\n"), false);
+}
+
+void session::reject_overloaded(const http::server::request_view& req) {
+  // Shedding is meant to be cheap: no handler runs and the connection stays
+  // usable so the client can retry on it
+  server_log log;
+  std::unique_ptr<http::server::reply> rep = overloaded_reply(req.get_allocator());
+  log.log_reply(req, *rep, "LoadShedding", client_ip_, client_port_);
+  queue_reply(std::move(rep), wants_keep_alive(req));
+}
+
+std::unique_ptr<http::server::reply> session::overloaded_reply(
+    const http::server::reply::allocator_type& alloc) {
+  std::unique_ptr<http::server::reply> rep = http::server::reply::stock_reply(
+    http::server::reply::service_unavailable, "Server is overloaded, retry later\r\n", alloc);
+  rep->headers.push_back({"Retry-After", "1"});
+  return rep;
+}
+
+std::unique_ptr<http::server::reply> session::failed_reply(std::exception_ptr error) {
+  try {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Handler Exception: " << e.what() << "\n";
+  }
+  return http::server::reply::stock_reply(http::server::reply::internal_server_error,
+                                          "Request handler failed\r\n");
+}
+
+void session::release_limits() {
+  if (!limiter_) {
+    return;
+  }
+  if (inflight_requests_ > 0) {
+    limiter_->end_requests(inflight_requests_);
+    inflight_requests_ = 0;
+  }
+  if (connection_counted_) {
+    connection_counted_ = false;
+    limiter_->connection_closed();
+  }
+}
+
+void session::reset_request() {
+  req_ = http::server::request(arena_.allocator());
+  parser_.reset();
+  state_ = read_state::headers;
+  body_target_ = body_target::buffer;
+  body_spool_.reset();
+  handler_.reset();
+  handler_name_.clear();
+  location_ = nullptr;
+  path_params_.clear();
+  body_received_ = 0;
+  content_length_ = 0;
+  buffer_start_ = parse_pos_;
+
+  // Rewind the buffer for free once nothing is left in it
+  if (buffer_start_ == buffer_end_) {
+    buffer_start_ = parse_pos_ = buffer_end_ = 0;
+  }
+}
+
+void session::dispatch(http::server::request_view& req) {
+  if (limiter_) {
+    if (!limiter_->try_begin_request()) {
+      reject_overloaded(req);
+      return;
+    }
+    ++inflight_requests_;
+  }
+
+  server_log log;
+  std::string handler_name = std::move(handler_name_);
+
+  // Create handler for the request, unless one was picked for its body
+  std::shared_ptr<http::server::RequestHandler> handler = std::move(handler_);
+  if (!handler) {
+    handler = handler_registry_.CreateHandler(location_, handler_name);
+  }
+  req.route = path_params_;
+
+  // Log the request; unmatched URIs still get the NotFoundHandler
+  log.log_request(req, client_ip_, client_port_);
+
+  if (handler->is_async()) {
+    // Run the coroutine on the strand and pick the connection up again when
+    // it completes; the session, the handler and req_ stay alive until then.
+    // The coroutine may outlive this call, so it gets an owning copy.
+    keep_request(req);
+    awaiting_handler_ = true;
+    pending_handler_ = std::move(handler);
+    pending_handler_name_ = handler_name;
+    std::shared_ptr<session> self = shared_from_this();
+    boost::asio::co_spawn(strand_, pending_handler_->handle_request_async(req_),
+      [self](std::exception_ptr error, std::unique_ptr<http::server::reply> rep) {
+        self->handle_async_reply(error, std::move(rep));
+      });
+    return;
+  }
+
+  // Generate the reply
+  std::unique_ptr<http::server::reply> rep = handler->handle_request_view(req);
+  finish_request(req, std::move(rep), handler_name);
+}
+
+void session::keep_request(const http::server::request_view& req) {
+  // A body read into req_.body is already there; everything else is copied
+  // out of buffer_ or the spool
+  if (body_target_ != body_target::request) {
+    req_.body.assign(req.body);
+  }
+  req_.method.assign(req.method_name);
+  req_.uri.assign(req.uri);
+  req_.http_version_major = req.http_version_major;
+  req_.http_version_minor = req.http_version_minor;
+  req_.route = req.route;
+  req_.headers.clear();
+  for (const auto& header : req.headers) {
+    req_.headers.emplace_back(header.name, header.value);
+  }
+}
+
+void session::handle_async_reply(std::exception_ptr error, std::unique_ptr<http::server::reply> rep) {
+  if (error || !rep) {
+    rep = failed_reply(error);
+  }
+
+  finish_request(http::server::request_view(req_, arena_.allocator()), std::move(rep),
+                 pending_handler_name_);
+  pending_handler_.reset();
+  awaiting_handler_ = false;
+  reset_request();
+
+  process_pending();
+  continue_io();
+}
+
+void session::finish_request(const http::server::request_view& req,
+                             std::unique_ptr<http::server::reply> rep,
+                             const std::string& handler_name) {
+  server_log log;
+  log.log_reply(req, *rep, handler_name, client_ip_, client_port_);
+
+  bool keep_alive = wants_keep_alive(req);
+  if (rep->body && !rep->body->size()) {
+    // Unknown length: chunked if the client understands it, otherwise the
+    // end of the body is marked by closing the connection
+    if (req.http_version_major > 1 || (req.http_version_major == 1 && req.http_version_minor >= 1)) {
+      rep->headers.push_back({"Transfer-Encoding", "chunked"});
+    } else {
+      keep_alive = false;
+    }
+  }
+  queue_reply(std::move(rep), keep_alive);
+  ++requests_served_;
+}
+
+void session::queue_reply(std::unique_ptr<http::server::reply> rep, bool keep_alive) {
+  if (keep_alive && !draining_) {
+    rep->set_keep_alive(true);
+  } else {
+    rep->set_keep_alive(false);
+    close_after_write_ = true;
+  }
+  replies_.push_back(std::move(rep));
+}
+
+bool session::wants_keep_alive(const http::server::request_view& req) {
+  bool keep_alive = req.http_version_major > 1 ||
+                    (req.http_version_major == 1 && req.http_version_minor >= 1);
+  if (const auto* header = req.find_header(http::server::known_header::connection)) {
+    if (boost::algorithm::icontains(header->value, "close")) {
+      keep_alive = false;
+    } else if (boost::algorithm::icontains(header->value, "keep-alive")) {
+      keep_alive = true;
+    }
+  }
+  return keep_alive;
+}
+
+bool session::wants_http2_upgrade(const http::server::request_view& req) {
+  // Upgrading with HTTP/1 replies still queued would interleave them with frames
+  if (!options_.http2 || !replies_.empty() || writing_ ||
+      req.http_version_major != 1 || req.http_version_minor != 1) {
+    return false;
+  }
+
+  const auto* upgrade = req.find_header(http::server::known_header::upgrade);
+  if (!upgrade || !req.find_header(http::server::known_header::http2_settings)) {
+    return false;
+  }
+  bool upgrade_h2c = false;
+  std::vector<std::string> protocols;
+  boost::algorithm::split(protocols, upgrade->value, boost::algorithm::is_any_of(","));
+  for (auto& protocol : protocols) {
+    upgrade_h2c |= boost::algorithm::iequals(boost::algorithm::trim_copy(protocol), "h2c");
+  }
+  return upgrade_h2c;
+}
+
+void session::start_http2() {
+  http2_ = std::make_unique<http2_connection>(options_);
+  process_http2_input();
+  buffer_.resize(std::max(buffer_.size(), http2_read_size));
+}
+
+bool session::upgrade_to_http2(const http::server::request_view& req) {
+  std::string settings;
+  if (const auto* header = req.find_header(http::server::known_header::http2_settings)) {
+    settings = header->value;
+  }
+  auto connection = std::make_unique<http2_connection>(options_);
+  if (!connection->upgrade(settings, req.method == http::server::request_method::head)) {
+    // Not a usable upgrade; answer the request over HTTP/1.1 instead
+    return false;
+  }
+
+  // The 101 goes out ahead of the server's first frames, and the request
+  // that asked for the upgrade is answered on stream 1
+  http2_ = std::move(connection);
+  http2_output_ = http2_switching_protocols;
+  streams_[1].request = http::server::request(req);
+  reset_request();
+  dispatch_stream(1);
+  process_http2_input();
+  buffer_.resize(std::max(buffer_.size(), http2_read_size));
+  return true;
+}
+
+void session::process_http2_input() {
+  if (!http2_->receive(buffer_.data() + parse_pos_, buffer_end_ - parse_pos_)) {
+    // Protocol error; send the GOAWAY http2_ has queued, then close
+    close_after_write_ = true;
+  }
+  buffer_start_ = parse_pos_ = buffer_end_ = 0;
+
+  for (auto& completed : http2_->take_requests()) {
+    if (close_after_write_) {
+      break;
+    }
+    streams_[completed.stream_id].request = std::move(completed.request);
+    dispatch_stream(completed.stream_id);
+  }
+}
+
+void session::dispatch_stream(std::int32_t stream_id) {
+  http2_stream& stream = streams_[stream_id];
+  if (limiter_) {
+    if (!limiter_->try_begin_request()) {
+      finish_stream(stream_id, overloaded_reply(), "LoadShedding");
+      return;
+    }
+    stream.counted = true;
+    ++inflight_requests_;
+  }
+
+  // Stream bodies are held to the server-wide limit as they arrive; a
+  // location's own limit can only be checked once the stream is complete
+  const auto* location = handler_registry_.Route(stream.request.uri, stream.request.route);
+  if (stream.request.body.size() > handler_registry_.MaxBodySize(location, options_.max_body_size)) {
+    finish_stream(stream_id,
+                  http::server::reply::stock_reply(http::server::reply::payload_too_large,
+                                                   "Request body is too large\r\n"),
+                  "BodySizeLimit");
+    return;
+  }
+
+  server_log log;
+  std::shared_ptr<http::server::RequestHandler> handler =
+    handler_registry_.CreateHandler(location, stream.handler_name);
+  log.log_request(stream.request, client_ip_, client_port_);
+
+  if (handler->is_async()) {
+    // Unlike HTTP/1, other streams keep being read and answered meanwhile
+    stream.handler = std::move(handler);
+    std::shared_ptr<session> self = shared_from_this();
+    boost::asio::co_spawn(strand_, stream.handler->handle_request_async(stream.request),
+      [self, stream_id](std::exception_ptr error, std::unique_ptr<http::server::reply> rep) {
+        self->handle_stream_reply(stream_id, error, std::move(rep));
+      });
+    return;
+  }
+
+  finish_stream(stream_id, handler->handle_request(stream.request), stream.handler_name);
+}
+
+void session::handle_stream_reply(std::int32_t stream_id, std::exception_ptr error,
+                                  std::unique_ptr<http::server::reply> rep) {
+  if (error || !rep) {
+    rep = failed_reply(error);
+  }
+  finish_stream(stream_id, std::move(rep), streams_[stream_id].handler_name);
+  continue_http2_io();
+}
+
+void session::finish_stream(std::int32_t stream_id, std::unique_ptr<http::server::reply> rep,
+                            const std::string& handler_name) {
+  auto it = streams_.find(stream_id);
+  server_log log;
+  log.log_reply(it->second.request, *rep, handler_name, client_ip_, client_port_);
+  http2_->submit_reply(stream_id, std::move(rep));
+  ++requests_served_;
+
+  // Counted as finished once submitted; HTTP/2 flow control, not this
+  // session, decides when the frames are written
+  if (it->second.counted) {
+    limiter_->end_requests(1);
+    --inflight_requests_;
+  }
+  streams_.erase(it);
+}
+
+void session::continue_http2_io() {
+  if (!socket_.is_open()) {
+    return;
+  }
+
+  if (!writing_) {
+    if (!http2_->send(http2_output_)) {
+      close_after_write_ = true;
+    }
+    if (!http2_output_.empty()) {
+      do_http2_write();
+    } else if (close_after_write_ || (streams_.empty() && http2_->finished())) {
+      close();
+      return;
+    }
+  }
+
+  // Unlike HTTP/1, keep reading while handlers run and replies are written
+  if (!reading_ && !close_after_write_ && http2_->want_read()) {
+    do_http2_read();
+  }
+
+  // A write arms send_timeout; otherwise the connection is idle unless a
+  // handler is still running
+  if (!writing_) {
+    if (streams_.empty()) {
+      arm_timeout(timeout_kind::keepalive, options_.keepalive_timeout);
+    } else {
+      cancel_timeout();
+    }
+  }
+}
+
+void session::do_http2_read() {
+  reading_ = true;
+  socket_.async_read_some(boost::asio::buffer(buffer_),
+      boost::asio::bind_executor(strand_,
+        boost::bind(&session::handle_http2_read, shared_from_this(),
           boost::asio::placeholders::error,
-          boost::asio::placeholders::bytes_transferred));
+          boost::asio::placeholders::bytes_transferred)));
+}
+
+void session::do_http2_write() {
+  arm_timeout(timeout_kind::send, options_.send_timeout);
+  writing_ = true;
+  boost::asio::async_write(socket_,
+    boost::asio::buffer(http2_output_),
+    boost::asio::bind_executor(strand_,
+      boost::bind(&session::handle_http2_write, shared_from_this(),
+        boost::asio::placeholders::error)));
+}
+
+void session::handle_http2_read(const boost::system::error_code& error, size_t bytes_transferred) {
+  reading_ = false;
+  if (error) {
+    if (socket_.is_open()) {
+      close();
+    }
+    return;
+  }
+
+  buffer_end_ = bytes_transferred;
+  process_http2_input();
+  continue_http2_io();
+}
+
+void session::handle_http2_write(const boost::system::error_code& error) {
+  writing_ = false;
+  if (error) {
+    if (socket_.is_open()) {
+      close();
+    }
+    return;
+  }
+
+  http2_output_.clear();
+  continue_http2_io();
+}
+
+void session::arm_read_timeout() {
+  if (state_ == read_state::body) {
+    arm_timeout(timeout_kind::body, options_.header_timeout);
+  } else if (buffer_end_ > buffer_start_) {
+    // Part of a request is buffered; its header deadline runs from the
+    // first byte and is not extended by further reads
+    if (timeout_kind_ != timeout_kind::header) {
+      arm_timeout(timeout_kind::header, options_.header_timeout);
+    }
+  } else if (requests_served_ > 0) {
+    arm_timeout(timeout_kind::keepalive, options_.keepalive_timeout);
   } else {
-    delete this;
+    // A new connection has client_header_timeout to send its first request
+    arm_timeout(timeout_kind::header, options_.header_timeout);
+  }
+}
+
+void session::arm_timeout(timeout_kind kind, std::chrono::milliseconds timeout) {
+  if (timeout.count() <= 0) {
+    cancel_timeout();
+    return;
   }
+  timeout_kind_ = kind;
+  timeout_sequence_ = wheel_.schedule(*this, timeout);
+}
+
+void session::cancel_timeout() {
+  if (timeout_kind_ != timeout_kind::none) {
+    wheel_.cancel(*this);
+    timeout_kind_ = timeout_kind::none;
+  }
+}
+
+void session::on_expire(std::uint64_t sequence) {
+  // Runs under the wheel's lock. A session whose last reference is already
+  // gone is being released and has nothing left to time out.
+  if (std::shared_ptr<session> self = weak_from_this().lock()) {
+    boost::asio::post(strand_, [self, sequence]() {
+      self->handle_timeout(sequence);
+    });
+  }
+}
+
+void session::handle_timeout(std::uint64_t sequence) {
+  if (timeout_kind_ == timeout_kind::none || sequence != timeout_sequence_) {
+    return;
+  }
+
+  static const char* const names[] = {
+    "none", "client_header_timeout", "client_header_timeout", "keepalive_timeout", "send_timeout"
+  };
+  server_log log;
+  log.log_client_timeout(client_ip_, client_port_, names[static_cast<int>(timeout_kind_)]);
+
+  // Closing the socket aborts the pending read or write, whose handler
+  // then releases the session
+  timeout_kind_ = timeout_kind::none;
+  boost::system::error_code ignored_ec;
+  socket_.close(ignored_ec);
+}
+
+void session::close() {
+  server_log log;
+  cancel_timeout();
+  boost::system::error_code ignored_ec;
+  socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_ec);
+  socket_.close(ignored_ec);
+  log.log_close_client_connection(client_ip_, client_port_);
+}
+
+void session::reset() {
+  cancel_timeout();
+  requests_served_ = 0;
+  boost::system::error_code ignored_ec;
+  socket_.close(ignored_ec);
+  release_limits();
+
+  // Keep the initial read buffer, but release any growth from large headers
+  buffer_.resize(options_.header_buffer_size);
+  buffer_.shrink_to_fit();
+  buffer_start_ = parse_pos_ = buffer_end_ = 0;
+
+  // Rebuilt rather than assigned so no buffer of the old request survives
+  std::destroy_at(&req_);
+  std::construct_at(&req_, arena_.allocator());
+  parser_.reset();
+  state_ = read_state::headers;
+  body_target_ = body_target::buffer;
+  body_spool_.reset();
+  body_buffer_.clear();
+  body_buffer_.shrink_to_fit();
+  handler_.reset();
+  handler_name_.clear();
+  location_ = nullptr;
+  path_params_.clear();
+  body_received_ = 0;
+  content_length_ = 0;
+
+  replies_.clear();
+  batch_size_ = 0;
+  streaming_.reset();
+  output_buffer_.clear();
+  output_buffer_.shrink_to_fit();
+  arena_.release();
+  writing_ = false;
+  close_after_write_ = false;
+  draining_ = false;
+  pending_handler_.reset();
+  pending_handler_name_.clear();
+  awaiting_handler_ = false;
+  http2_.reset();
+  streams_.clear();
+  http2_output_.clear();
+  reading_ = false;
+  client_ip_.clear();
+  client_port_.clear();
 }
 
 // ------------------------------------------------------------------
@@ -124,7 +1247,7 @@ session::process_read(const boost::system::error_code& error,
 
       // Create an appropriate handler for this request
       std::string handler_name;
-      auto handler = handler_registry_.CreateHandler(req.uri, handler_name);
+      auto handler = handler_registry_.CreateHandler(req.uri, handler_name, &req.route);
 
       // Generate the reply
       auto rep = handler->handle_request(req);
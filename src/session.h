@@ -1,23 +1,68 @@
 #pragma once
 #include <boost/asio.hpp>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <functional>
 #include "request_handler.hpp"
 #include "request_handler_registry.h"
+#include "request_parser.hpp"
+#include "request_view.hpp"
+#include "config_parser.h"
+#include "connection_limiter.h"
+#include "http2_connection.h"
+#include "request_arena.h"
+#include "spooled_body.h"
+#include "timing_wheel.h"
 
 class server_config_test; // Forward declaration for your tests
 class server_request_parser_test;
 class server_session_test;
 class server_session_logic_test;
+class session_pool;
 
-class session {
+// One client connection. Sessions are owned through std::shared_ptr: every
+// pending async operation holds a reference, and the session is freed (or
+// returned to its session_pool) once the last one completes.
+//
+// Handlers run on a per-session strand so a timeout firing on another io
+// thread cannot race the read or write it interrupts. Timeouts are entries on
+// the io_service's timing_wheel rather than a timer per connection.
+//
+// A connection starts as HTTP/1.x and switches to HTTP/2 (h2c) if it opens
+// with the HTTP/2 preface or asks to with "Upgrade: h2c". From then on every
+// stream is dispatched as its own request and replies go out as they are
+// ready rather than in request order.
+class session : public std::enable_shared_from_this<session>,
+                private timing_wheel::entry {
 public:
+  // limiter, if set, counts this connection and its in-flight requests
   session(boost::asio::io_service& io_service, 
-          http::server::RequestHandlerRegistry& handler_registry);
+          http::server::RequestHandlerRegistry& handler_registry,
+          const SessionOptions& options = SessionOptions(),
+          std::shared_ptr<connection_limiter> limiter = nullptr);
+  ~session();
+  typedef boost::asio::strand<boost::asio::io_context::executor_type> strand_type;
+
   boost::asio::ip::tcp::socket& socket();
-  void start();
+
+  // Every handler of this session runs here; callers that may race a
+  // drain() should start() the session on it too
+  strand_type& strand();
+
+  // connection_counted says the caller has already counted the connection
+  // with the limiter, as the server does before deciding whether to accept
+  // another; otherwise start() counts it
+  void start(bool connection_counted = false);
+
+  // Winds the connection down for a graceful shutdown: an idle connection is
+  // closed now, and a busy one closes once its current reply is written.
+  // Safe to call from any thread.
+  void drain();
 
   // ------------------------------------------------------------------
   // Unit-testable core logic 
@@ -33,17 +78,271 @@ public:
   SessionAction process_write(const boost::system::error_code& error);
 
 private:
+  void do_read();
+  void do_write();
   void handle_read(const boost::system::error_code& error, size_t bytes_transferred);
   void handle_write(const boost::system::error_code& error);
 
+  // Streamed bodies. Once rep's headers are written its body goes out one
+  // output buffer at a time: as is when its size is known, chunked when not
+  // (or, for HTTP/1.0, up to the connection closing).
+  void start_body(std::unique_ptr<http::server::reply> rep);
+  void write_body();
+  // write_body() for a body backed by a file: sendfile(2) from its fd, then
+  // wait for the socket to take more
+  void send_file();
+  void handle_body_write(const boost::system::error_code& error);
+  void finish_body();
+
+  // Completes a write once no body is left to stream: releases the arena and
+  // the finished requests' limits, then moves on to the next request
+  void finish_write();
+
+  // Starts the next write or read once buffered requests are processed,
+  // unless a write or an async handler is still outstanding
+  void continue_io();
+
+  // Feeds buffered bytes to the parser and queues one reply for every
+  // complete request, in request order. Parser state is kept between calls so
+  // each byte is parsed once however the request is split across reads.
+  // Stops early once the connection is marked for close.
+  void process_pending();
+
+  // Makes room at the end of buffer_ for the next read, first by moving
+  // unconsumed bytes to the front and then by doubling up to the header limit
+  void prepare_buffer();
+
+  // Queues a 400 for a request that cannot be parsed and closes after it
+  void reject_malformed();
+
+  // Like reject_malformed() for a request that is well formed but breaks a
+  // size limit: 413, 414 or 431. Its body, if any, is never read.
+  void reject_oversized(http::server::reply::status_type status);
+
+  // Like reject_oversized() for a request whose body is framed by
+  // Transfer-Encoding, which the server does not decode: 501
+  void reject_transfer_encoding();
+
+  // Starts over with an empty request once the previous one is answered
+  void reset_request();
+
+  // Decides where the body of the request whose headers were just parsed
+  // goes and takes the part of it already buffered. Returns false if the
+  // request was answered without its body.
+  bool start_request_body(http::server::request_view& head);
+
+  // start_request_body() for a handler that streams bodies: counts the request,
+  // offers its headers and passes on the buffered part of its body
+  bool start_streamed_body(const http::server::request_view& head, size_t buffered);
+
+  // Passes body bytes to req_.body, the spool or the streaming handler.
+  // Returns false if that failed and the request was answered with a 500.
+  bool consume_body(const char* data, size_t size);
+
+  // Answers the request being read before its body has been read. The rest
+  // of the body is skipped if it is already buffered; otherwise the
+  // connection closes after the reply.
+  void answer_early(const http::server::request_view& head,
+                    std::unique_ptr<http::server::reply> rep,
+                    const std::string& handler_name);
+
+  // Queues the streaming handler's reply once the whole body was passed on
+  void finish_streamed_body(const http::server::request_view& req);
+
+  // Runs the handler for one complete request and queues its reply, or
+  // queues a 503 if the server is past max_inflight_requests. An async
+  // handler is started on the strand and processing pauses until it is done.
+  void dispatch(http::server::request_view& req);
+
+  // Copies req into req_ for a handler that outlives the read buffer
+  void keep_request(const http::server::request_view& req);
+
+  // Completion of an async handler's coroutine; resumes the connection
+  void handle_async_reply(std::exception_ptr error, std::unique_ptr<http::server::reply> rep);
+
+  // Logs and queues the reply to req
+  void finish_request(const http::server::request_view& req,
+                      std::unique_ptr<http::server::reply> rep,
+                      const std::string& handler_name);
+
+  // Queues a 503 with Retry-After for a request shed under load
+  void reject_overloaded(const http::server::request_view& req);
+  static std::unique_ptr<http::server::reply> overloaded_reply(
+    const http::server::reply::allocator_type& alloc = {});
+
+  // The 500 sent when an async handler throws or returns no reply
+  static std::unique_ptr<http::server::reply> failed_reply(std::exception_ptr error);
+
+  // Returns this connection and its in-flight requests to the limiter
+  void release_limits();
+
+  // Queues a reply, tagging it with the Connection header the client expects
+  void queue_reply(std::unique_ptr<http::server::reply> rep, bool keep_alive);
+
+  // HTTP/1.1 connections persist unless the client sends "Connection: close";
+  // HTTP/1.0 connections close unless the client sends "Connection: keep-alive"
+  static bool wants_keep_alive(const http::server::request_view& req);
+
+  // Which limit the armed timeout enforces
+  enum class timeout_kind { none, header, body, keepalive, send };
+
+  // Arms the timeout for the read about to start: client_header_timeout from
+  // the first byte of a request (and between body reads), keepalive_timeout
+  // while idle between requests
+  void arm_read_timeout();
+
+  // Replaces the armed timeout; a zero duration just disarms it
+  void arm_timeout(timeout_kind kind, std::chrono::milliseconds timeout);
+  void cancel_timeout();
+
+  // timing_wheel::entry; posts handle_timeout() to the strand
+  void on_expire(std::uint64_t sequence) override;
+
+  // Closes the connection unless the timeout was re-armed since it fired
+  void handle_timeout(std::uint64_t sequence);
+
+  // drain(), on the strand
+  void handle_drain();
+
+  // True between requests: nothing is being read, run or written
+  bool idle() const;
+
+  // HTTP/2. A connection that opens with the client preface switches before
+  // any HTTP/1 parsing; one that sends "Upgrade: h2c" switches after its
+  // first request, which becomes stream 1.
+  bool wants_http2_upgrade(const http::server::request_view& req);
+  void start_http2();
+  bool upgrade_to_http2(const http::server::request_view& req);
+
+  // Feeds the unparsed bytes in buffer_ to http2_ and dispatches every
+  // request whose stream is complete
+  void process_http2_input();
+
+  // Runs the handler for one stream; async handlers run concurrently
+  void dispatch_stream(std::int32_t stream_id);
+  void handle_stream_reply(std::int32_t stream_id, std::exception_ptr error,
+                           std::unique_ptr<http::server::reply> rep);
+  void finish_stream(std::int32_t stream_id, std::unique_ptr<http::server::reply> rep,
+                     const std::string& handler_name);
+
+  // Keeps a read outstanding while the client may send more, writes pending
+  // frames, and closes once the connection is finished
+  void continue_http2_io();
+  void do_http2_read();
+  void do_http2_write();
+  void handle_http2_read(const boost::system::error_code& error, size_t bytes_transferred);
+  void handle_http2_write(const boost::system::error_code& error);
+
+  // Closes the connection; the session is released once no handler holds it
+  void close();
+
+  // Clears all per-connection state so a pooled session can be reused
+  void reset();
+
   friend class server_config_test;
   friend class server_session_test; 
   friend class server_request_parser_test;
   friend class server_session_logic_test;
+  friend class session_pool;
   // Additional friends as necessary for other tests
 
   boost::asio::ip::tcp::socket socket_;
-  enum { max_length = 1024 };
-  char data_[max_length];
+  strand_type strand_;
+  SessionOptions options_;
+
+  // Timeout state; only touched on the strand
+  timing_wheel& wheel_;
+  timeout_kind timeout_kind_ = timeout_kind::none;
+  std::uint64_t timeout_sequence_ = 0;
+  size_t requests_served_ = 0;
+
+  // Load limits; inflight_requests_ counts dispatched requests whose
+  // replies are not yet written
+  std::shared_ptr<connection_limiter> limiter_;
+  bool connection_counted_ = false;
+  size_t inflight_requests_ = 0;
+
+  // Read buffer. Bytes in [buffer_start_, buffer_end_) belong to the request
+  // being parsed or to requests pipelined behind it; parse_pos_ marks how far
+  // the parser has consumed them. The request is handled in place, so its
+  // bytes stay put until it has been answered.
+  std::vector<char> buffer_;
+  size_t buffer_start_ = 0;
+  size_t parse_pos_ = 0;
+  size_t buffer_end_ = 0;
+
+  // HTTP/1 requests, and replies built with their allocator, live here. It is
+  // released each time every queued reply has been written.
+  request_arena arena_;
+
+  // The request being parsed. Handlers see it as a request_view into
+  // buffer_, and async handlers get all of it copied into req_.
+  enum class read_state { headers, body };
+  read_state state_ = read_state::headers;
+  http::server::request_parser parser_;
+  http::server::request req_;
+  size_t content_length_ = 0;
+  size_t body_received_ = 0;
+
+  // Where the body goes. One that arrived with its headers stays in buffer_.
+  // Otherwise it is read straight into req_.body, or, past body_buffer_size,
+  // spooled to body_spool_. A handler that streams bodies gets it through
+  // body_buffer_ instead, one read at a time.
+  enum class body_target { buffer, request, spool, handler };
+  body_target body_target_ = body_target::buffer;
+  std::unique_ptr<http::server::spooled_body> body_spool_;
+  std::vector<char> body_buffer_;
+
+  // The location a request was routed to once its headers were parsed, and
+  // what its URI matched; the body limit and the handler both come from it
+  const http::server::RequestHandlerRegistry::Location* location_ = nullptr;
+  http::server::route_params path_params_;
+
+  // Handler picked when the headers of a request with a body were parsed
+  std::shared_ptr<http::server::RequestHandler> handler_;
+  std::string handler_name_;
+
+  // Replies waiting to be written, in the order their requests arrived;
+  // the write in progress covers the first batch_size_
+  std::deque<std::unique_ptr<http::server::reply>> replies_;
+  size_t batch_size_ = 0;
+  bool writing_ = false;
+
+  // The reply whose body is being streamed. streaming_remaining_ is unset
+  // when the body's size is unknown.
+  std::unique_ptr<http::server::reply> streaming_;
+  std::optional<size_t> streaming_remaining_;
+  bool streaming_chunked_ = false;
+  bool streaming_file_ = false;
+  bool body_ended_ = false;
+  std::vector<char> output_buffer_;
+  char chunk_header_[24];
+
+  // Async handler whose coroutine is running for req_
+  std::shared_ptr<http::server::RequestHandler> pending_handler_;
+  std::string pending_handler_name_;
+  bool awaiting_handler_ = false;
+
+  // Set once a reply has been queued that must be the last on this connection
+  bool close_after_write_ = false;
+
+  // Set by drain(); every further reply says "Connection: close"
+  bool draining_ = false;
+
+  // HTTP/2 state once the connection has switched. streams_ holds the
+  // requests whose handlers are running, keyed by stream id.
+  struct http2_stream {
+    http::server::request request;
+    std::shared_ptr<http::server::RequestHandler> handler;
+    std::string handler_name;
+    bool counted = false;
+  };
+  std::unique_ptr<http2_connection> http2_;
+  std::map<std::int32_t, http2_stream> streams_;
+  std::string http2_output_;
+  bool reading_ = false;
+
+  std::string client_ip_;
+  std::string client_port_;
   http::server::RequestHandlerRegistry& handler_registry_;
 };
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "session_pool.h"
+#include "session.h"
+
+std::shared_ptr<session_pool> session_pool::create(boost::asio::io_service& io_service,
+                                                   http::server::RequestHandlerRegistry& handler_registry,
+                                                   const SessionOptions& options,
+                                                   std::shared_ptr<connection_limiter> limiter,
+                                                   size_t max_free) {
+  return std::shared_ptr<session_pool>(
+    new session_pool(io_service, handler_registry, options, std::move(limiter), max_free));
+}
+
+session_pool::session_pool(boost::asio::io_service& io_service,
+                           http::server::RequestHandlerRegistry& handler_registry,
+                           const SessionOptions& options,
+                           std::shared_ptr<connection_limiter> limiter,
+                           size_t max_free)
+  : io_service_(io_service),
+    handler_registry_(handler_registry),
+    options_(options),
+    limiter_(std::move(limiter)),
+    max_free_(max_free) {
+  free_.reserve(max_free_);
+}
+
+session_pool::~session_pool() {
+  for (session* s : free_) {
+    delete s;
+  }
+}
+
+std::shared_ptr<session> session_pool::acquire() {
+  session* s = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_.empty()) {
+      s = free_.back();
+      free_.pop_back();
+    }
+  }
+  if (!s) {
+    s = new session(io_service_, handler_registry_, options_, limiter_);
+  }
+
+  // A strong reference here would form a cycle through the released
+  // session's enable_shared_from_this control block
+  std::weak_ptr<session_pool> weak_self = shared_from_this();
+  std::shared_ptr<session> owned(s, [weak_self](session* released) {
+    if (std::shared_ptr<session_pool> self = weak_self.lock()) {
+      self->release(released);
+    } else {
+      delete released;
+    }
+  });
+
+  // Published only once its weak_from_this() is set, which drain() reads
+  // under the lock
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_.insert(s);
+  }
+  return owned;
+}
+
+size_t session_pool::free_count() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return free_.size();
+}
+
+void session_pool::drain() {
+  std::vector<std::shared_ptr<session>> sessions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (session* s : active_) {
+      // Fails for a session whose last reference is being released right now
+      if (std::shared_ptr<session> locked = s->weak_from_this().lock()) {
+        sessions.push_back(std::move(locked));
+      }
+    }
+  }
+  for (auto& s : sessions) {
+    s->drain();
+  }
+}
+
+void session_pool::release(session* s) {
+  s->reset();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_.erase(s);
+    if (free_.size() < max_free_) {
+      free_.push_back(s);
+      return;
+    }
+  }
+  delete s;
+}
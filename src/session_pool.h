@@ -0,0 +1,64 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include "config_parser.h"
+#include "connection_limiter.h"
+#include "request_handler_registry.h"
+
+class session;
+
+// Free list of sessions for one server. A session handed out by acquire()
+// comes back to the pool when its last shared_ptr is released, keeping its
+// socket object and read buffer, so steady-state accepts do not allocate a
+// new session. With io_model "per_core" every io thread has its own server
+// and therefore its own pool; the mutex is only contended in "shared" mode.
+//
+// Sessions only hold a weak reference to the pool. A session released after
+// its pool is gone (e.g. a pending accept destroyed with the io_service after
+// the server) is simply deleted.
+class session_pool : public std::enable_shared_from_this<session_pool> {
+public:
+  enum { default_max_free = 256 };
+
+  static std::shared_ptr<session_pool> create(boost::asio::io_service& io_service,
+                                              http::server::RequestHandlerRegistry& handler_registry,
+                                              const SessionOptions& options,
+                                              std::shared_ptr<connection_limiter> limiter = nullptr,
+                                              size_t max_free = default_max_free);
+  ~session_pool();
+
+  session_pool(const session_pool&) = delete;
+  session_pool& operator=(const session_pool&) = delete;
+
+  // Returns a session ready to accept a connection, reusing a released one when possible
+  std::shared_ptr<session> acquire();
+
+  // Number of released sessions waiting to be reused
+  size_t free_count();
+
+  // Calls session::drain() on every session handed out and not yet released
+  void drain();
+
+private:
+  session_pool(boost::asio::io_service& io_service,
+               http::server::RequestHandlerRegistry& handler_registry,
+               const SessionOptions& options,
+               std::shared_ptr<connection_limiter> limiter,
+               size_t max_free);
+
+  // Deleter for sessions handed out by acquire()
+  void release(session* s);
+
+  boost::asio::io_service& io_service_;
+  http::server::RequestHandlerRegistry& handler_registry_;
+  SessionOptions options_;
+  std::shared_ptr<connection_limiter> limiter_;
+  size_t max_free_;
+
+  std::mutex mutex_;
+  std::vector<session*> free_;
+  std::unordered_set<session*> active_;
+};
@@ -1,6 +1,6 @@
 #include "simple_auth_handler.h"
+#include "url_decoding.h"
 #include <iostream>
-#include <sstream>
 #include <random>
 #include <algorithm>
 #include <boost/regex.hpp>
@@ -10,6 +10,7 @@ namespace server {
 
 // Static member definition
 std::unordered_map<std::string, UserSession> SimpleAuthHandler::active_sessions_;
+std::mutex SimpleAuthHandler::sessions_mutex_;
 
 RequestHandler* SimpleAuthHandler::Init(const std::string& path_prefix, const NginxConfig* config) {
     // Optional: Read database path from config
@@ -29,15 +30,27 @@ SimpleAuthHandler::SimpleAuthHandler(const std::string& path_prefix, const std::
     std::cout << "SimpleAuthHandler initialized with path_prefix: " << path_prefix << std::endl;
 }
 
+std::unique_ptr<reply> SimpleAuthHandler::handle_request_view(const request_view& request) {
+    // The login page needs nothing from the request, so it is answered
+    // without copying it
+    if (request.method == request_method::get && isLoginPath(request.uri)) {
+        cleanupExpiredSessions();
+        return serveLoginForm();
+    }
+    return RequestHandler::handle_request_view(request);
+}
+
 std::unique_ptr<reply> SimpleAuthHandler::handle_request(const request& request) {
     // Clean up expired sessions periodically
     cleanupExpiredSessions();
     
-    std::string decoded_uri = urlDecode(request.uri);
+    std::string decoded_uri = url_decode(uri_path(request.uri), false);
     
     // Handle login page
     if ((decoded_uri == "/login" || decoded_uri == path_prefix_) && request.method == "GET") {
-        return serveLoginForm();
+        std::unique_ptr<reply> rep = serveLoginForm();
+        rep->expand();
+        return rep;
     }
     // Handle login form submission
     else if ((decoded_uri == "/login" || decoded_uri == path_prefix_) && request.method == "POST") {
@@ -52,7 +65,7 @@ std::unique_ptr<reply> SimpleAuthHandler::handle_request(const request& request)
 }
 
 std::unique_ptr<reply> SimpleAuthHandler::serveLoginForm() {
-    std::string html = R"(
+    static constexpr std::string_view html = R"(
 <!DOCTYPE html>
 <html>
 <head>
@@ -318,18 +331,15 @@ std::unique_ptr<reply> SimpleAuthHandler::serveLoginForm() {
 </body>
 </html>
 )";
-    
-    std::vector<header> headers;
-    header content_type;
-    content_type.name = "Content-Type";
-    content_type.value = "text/html";
-    headers.push_back(content_type);
-    
-    return BuildResponse(reply::ok, html, headers);
+
+    // The page is the same for every visitor, so it is serialized once
+    static const std::shared_ptr<const prebuilt_response> form =
+        BuildPrebuiltResponse(reply::ok, html, {{"Content-Type", "text/html"}});
+    return reply::prebuilt_reply(form);
 }
 
 std::unique_ptr<reply> SimpleAuthHandler::handleLogin(const request& request) {
-    std::string email = extractFormField(request.body, "email");
+    std::string email(request.form_params().get("email"));
     
     if (email.empty()) {
         return BuildResponse(reply::bad_request, "Email required");
@@ -404,6 +414,7 @@ std::string SimpleAuthHandler::createSession(int user_id, const std::string& ema
     session.email = email;
     session.expires_at = std::time(nullptr) + 3600; // 1 hour expiry
     
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
     active_sessions_[token] = session;
     return token;
 }
@@ -424,6 +435,7 @@ std::string SimpleAuthHandler::generateSessionToken() {
 
 void SimpleAuthHandler::cleanupExpiredSessions() {
     std::time_t now = std::time(nullptr);
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
     auto it = active_sessions_.begin();
     while (it != active_sessions_.end()) {
         if (it->second.expires_at <= now) {
@@ -436,6 +448,7 @@ void SimpleAuthHandler::cleanupExpiredSessions() {
 
 // Static methods for use by other handlers
 int SimpleAuthHandler::validateSession(const std::string& session_token) {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
     auto it = active_sessions_.find(session_token);
     if (it != active_sessions_.end() && it->second.expires_at > std::time(nullptr)) {
         return it->second.user_id;
@@ -445,20 +458,11 @@ int SimpleAuthHandler::validateSession(const std::string& session_token) {
 
 std::string SimpleAuthHandler::extractSessionToken(const request& request) {
     // Extract from cookie header
-    for (const auto& header : request.headers) {
-        if (header.name == "Cookie") {
-            std::string cookie = header.value;
-            boost::smatch match;
-            boost::regex session_regex(R"((?:^|;\s*)session_token=([^;]+))");
-            if (boost::regex_search(cookie, match, session_regex)) {
-                return match[1].str();
-            }
-        }
-    }
-    return "";
+    return std::string(request.cookies().get("session_token"));
 }
 
 std::string SimpleAuthHandler::getUserEmail(const std::string& session_token) {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
     auto it = active_sessions_.find(session_token);
     if (it != active_sessions_.end() && it->second.expires_at > std::time(nullptr)) {
         return it->second.email;
@@ -467,47 +471,17 @@ std::string SimpleAuthHandler::getUserEmail(const std::string& session_token) {
 }
 
 void SimpleAuthHandler::clearSession(const std::string& session_token) {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
     active_sessions_.erase(session_token);
 }
 
-std::string SimpleAuthHandler::extractFormField(const std::string& body, const std::string& field_name) {
-    std::string search = field_name + "=";
-    size_t pos = body.find(search);
-    if (pos == std::string::npos) return "";
-    
-    pos += search.length();
-    size_t end = body.find("&", pos);
-    if (end == std::string::npos) end = body.length();
-    
-    std::string value = body.substr(pos, end - pos);
-    return urlDecode(value);
-}
-
-std::string SimpleAuthHandler::urlDecode(const std::string& encoded) {
-    std::string decoded;
-    decoded.reserve(encoded.length());
-    
-    for (size_t i = 0; i < encoded.length(); ++i) {
-        if (encoded[i] == '%' && i + 2 < encoded.length()) {
-            std::string hex = encoded.substr(i + 1, 2);
-            int value;
-            std::stringstream ss;
-            ss << std::hex << hex;
-            ss >> value;
-            decoded += static_cast<char>(value);
-            i += 2;
-        } else if (encoded[i] == '+') {
-            decoded += ' ';
-        } else {
-            decoded += encoded[i];
-        }
-    }
-    
-    return decoded;
+bool SimpleAuthHandler::isLoginPath(std::string_view uri) const {
+    std::string decoded_uri = url_decode(uri_path(uri), false);
+    return decoded_uri == "/login" || decoded_uri == path_prefix_;
 }
 
 bool SimpleAuthHandler::isValidEmail(const std::string& email) {
-    boost::regex email_regex(R"(^[^\s@]+@[^\s@]+\.[^\s@]+$)");
+    static const boost::regex email_regex(R"(^[^\s@]+@[^\s@]+\.[^\s@]+$)");
     return boost::regex_match(email, email_regex);
 }
 
@@ -6,8 +6,10 @@
 #include "request_handler_registry.h"
 #include "database_manager.h"
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <string>
+#include <string_view>
 #include <ctime>
 
 namespace http {
@@ -27,6 +29,11 @@ public:
     SimpleAuthHandler(const std::string& path_prefix, const std::string& db_path = "data/notes_app.db");
     
     std::unique_ptr<reply> handle_request(const request& request) override;
+    std::unique_ptr<reply> handle_request_view(const request_view& request) override;
+
+    // The database locks its connection and sessions_mutex_ guards the
+    // session table, so one instance serves every request
+    bool is_reusable() const override { return true; }
     
     // Static methods for use by other handlers
     static int validateSession(const std::string& session_token);
@@ -38,6 +45,7 @@ private:
     std::string path_prefix_;
     std::unique_ptr<DatabaseManager> db_manager_;
     static std::unordered_map<std::string, UserSession> active_sessions_;
+    static std::mutex sessions_mutex_;
     
     // Request handling methods
     std::unique_ptr<reply> serveLoginForm();
@@ -50,8 +58,7 @@ private:
     void cleanupExpiredSessions();
     
     // Helper methods
-    std::string extractFormField(const std::string& body, const std::string& field_name);
-    std::string urlDecode(const std::string& encoded);
+    bool isLoginPath(std::string_view uri) const;
     bool isValidEmail(const std::string& email);
 };
 
@@ -1,14 +1,19 @@
 #include "sleep_handler.h"
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <chrono>
 #include <sstream>
-#include <unistd.h> 
 #include <iostream> 
 namespace http {
 namespace server {
 
-std::unique_ptr<reply> SleepHandler::handle_request(const request& request) {
+boost::asio::awaitable<std::unique_ptr<reply>> SleepHandler::handle_request_async(const request& request) {
     int sleep_time = 5;
 
-    sleep(sleep_time);
+    boost::asio::steady_timer timer(co_await boost::asio::this_coro::executor,
+                                    std::chrono::seconds(sleep_time));
+    co_await timer.async_wait(boost::asio::use_awaitable);
     std::ostringstream oss;
     oss <<  "The request slept for " << sleep_time << " seconds\r\n" ;
 
@@ -22,7 +27,7 @@ std::unique_ptr<reply> SleepHandler::handle_request(const request& request) {
     headers.push_back(content_type);
     
     // Create and return response
-    return BuildResponse(reply::ok, content, headers);
+    co_return BuildResponse(reply::ok, content, headers);
 }
 
 bool SleepHandler::Register() {
@@ -8,7 +8,9 @@
 namespace http {
 namespace server {
 
-class SleepHandler : public RequestHandler {
+// Replies after a fixed delay. The delay is a timer wait, so a sleeping
+// request does not hold up the io thread's other connections.
+class SleepHandler : public AsyncRequestHandler {
 public:
   static RequestHandler* Init(const std::string& path_prefix, const NginxConfig* config) {
     return new SleepHandler();
@@ -16,7 +18,8 @@ public:
   
   static bool Register();
   
-  std::unique_ptr<reply> handle_request(const request& request) override;
+  boost::asio::awaitable<std::unique_ptr<reply>> handle_request_async(const request& request) override;
+  bool is_reusable() const override { return true; }
 };
 
 } // namespace server
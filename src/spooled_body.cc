@@ -0,0 +1,61 @@
+#include "spooled_body.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace http {
+namespace server {
+
+spooled_body::spooled_body() {
+  std::string path = (std::filesystem::temp_directory_path() / "body.XXXXXX").string();
+  fd_ = ::mkstemp(path.data());
+  if (fd_ < 0) {
+    throw std::runtime_error(std::string("cannot create body spool: ") + std::strerror(errno));
+  }
+  // Nothing else needs the name; the file lives only as long as fd_
+  ::unlink(path.c_str());
+}
+
+spooled_body::~spooled_body() {
+  if (mapping_) {
+    ::munmap(mapping_, size_);
+  }
+  ::close(fd_);
+}
+
+void spooled_body::append(const char* data, std::size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd_, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(std::string("cannot spool body: ") + std::strerror(errno));
+    }
+    data += written;
+    size -= written;
+    size_ += written;
+  }
+}
+
+std::string_view spooled_body::contents() {
+  if (size_ == 0) {
+    return std::string_view();
+  }
+  if (!mapping_) {
+    void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (mapping == MAP_FAILED) {
+      throw std::runtime_error(std::string("cannot map body spool: ") + std::strerror(errno));
+    }
+    mapping_ = mapping;
+  }
+  return std::string_view(static_cast<const char*>(mapping_), size_);
+}
+
+} // namespace server
+} // namespace http
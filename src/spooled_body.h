@@ -0,0 +1,43 @@
+#ifndef HTTP_SPOOLED_BODY_H
+#define HTTP_SPOOLED_BODY_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace http {
+namespace server {
+
+// A request body too large to keep in memory, written to an unlinked file
+// in the system temp directory as it arrives. Once complete it is mapped
+// back in whole, so handlers still see one contiguous body while the kernel
+// pages it in and out as they read it. The file disappears when the spool
+// is destroyed or the process exits.
+class spooled_body {
+public:
+  // Throws std::runtime_error if the temp file cannot be created
+  spooled_body();
+  ~spooled_body();
+
+  spooled_body(const spooled_body&) = delete;
+  spooled_body& operator=(const spooled_body&) = delete;
+
+  // Appends to the file; throws std::runtime_error on a write error such as
+  // a full disk
+  void append(const char* data, std::size_t size);
+
+  std::size_t size() const { return size_; }
+
+  // The whole body, valid until the spool is destroyed. Throws
+  // std::runtime_error if it cannot be mapped.
+  std::string_view contents();
+
+private:
+  int fd_;
+  std::size_t size_ = 0;
+  void* mapping_ = nullptr;
+};
+
+} // namespace server
+} // namespace http
+
+#endif // HTTP_SPOOLED_BODY_H
@@ -1,10 +1,12 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <map>
 #include <filesystem>
 #include <iostream>
 #include "static_handler.h"
+#include "url_decoding.h"
 
 namespace http {
 namespace server {
@@ -42,62 +44,101 @@ std::string StaticFileHandler::GetMimeType(const std::string& file_path) {
     return "application/octet-stream";
 }
   
-// Read file content
-bool StaticFileHandler::ReadFile(const std::string& file_path, std::string& content) {
-    std::ifstream file(file_path, std::ios::binary);
-    if (!file.is_open()) {
+// Read a whole file into content
+bool StaticFileHandler::ReadFile(file_body& file, std::pmr::string& content) {
+    content.resize(*file.size());
+    size_t offset = 0;
+    try {
+        while (offset < content.size()) {
+            size_t count = file.read(&content[offset], content.size() - offset);
+            if (count == 0) {
+                return false;
+            }
+            offset += count;
+        }
+    } catch (const std::exception& e) {
         return false;
     }
-  
-    // Get file size
-    file.seekg(0, std::ios::end);
-    size_t size = file.tellg();
-    file.seekg(0, std::ios::beg);
-  
-    // Read file content
-    content.resize(size);
-    file.read(&content[0], size);
-  
     return true;
 }
   
 // Handle HTTP request
 std::unique_ptr<reply> StaticFileHandler::handle_request(const request& request) {
-    // Extract path from URI, removing any query parameters
-    std::string path = request.uri;
-    size_t query_pos = path.find('?');
-    if (query_pos != std::string::npos) {
-        path = path.substr(0, query_pos);
+    return handle_request_view(request_view(request, request.get_allocator()));
+}
+
+std::unique_ptr<reply> StaticFileHandler::handle_request_view(const request_view& request) {
+    std::unique_ptr<file_body> file;
+    std::unique_ptr<reply> rep = StartReply(request.uri, request.get_allocator(), file);
+    if (file && !ReadFile(*file, rep->content)) {
+        return BuildResponse(reply::internal_server_error, "500 Internal Server Error", {},
+                             request.get_allocator());
+    }
+    return rep;
+}
+
+boost::asio::awaitable<std::unique_ptr<reply>> StaticFileHandler::handle_request_async(const request& request) {
+#ifdef HTTP_HAS_ASYNC_FILE
+    std::unique_ptr<file_body> file;
+    std::unique_ptr<reply> rep = StartReply(request.uri, request.get_allocator(), file);
+    if (file) {
+        body_source::file_range range = *file->file();
+        rep->content.resize(range.length);
+        if (!co_await async_read_file(range.fd, range.offset, rep->content.data(), range.length)) {
+            co_return BuildResponse(reply::internal_server_error, "500 Internal Server Error", {},
+                                    request.get_allocator());
+        }
     }
+    co_return rep;
+#else
+    co_return handle_request(request);
+#endif
+}
+
+std::unique_ptr<reply> StaticFileHandler::StartReply(std::string_view uri,
+                                                     const reply::allocator_type& alloc,
+                                                     std::unique_ptr<file_body>& file) {
+    // Extract path from URI, removing any query parameters
+    std::string_view path = uri_path(uri);
   
     // Check if the URI starts with our path prefix
     if (path.compare(0, path_prefix_.length(), path_prefix_) != 0) {
         // URI doesn't match our prefix, return 404
-        return BuildResponse(reply::not_found, "404 Not Found");
+        return BuildResponse(reply::not_found, "404 Not Found", {}, alloc);
     }
     
     // Remove the path prefix to get the relative file path
-    std::string relative_path = path.substr(path_prefix_.length());
+    std::string_view relative_path = path.substr(path_prefix_.length());
     if (!relative_path.empty() && relative_path.front() == '/') {
-        relative_path = relative_path.substr(1);
+        relative_path.remove_prefix(1);
     }
-    std::string file_path = "." + root_dir_ + "/" + relative_path;
+    std::string file_path = "." + root_dir_ + "/";
+    file_path += relative_path;
   
-    // Try to read the file
-    std::string content;
-    if (ReadFile(file_path, content)) {
-        // File found, serve it
-        std::vector<header> headers;
-        header content_type;
-        content_type.name = "Content-Type";
-        content_type.value = GetMimeType(file_path);
-        headers.push_back(content_type);
-        
-        return BuildResponse(reply::ok, content, headers);
-    } else {
+    std::unique_ptr<file_body> opened = file_body::open(file_path);
+    if (!opened) {
         // File not found, return 404
-        return BuildResponse(reply::not_found, "404 Not Found");
+        return BuildResponse(reply::not_found, "404 Not Found", {}, alloc);
     }
+
+    // File found, serve it
+    std::vector<header> headers;
+    header content_type;
+    content_type.name = "Content-Type";
+    content_type.value = GetMimeType(file_path);
+    headers.push_back(content_type);
+
+    // Large files stay in the page cache: the session sends them to the
+    // socket with sendfile(2), and only the headers pass through user space
+    if (*opened->size() > stream_threshold) {
+        return BuildStreamingResponse(reply::ok, std::move(opened), headers, alloc);
+    }
+
+    // Small ones go out with the headers in one write, read straight into
+    // the reply so they are copied once
+    headers.push_back({"Content-Length", std::to_string(*opened->size())});
+    file = std::move(opened);
+    return BuildResponse(reply::ok, "", headers, alloc);
 }
 
 bool StaticFileHandler::Register() {
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include "async_file.h"
 #include "request_handler.hpp"
 #include "config_parser.h"
 #include "request_handler_registry.h"
@@ -24,27 +25,61 @@ public:
       return nullptr;
     }
     
-    return new StaticFileHandler(root_dir, path_prefix);
+    // "aio on;" reads files without blocking the io thread, which needs a
+    // build on io_uring (see async_file.h)
+    std::string aio = config->FindConfigToken("aio");
+    if (!aio.empty() && aio != "on" && aio != "off") {
+      std::cerr << "Error: aio must be 'on' or 'off'" << std::endl;
+      return nullptr;
+    }
+#ifndef HTTP_HAS_ASYNC_FILE
+    if (aio == "on") {
+      std::cerr << "Warning: aio needs a build on io_uring; reading files synchronously" << std::endl;
+      aio.clear();
+    }
+#endif
+
+    return new StaticFileHandler(root_dir, path_prefix, aio == "on");
   }
   
   // Register handler with static initializer function
   static bool Register();
   
-  StaticFileHandler(const std::string& root_dir, const std::string& path_prefix) 
-  : root_dir_(root_dir), path_prefix_(path_prefix) {
+  StaticFileHandler(const std::string& root_dir, const std::string& path_prefix,
+                    bool aio = false)
+  : root_dir_(root_dir), path_prefix_(path_prefix), aio_(aio) {
     InitMimeTypeMap();
   }
 
   std::unique_ptr<reply> handle_request(const request& request) override;
+  std::unique_ptr<reply> handle_request_view(const request_view& request) override;
+
+  // The root, prefix and MIME table are only read after construction
+  bool is_reusable() const override { return true; }
+
+  // With aio, small files are read by handle_request_async() on io_uring
+  bool is_async() const override { return aio_; }
+  boost::asio::awaitable<std::unique_ptr<reply>> handle_request_async(const request& request) override;
+
+  // Files larger than this are sent from the file rather than read into the
+  // reply; smaller ones are cheaper to write along with the headers and can
+  // be compressed
+  static const size_t stream_threshold = 64 * 1024;
 
 private:
   std::string root_dir_;
   std::string path_prefix_;
   std::map<std::string, std::string> mime_type_map_;
+  bool aio_;
   
   void InitMimeTypeMap();
+
+  // The reply for uri, except that a small file's content is left for the
+  // caller to read from file, which is null otherwise
+  std::unique_ptr<reply> StartReply(std::string_view uri, const reply::allocator_type& alloc,
+                                    std::unique_ptr<file_body>& file);
   std::string GetMimeType(const std::string& file_path);
-  bool ReadFile(const std::string& file_path, std::string& content);
+  bool ReadFile(file_body& file, std::pmr::string& content);
 };
 
 } // namespace server
@@ -66,7 +66,7 @@ TEST_F(APIHandlerTest, RetrieveSuccess) {
   auto rep = handler_->handle_request(req);
 
   EXPECT_EQ(rep->status, reply::ok);
-  EXPECT_EQ(rep->content, payload);
+  EXPECT_EQ(std::string(rep->content), payload);
 }
 
 TEST_F(APIHandlerTest, RetrieveNotFound) {
@@ -135,3 +135,24 @@ TEST_F(APIHandlerTest, ListNotFound) {
   auto rep = handler_->handle_request(req);
   EXPECT_EQ(rep->status, reply::not_found);
 }
+
+/* ----- routed requests ----- */
+TEST_F(APIHandlerTest, UsesRouteRemainderAndParams) {
+  http::server::router routes;
+  ASSERT_TRUE(routes.add("/v2/store", 0));
+  ASSERT_TRUE(routes.add("/v3/{entity}/{id}", 1));
+  routes.compile();
+
+  // The handler's own prefix is not in the path; the route says where it ends
+  EXPECT_CALL(*mock_, DeleteEntity("Shoes", "4")).WillOnce(Return(true));
+  request req; req.method="DELETE"; req.uri="/v2/store/Shoes/4";
+  ASSERT_NE(routes.match(req.uri, req.route), nullptr);
+  EXPECT_EQ(handler_->handle_request(req)->status, reply::ok);
+
+  const std::string payload = R"({"x":9})";
+  EXPECT_CALL(*mock_, RetrieveEntity("Hats", "7", _))
+      .WillOnce(DoAll(SetArgReferee<2>(payload), Return(true)));
+  request get; get.method="GET"; get.uri="/v3/Hats/7?fields=x";
+  ASSERT_NE(routes.match(get.uri, get.route), nullptr);
+  EXPECT_EQ(std::string(handler_->handle_request(get)->content), payload);
+}
@@ -0,0 +1,83 @@
+#!/bin/bash
+
+# Benchmark of the epoll and io_uring builds on the same static file workload
+# Usage: ./tests/benchmark_io_backend.sh <epoll server binary> <io_uring server binary>
+#
+# Build the io_uring binary with
+#   cmake -DCMAKE_CXX_FLAGS="-DBOOST_ASIO_HAS_IO_URING -DBOOST_ASIO_DISABLE_EPOLL" \
+#         -DCMAKE_EXE_LINKER_FLAGS="-luring" ..
+# Needs wrk. Each build serves the same files, first with "aio off;" and
+# then (io_uring only) with "aio on;", and the script prints requests per
+# second, throughput and server CPU time per GB sent for every run.
+
+EPOLL_SERVER="$1"
+URING_SERVER="$2"
+PORT=8089
+DURATION=${DURATION:-15}
+CONNECTIONS=${CONNECTIONS:-64}
+THREADS=${THREADS:-4}
+WORK_DIR=$(mktemp -d)
+
+if [ -z "$EPOLL_SERVER" ] || [ -z "$URING_SERVER" ]; then
+    echo "Usage: $0 <epoll server binary> <io_uring server binary>"
+    exit 1
+fi
+if ! command -v wrk > /dev/null; then
+    echo "wrk is required"
+    exit 1
+fi
+
+# Small files are read into the reply (asynchronously with aio on); large
+# ones are sent with sendfile
+mkdir -p "$WORK_DIR/files"
+head -c 4096 /dev/urandom > "$WORK_DIR/files/small.bin"
+head -c 1048576 /dev/urandom > "$WORK_DIR/files/large.bin"
+
+write_config() {
+    cat > "$WORK_DIR/config" <<CONFIG
+port $PORT;
+threads $THREADS;
+location /files StaticHandler {
+  root $WORK_DIR/files;
+  aio $1;
+}
+CONFIG
+}
+
+# Prints utime + stime of a process in seconds
+cpu_seconds() {
+    awk -v ticks="$(getconf CLK_TCK)" '{ printf "%.2f", ($14 + $15) / ticks }' "/proc/$1/stat"
+}
+
+run() {
+    local name="$1" server="$2" aio="$3" file="$4"
+    write_config "$aio"
+    # The static handler resolves roots against the working directory
+    (cd / && exec "$server" "$WORK_DIR/config" > "$WORK_DIR/server.log" 2>&1) &
+    local pid=$!
+    sleep 1
+
+    local before=$(cpu_seconds $pid)
+    local result=$(wrk -t"$THREADS" -c"$CONNECTIONS" -d"${DURATION}s" "http://localhost:$PORT/files/$file")
+    local after=$(cpu_seconds $pid)
+    kill -TERM $pid
+    wait $pid 2> /dev/null
+
+    local rps=$(echo "$result" | awk '/Requests\/sec/ { print $2 }')
+    local transfer=$(echo "$result" | awk '/Transfer\/sec/ { print $2 }')
+    local bytes=$(echo "$result" | awk '/read$/ { print $(NF-1) }')
+    local gb=$(echo "$bytes" | awk '/GB$/ { sub("GB", ""); print; next } /MB$/ { sub("MB", ""); print $0 / 1024; next } { print 0 }')
+    local cpu=$(awk -v a="$after" -v b="$before" 'BEGIN { printf "%.2f", a - b }')
+    local cpu_per_gb=$(awk -v c="$cpu" -v g="$gb" 'BEGIN { if (g > 0) printf "%.2f", c / g; else print "n/a" }')
+    printf "%-10s aio %-3s %-10s %10s req/s %10s/s %8s cpu s %8s cpu s/GB\n" \
+        "$name" "$aio" "$file" "$rps" "$transfer" "$cpu" "$cpu_per_gb"
+}
+
+echo "=== I/O backend benchmark (${DURATION}s, $CONNECTIONS connections) ==="
+for file in small.bin large.bin; do
+    run epoll "$EPOLL_SERVER" off "$file"
+    run io_uring "$URING_SERVER" off "$file"
+    run io_uring "$URING_SERVER" on "$file"
+done
+
+rm -rf "$WORK_DIR"
@@ -0,0 +1,173 @@
+#include "gtest/gtest.h"
+#include "blocking_handler.h"
+#include "echo_handler.hpp"
+#include "sleep_handler.h"
+#include "request_handler_registry.h"
+#include "request.hpp"
+#include "reply.hpp"
+#include <boost/asio.hpp>
+#include <stdexcept>
+#include <thread>
+
+namespace http {
+namespace server {
+
+// Records which thread it ran on
+class ThreadRecordingHandler : public RequestHandler {
+public:
+    explicit ThreadRecordingHandler(std::thread::id& ran_on) : ran_on_(ran_on) {}
+
+    std::unique_ptr<reply> handle_request(const request& request) override {
+        ran_on_ = std::this_thread::get_id();
+        return BuildResponse(reply::ok, "ran " + request.uri);
+    }
+
+private:
+    std::thread::id& ran_on_;
+};
+
+class ThrowingHandler : public RequestHandler {
+public:
+    std::unique_ptr<reply> handle_request(const request& request) override {
+        throw std::runtime_error("pdftotext failed");
+    }
+};
+
+// Collects a streamed body
+class StreamingBodyHandler : public RequestHandler {
+public:
+    std::unique_ptr<reply> handle_request(const request& request) override {
+        return BuildResponse(reply::ok, "no body");
+    }
+    bool streams_body() const override { return true; }
+    std::unique_ptr<reply> on_headers(const request_view& request) override {
+        body_.clear();
+        return nullptr;
+    }
+    void on_body_chunk(std::string_view chunk) override { body_.append(chunk); }
+    std::unique_ptr<reply> on_complete() override {
+        return BuildResponse(reply::ok, "got " + body_);
+    }
+
+private:
+    std::string body_;
+};
+
+class BlockingHandlerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        req.method = "GET";
+        req.uri = "/view/report.pdf";
+        req.http_version_major = 1;
+        req.http_version_minor = 1;
+    }
+
+    // Runs handler's coroutine on io_context from this thread, like a session would
+    std::unique_ptr<reply> Run(BlockingRequestHandler& handler, std::exception_ptr& error,
+                               std::thread::id& completed_on) {
+        std::unique_ptr<reply> result;
+        boost::asio::co_spawn(io_context, handler.handle_request_async(req),
+            [&](std::exception_ptr e, std::unique_ptr<reply> rep) {
+                error = e;
+                result = std::move(rep);
+                completed_on = std::this_thread::get_id();
+            });
+        io_context.run();
+        return result;
+    }
+
+    request req;
+    boost::asio::io_context io_context;
+    std::shared_ptr<boost::asio::thread_pool> pool = std::make_shared<boost::asio::thread_pool>(2);
+};
+
+// The handler runs on a pool thread and the reply comes back to the io thread
+TEST_F(BlockingHandlerTest, RunsHandlerOnPool) {
+    std::thread::id ran_on;
+    BlockingRequestHandler handler(std::make_unique<ThreadRecordingHandler>(ran_on), pool);
+    EXPECT_TRUE(handler.is_async());
+
+    std::exception_ptr error;
+    std::thread::id completed_on;
+    auto rep = Run(handler, error, completed_on);
+
+    ASSERT_TRUE(rep);
+    EXPECT_FALSE(error);
+    EXPECT_EQ(rep->status, reply::ok);
+    EXPECT_EQ(rep->content, "ran /view/report.pdf");
+    EXPECT_NE(ran_on, std::this_thread::get_id());
+    EXPECT_EQ(completed_on, std::this_thread::get_id());
+}
+
+// An exception thrown on the pool reaches the io thread
+TEST_F(BlockingHandlerTest, PropagatesException) {
+    BlockingRequestHandler handler(std::make_unique<ThrowingHandler>(), pool);
+
+    std::exception_ptr error;
+    std::thread::id completed_on;
+    auto rep = Run(handler, error, completed_on);
+
+    EXPECT_FALSE(rep);
+    ASSERT_TRUE(error);
+    EXPECT_THROW(std::rethrow_exception(error), std::runtime_error);
+    EXPECT_EQ(completed_on, std::this_thread::get_id());
+}
+
+// The synchronous adapter still works for callers without an io thread
+TEST_F(BlockingHandlerTest, HandleRequestRunsToCompletion) {
+    std::thread::id ran_on;
+    BlockingRequestHandler handler(std::make_unique<ThreadRecordingHandler>(ran_on), pool);
+
+    auto rep = handler.handle_request(req);
+    ASSERT_TRUE(rep);
+    EXPECT_EQ(rep->content, "ran /view/report.pdf");
+    EXPECT_NE(ran_on, std::this_thread::get_id());
+}
+
+// The streaming body hooks go straight through to the wrapped handler
+TEST_F(BlockingHandlerTest, ForwardsStreamingHooks) {
+    BlockingRequestHandler handler(std::make_unique<StreamingBodyHandler>(), pool);
+    ASSERT_TRUE(handler.streams_body());
+
+    request_view head;
+    EXPECT_FALSE(handler.on_headers(head));
+    handler.on_body_chunk("abc");
+    handler.on_body_chunk("def");
+    auto rep = handler.on_complete();
+    ASSERT_TRUE(rep);
+    EXPECT_EQ(rep->content, "got abcdef");
+}
+
+// Only blocking locations are wrapped, and only when there is a pool
+TEST_F(BlockingHandlerTest, RegistryWrapsBlockingLocations) {
+    EchoHandler::Register();
+    SleepHandler::Register();
+
+    std::map<std::string, HandlerConfig> handler_configs;
+    HandlerConfig blocking_echo;
+    blocking_echo.type = "EchoHandler";
+    blocking_echo.blocking = true;
+    handler_configs["/slow"] = std::move(blocking_echo);
+    HandlerConfig echo;
+    echo.type = "EchoHandler";
+    handler_configs["/echo"] = std::move(echo);
+    HandlerConfig blocking_sleep;
+    blocking_sleep.type = "SleepHandler";
+    blocking_sleep.blocking = true;
+    handler_configs["/sleep"] = std::move(blocking_sleep);
+
+    std::string name;
+    RequestHandlerRegistry registry;
+    ASSERT_TRUE(registry.Init(handler_configs, pool));
+    EXPECT_TRUE(dynamic_cast<BlockingRequestHandler*>(registry.CreateHandler("/slow", name).get()));
+    EXPECT_EQ(name, "EchoHandler");
+    EXPECT_FALSE(dynamic_cast<BlockingRequestHandler*>(registry.CreateHandler("/echo", name).get()));
+    EXPECT_FALSE(dynamic_cast<BlockingRequestHandler*>(registry.CreateHandler("/sleep", name).get()));
+
+    RequestHandlerRegistry no_pool;
+    ASSERT_TRUE(no_pool.Init(handler_configs));
+    EXPECT_FALSE(dynamic_cast<BlockingRequestHandler*>(no_pool.CreateHandler("/slow", name).get()));
+}
+
+} // namespace server
+} // namespace http
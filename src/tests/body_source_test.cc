@@ -0,0 +1,121 @@
+#include "gtest/gtest.h"
+#include "body_source.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using http::server::body_source;
+using http::server::file_body;
+using http::server::generator_body;
+using http::server::string_body;
+
+namespace {
+
+// Reads body to the end, capacity bytes at a time
+std::string ReadAll(body_source& body, size_t capacity) {
+  std::string result;
+  std::string buffer(capacity, '\0');
+  while (size_t count = body.read(buffer.data(), capacity)) {
+    result.append(buffer.data(), count);
+  }
+  return result;
+}
+
+}  // namespace
+
+// TEST: A string body reports its size and reads back in pieces
+TEST(BodySourceTest, StringBodyReadsInPieces) {
+  string_body body("hello, streaming world");
+  ASSERT_TRUE(body.size().has_value());
+  EXPECT_EQ(*body.size(), 22);
+  EXPECT_EQ(ReadAll(body, 5), "hello, streaming world");
+  char out[4];
+  EXPECT_EQ(body.read(out, sizeof(out)), 0);
+}
+
+// TEST: A file body covers the requested region of the file only
+TEST(BodySourceTest, FileBodyReadsRegion) {
+  const std::string path = "./body_source_test.txt";
+  {
+    std::ofstream file(path);
+    file << "0123456789abcdef";
+  }
+
+  std::unique_ptr<file_body> whole = file_body::open(path);
+  ASSERT_NE(whole, nullptr);
+  EXPECT_EQ(*whole->size(), 16);
+  EXPECT_EQ(ReadAll(*whole, 3), "0123456789abcdef");
+
+  std::unique_ptr<file_body> region = file_body::open(path, 4, 6);
+  ASSERT_NE(region, nullptr);
+  EXPECT_EQ(*region->size(), 6);
+  EXPECT_EQ(ReadAll(*region, 4), "456789");
+
+  // Regions past the end of the file are refused
+  EXPECT_EQ(file_body::open(path, 10, 7), nullptr);
+  std::remove(path.c_str());
+}
+
+// TEST: A file body exposes the unsent part of its region for sendfile
+TEST(BodySourceTest, FileBodyExposesFileRange) {
+  const std::string path = "./body_source_range.txt";
+  {
+    std::ofstream file(path);
+    file << "0123456789abcdef";
+  }
+  std::unique_ptr<file_body> body = file_body::open(path, 4, 8);
+  ASSERT_NE(body, nullptr);
+  std::optional<body_source::file_range> range = body->file();
+  ASSERT_TRUE(range.has_value());
+  EXPECT_GE(range->fd, 0);
+  EXPECT_EQ(range->offset, 4);
+  EXPECT_EQ(range->length, 8);
+
+  // What was sent from the file is not read again
+  body->consume(5);
+  EXPECT_EQ(body->file()->offset, 9);
+  EXPECT_EQ(body->file()->length, 3);
+  EXPECT_EQ(ReadAll(*body, 16), "9ab");
+  EXPECT_EQ(body->file()->length, 0);
+  std::remove(path.c_str());
+
+  string_body in_memory("not a file");
+  EXPECT_FALSE(in_memory.file().has_value());
+}
+
+// TEST: Missing files and directories cannot be opened as bodies
+TEST(BodySourceTest, FileBodyRejectsNonRegularFiles) {
+  EXPECT_EQ(file_body::open("./no_such_file.txt"), nullptr);
+  EXPECT_EQ(file_body::open("."), nullptr);
+}
+
+// TEST: A file truncated after opening fails instead of ending short
+TEST(BodySourceTest, FileBodyThrowsWhenTruncated) {
+  const std::string path = "./body_source_truncated.txt";
+  {
+    std::ofstream file(path);
+    file << "0123456789";
+  }
+  std::unique_ptr<file_body> body = file_body::open(path);
+  ASSERT_NE(body, nullptr);
+  std::ofstream(path, std::ios::trunc).close();
+
+  char out[16];
+  EXPECT_THROW(body->read(out, sizeof(out)), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+// TEST: A generator body has no known size and ends when the generator returns 0
+TEST(BodySourceTest, GeneratorBodyHasUnknownSize) {
+  int calls = 0;
+  generator_body body([&calls](char* out, size_t capacity) -> size_t {
+    if (calls == 3) return 0;
+    ++calls;
+    std::memcpy(out, "ab", 2);
+    return 2;
+  });
+  EXPECT_FALSE(body.size().has_value());
+  EXPECT_EQ(ReadAll(body, 16), "ababab");
+}
@@ -0,0 +1,244 @@
+#include "gtest/gtest.h"
+#include "compressing_handler.h"
+#include "compression.h"
+#include "echo_handler.hpp"
+#include "request_handler_registry.h"
+#include "request.hpp"
+#include "reply.hpp"
+#include <string>
+#include <zlib.h>
+
+namespace http {
+namespace server {
+
+namespace {
+
+// Inflates a gzip or zlib stream; windowBits 47 detects either wrapper
+std::string Inflate(std::string_view data) {
+  z_stream stream{};
+  EXPECT_EQ(inflateInit2(&stream, 15 + 32), Z_OK);
+  std::string out(64 * 1024, '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef*>(out.data());
+  stream.avail_out = out.size();
+  EXPECT_EQ(inflate(&stream, Z_FINISH), Z_STREAM_END);
+  out.resize(stream.total_out);
+  inflateEnd(&stream);
+  return out;
+}
+
+std::string HeaderValue(const reply& rep, std::string_view name) {
+  for (const header& h : rep.headers) {
+    if (h.name == name) {
+      return std::string(h.value);
+    }
+  }
+  return "";
+}
+
+// Replies with a page that compresses well
+class PageHandler : public RequestHandler {
+public:
+  std::unique_ptr<reply> handle_request(const request& request) override {
+    return BuildResponse(reply::ok, Page(), {{"Content-Type", "text/html; charset=utf-8"}});
+  }
+
+  static std::string Page() {
+    std::string page;
+    for (int i = 0; i < 200; ++i) {
+      page += "<p>line " + std::to_string(i) + " of a repetitive page</p>\n";
+    }
+    return page;
+  }
+};
+
+// A handler that claims to be reusable, streaming bodies or not
+class ReusableHandler : public RequestHandler {
+public:
+  explicit ReusableHandler(bool streams) : streams_(streams) {}
+  std::unique_ptr<reply> handle_request(const request& request) override {
+    return BuildResponse(reply::ok, "");
+  }
+  bool is_reusable() const override { return true; }
+  bool streams_body() const override { return streams_; }
+
+private:
+  bool streams_;
+};
+
+} // namespace
+
+// TEST: gzip wins ties, q=0 refuses a coding and "*" covers unnamed ones
+TEST(CompressionTest, NegotiatesCoding) {
+  EXPECT_EQ(negotiate_coding(""), content_coding::identity);
+  EXPECT_EQ(negotiate_coding("gzip, deflate, br"), content_coding::gzip);
+  EXPECT_EQ(negotiate_coding("deflate"), content_coding::deflate);
+  EXPECT_EQ(negotiate_coding("GZIP;q=0.5, deflate;q=0.8"), content_coding::deflate);
+  EXPECT_EQ(negotiate_coding("gzip;q=0, deflate;q=0"), content_coding::identity);
+  EXPECT_EQ(negotiate_coding("br, identity"), content_coding::identity);
+  EXPECT_EQ(negotiate_coding("*"), content_coding::gzip);
+  EXPECT_EQ(negotiate_coding("gzip;q=0, *"), content_coding::deflate);
+  EXPECT_EQ(negotiate_coding("*;q=0"), content_coding::identity);
+}
+
+// TEST: Eligible replies are compressed and their headers updated
+TEST(CompressionTest, CompressesEligibleReply) {
+  CompressionOptions options;
+  for (std::string coding : {"gzip", "deflate"}) {
+    reply rep;
+    rep.content = PageHandler::Page();
+    rep.headers = {{"Content-Length", std::to_string(rep.content.size())},
+                   {"Content-Type", "text/html"}};
+
+    ASSERT_TRUE(compress_reply(rep, coding, options));
+    EXPECT_LT(rep.content.size(), PageHandler::Page().size());
+    EXPECT_EQ(HeaderValue(rep, "Content-Length"), std::to_string(rep.content.size()));
+    EXPECT_EQ(HeaderValue(rep, "Content-Encoding"), coding);
+    EXPECT_EQ(HeaderValue(rep, "Vary"), "Accept-Encoding");
+    EXPECT_EQ(Inflate(rep.content), PageHandler::Page());
+  }
+}
+
+// TEST: Small, unlisted, streamed or already encoded replies are left alone
+TEST(CompressionTest, SkipsIneligibleReplies) {
+  CompressionOptions options;
+
+  reply small;
+  small.content = "<p>short</p>";
+  small.headers = {{"Content-Type", "text/html"}};
+  EXPECT_FALSE(compress_reply(small, "gzip", options));
+  EXPECT_EQ(HeaderValue(small, "Vary"), "");
+
+  reply image;
+  image.content = PageHandler::Page();
+  image.headers = {{"Content-Type", "image/png"}};
+  EXPECT_FALSE(compress_reply(image, "gzip", options));
+  EXPECT_EQ(std::string_view(image.content), PageHandler::Page());
+
+  reply encoded;
+  encoded.content = PageHandler::Page();
+  encoded.headers = {{"Content-Type", "text/html"}, {"Content-Encoding", "br"}};
+  EXPECT_FALSE(compress_reply(encoded, "gzip", options));
+
+  reply streamed;
+  streamed.headers = {{"Content-Type", "text/html"}};
+  streamed.body = std::make_unique<string_body>(PageHandler::Page());
+  EXPECT_FALSE(compress_reply(streamed, "gzip", options));
+}
+
+// TEST: An eligible reply varies on Accept-Encoding even when sent as is
+TEST(CompressionTest, VariesWithoutAcceptedCoding) {
+  CompressionOptions options;
+  reply rep;
+  rep.content = PageHandler::Page();
+  rep.headers = {{"Content-Type", "text/html"}, {"Vary", "Origin"}};
+  EXPECT_FALSE(compress_reply(rep, "br", options));
+  EXPECT_EQ(std::string_view(rep.content), PageHandler::Page());
+  EXPECT_EQ(HeaderValue(rep, "Vary"), "Origin, Accept-Encoding");
+  EXPECT_EQ(HeaderValue(rep, "Content-Encoding"), "");
+}
+
+// TEST: A prebuilt reply is compressed once per coding and then shared,
+// and is never copied out of its response
+TEST(CompressionTest, CompressesPrebuiltReplyOnce) {
+  CompressionOptions options;
+  reply source;
+  source.content = PageHandler::Page();
+  source.headers = {{"Content-Type", "text/html"}};
+  auto response = std::make_shared<const prebuilt_response>(source);
+
+  std::unique_ptr<reply> first = reply::prebuilt_reply(response);
+  ASSERT_TRUE(compress_reply(*first, "gzip", options));
+  ASSERT_TRUE(first->prebuilt);
+  EXPECT_NE(first->prebuilt, response);
+  EXPECT_TRUE(first->content.empty());
+  EXPECT_EQ(Inflate(first->prebuilt->content()), PageHandler::Page());
+  EXPECT_NE(first->prebuilt->head(true).find("Content-Encoding: gzip\r\n"), std::string::npos);
+  EXPECT_NE(first->prebuilt->head(true).find("Vary: Accept-Encoding\r\n"), std::string::npos);
+
+  std::unique_ptr<reply> second = reply::prebuilt_reply(response);
+  ASSERT_TRUE(compress_reply(*second, "gzip", options));
+  EXPECT_EQ(second->prebuilt, first->prebuilt);
+
+  // Another coding gets its own variant; no coding gets only Vary
+  std::unique_ptr<reply> deflated = reply::prebuilt_reply(response);
+  ASSERT_TRUE(compress_reply(*deflated, "deflate", options));
+  EXPECT_NE(deflated->prebuilt, first->prebuilt);
+  std::unique_ptr<reply> plain = reply::prebuilt_reply(response);
+  EXPECT_FALSE(compress_reply(*plain, "br", options));
+  ASSERT_TRUE(plain->prebuilt);
+  EXPECT_EQ(plain->prebuilt->content(), PageHandler::Page());
+  EXPECT_NE(plain->prebuilt->head(false).find("Vary: Accept-Encoding\r\n"), std::string::npos);
+}
+
+// TEST: An ineligible prebuilt reply keeps its response untouched
+TEST(CompressionTest, SkipsIneligiblePrebuiltReply) {
+  CompressionOptions options;
+  reply source;
+  source.content = PageHandler::Page();
+  source.headers = {{"Content-Type", "image/png"}};
+  auto response = std::make_shared<const prebuilt_response>(source);
+
+  std::unique_ptr<reply> rep = reply::prebuilt_reply(response);
+  EXPECT_FALSE(compress_reply(*rep, "gzip", options));
+  EXPECT_EQ(rep->prebuilt, response);
+  EXPECT_TRUE(rep->headers.empty());
+}
+
+// TEST: The decorator compresses per the request's Accept-Encoding
+TEST(CompressionTest, HandlerUsesRequestAcceptEncoding) {
+  CompressionOptions options;
+  CompressingRequestHandler handler(std::make_unique<PageHandler>(), options);
+
+  request req;
+  req.method = "GET";
+  req.uri = "/";
+  req.http_version_major = 1;
+  req.http_version_minor = 1;
+  req.headers.push_back({"accept-encoding", "gzip"});
+  std::unique_ptr<reply> rep = handler.handle_request(req);
+  ASSERT_TRUE(rep);
+  EXPECT_EQ(HeaderValue(*rep, "Content-Encoding"), "gzip");
+  EXPECT_EQ(Inflate(rep->content), PageHandler::Page());
+
+  request_view view(req);
+  view.headers.clear();
+  view.index_headers();
+  rep = handler.handle_request_view(view);
+  ASSERT_TRUE(rep);
+  EXPECT_EQ(HeaderValue(*rep, "Content-Encoding"), "");
+  EXPECT_EQ(std::string_view(rep->content), PageHandler::Page());
+}
+
+// TEST: The decorator is shared only when it keeps no state between calls
+TEST(CompressionTest, StreamingHandlerIsNotReusable) {
+  CompressionOptions options;
+  EXPECT_TRUE(CompressingRequestHandler(std::make_unique<ReusableHandler>(false), options).is_reusable());
+  EXPECT_FALSE(CompressingRequestHandler(std::make_unique<ReusableHandler>(true), options).is_reusable());
+  EXPECT_FALSE(CompressingRequestHandler(std::make_unique<PageHandler>(), options).is_reusable());
+}
+
+// TEST: Only "gzip on;" locations are wrapped
+TEST(CompressionTest, RegistryWrapsCompressedLocations) {
+  EchoHandler::Register();
+
+  std::map<std::string, HandlerConfig> handler_configs;
+  HandlerConfig gzip_echo;
+  gzip_echo.type = "EchoHandler";
+  gzip_echo.compression.enabled = true;
+  handler_configs["/gzip"] = std::move(gzip_echo);
+  HandlerConfig echo;
+  echo.type = "EchoHandler";
+  handler_configs["/echo"] = std::move(echo);
+
+  std::string name;
+  RequestHandlerRegistry registry;
+  ASSERT_TRUE(registry.Init(handler_configs));
+  EXPECT_TRUE(dynamic_cast<CompressingRequestHandler*>(registry.CreateHandler("/gzip", name).get()));
+  EXPECT_EQ(name, "EchoHandler");
+  EXPECT_FALSE(dynamic_cast<CompressingRequestHandler*>(registry.CreateHandler("/echo", name).get()));
+}
+
+} // namespace server
+} // namespace http
@@ -70,6 +70,113 @@ TEST_F(ConfigParserExtendedTest, ExtractHandlerConfigs_TrailingSlash) {
   EXPECT_TRUE(handler_configs.find("/static") != handler_configs.end());
 }
 
+// TEST: Paths with {param} segments are quoted; malformed paths are skipped
+TEST_F(ConfigParserExtendedTest, ExtractHandlerConfigs_ParamPaths) {
+  const std::string config_string =
+    "location \"/api/notes/{id}\" ApiHandler {}\n"
+    "location '/users/{user}/files' StaticHandler {}\n"
+    "location \"/bad/{}\" EchoHandler {}\n"
+    "location \"/bad/x{id}\" EchoHandler {}\n"
+    "location /bad//path EchoHandler {}\n";
+
+  ASSERT_TRUE(ParseString(config_string));
+
+  auto handler_configs = out_config.ExtractHandlerConfigs();
+  EXPECT_EQ(handler_configs.size(), 2);
+  EXPECT_EQ(handler_configs["/api/notes/{id}"].type, "ApiHandler");
+  EXPECT_EQ(handler_configs["/users/{user}/files"].type, "StaticHandler");
+}
+
+// TEST: "blocking on;" marks a location for the blocking thread pool
+TEST_F(ConfigParserExtendedTest, ExtractHandlerConfigs_Blocking) {
+  const std::string config_string =
+    "port 8080;\n"
+    "location /echo EchoHandler {}\n"
+    "location /view TextViewHandler {\n"
+    "  view_dir ./uploads;\n"
+    "  blocking on;\n"
+    "}\n"
+    "location /static StaticHandler {\n"
+    "  blocking off;\n"
+    "}\n"
+    "location /bad EchoHandler {\n"
+    "  blocking yes;\n"
+    "}\n";
+
+  ASSERT_TRUE(ParseString(config_string));
+
+  auto handler_configs = out_config.ExtractHandlerConfigs();
+  EXPECT_EQ(handler_configs.size(), 3);
+  EXPECT_FALSE(handler_configs["/echo"].blocking);
+  EXPECT_TRUE(handler_configs["/view"].blocking);
+  EXPECT_FALSE(handler_configs["/static"].blocking);
+  EXPECT_TRUE(handler_configs.find("/bad") == handler_configs.end());
+}
+
+// TEST: gzip directives configure compression per location
+TEST_F(ConfigParserExtendedTest, ExtractHandlerConfigs_Compression) {
+  const std::string config_string =
+    "port 8080;\n"
+    "location /echo EchoHandler {}\n"
+    "location /static StaticHandler {\n"
+    "  gzip on;\n"
+    "  gzip_min_length 2k;\n"
+    "  gzip_types text/HTML image/svg+xml;\n"
+    "  gzip_comp_level 9;\n"
+    "}\n"
+    "location /api EchoHandler {\n"
+    "  gzip on;\n"
+    "}\n"
+    "location /bad EchoHandler {\n"
+    "  gzip on;\n"
+    "  gzip_comp_level 10;\n"
+    "}\n";
+
+  ASSERT_TRUE(ParseString(config_string));
+
+  auto handler_configs = out_config.ExtractHandlerConfigs();
+  EXPECT_EQ(handler_configs.size(), 3);
+  EXPECT_FALSE(handler_configs["/echo"].compression.enabled);
+
+  const CompressionOptions& static_options = handler_configs["/static"].compression;
+  EXPECT_TRUE(static_options.enabled);
+  EXPECT_EQ(static_options.min_length, 2048);
+  EXPECT_EQ(static_options.types, std::vector<std::string>({"text/html", "image/svg+xml"}));
+  EXPECT_EQ(static_options.level, 9);
+
+  const CompressionOptions& api_options = handler_configs["/api"].compression;
+  EXPECT_TRUE(api_options.enabled);
+  EXPECT_EQ(api_options.min_length, 1024);
+  EXPECT_EQ(api_options.level, 6);
+  EXPECT_TRUE(handler_configs.find("/bad") == handler_configs.end());
+}
+
+// TEST: A location may set its own body size limit
+TEST_F(ConfigParserExtendedTest, ExtractHandlerConfigs_MaxBodySize) {
+  const std::string config_string =
+    "client_max_body_size 1m;\n"
+    "location /echo EchoHandler {}\n"
+    "location /upload UploadHandler {\n"
+    "  client_max_body_size 11m;\n"
+    "}\n"
+    "location /bad EchoHandler {\n"
+    "  client_max_body_size lots;\n"
+    "}\n";
+
+  ASSERT_TRUE(ParseString(config_string));
+
+  auto handler_configs = out_config.ExtractHandlerConfigs();
+  EXPECT_EQ(handler_configs.size(), 2);
+  EXPECT_EQ(handler_configs["/echo"].max_body_size, 0);
+  EXPECT_EQ(handler_configs["/upload"].max_body_size, 11 * 1024 * 1024);
+  EXPECT_TRUE(handler_configs.find("/bad") == handler_configs.end());
+
+  // The location's directive does not change the server-wide limit
+  ServerOptions options;
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.session.max_body_size, 1024 * 1024);
+}
+
 TEST_F(ConfigParserExtendedTest, ParseFromFile) {
   const std::string config_string = 
     "port 8080;\n"
@@ -351,6 +458,272 @@ TEST_F(ConfigParserExtendedTest, ExtractDataPathProd) {
   EXPECT_EQ(path, "/mnt/storage/crud");
 }
 
+// TEST: Server options default when no directives are given
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_Defaults) {
+  ASSERT_TRUE(ParseString("port 8080;\n"));
+
+  ServerOptions options;
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.thread_count, 4);
+  EXPECT_EQ(options.io_model, "shared");
+  EXPECT_FALSE(options.cpu_affinity);
+}
+
+// TEST: Threading directives are read from the top level
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_PerCore) {
+  const std::string config_string =
+    "port 8080;\n"
+    "threads 32;\n"
+    "io_model per_core;\n"
+    "cpu_affinity on;\n";
+
+  ASSERT_TRUE(ParseString(config_string));
+
+  ServerOptions options;
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.thread_count, 32);
+  EXPECT_EQ(options.io_model, "per_core");
+  EXPECT_TRUE(options.cpu_affinity);
+}
+
+// TEST: "threads auto" resolves to at least one thread
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_AutoThreads) {
+  ASSERT_TRUE(ParseString("threads auto;\n"));
+
+  ServerOptions options;
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_GE(options.thread_count, 1);
+}
+
+// TEST: Invalid option values are rejected
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_Invalid) {
+  ServerOptions options;
+
+  ASSERT_TRUE(ParseString("threads many;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("threads 0;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("io_model fibers;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("cpu_affinity yes;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+}
+
+// TEST: Buffer size directives accept k and m suffixes
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_BufferSizes) {
+  const std::string config_string =
+    "client_header_buffer_size 2k;\n"
+    "client_max_header_size 16k;\n"
+    "client_max_body_size 50m;\n"
+    "client_body_buffer_size 128k;\n"
+    "output_buffer_size 64k;\n";
+
+  ASSERT_TRUE(ParseString(config_string));
+
+  ServerOptions options;
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.session.header_buffer_size, 2 * 1024);
+  EXPECT_EQ(options.session.max_header_size, 16 * 1024);
+  EXPECT_EQ(options.session.max_body_size, 50 * 1024 * 1024);
+  EXPECT_EQ(options.session.body_buffer_size, 128 * 1024);
+  EXPECT_EQ(options.session.output_buffer_size, 64 * 1024);
+}
+
+// TEST: Request line and header limits
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_RequestLimits) {
+  ServerOptions options;
+  ASSERT_TRUE(ParseString("port 8080;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.session.max_uri_length, 8 * 1024);
+  EXPECT_EQ(options.session.max_header_count, 100);
+  EXPECT_EQ(options.session.max_header_line_size, 8 * 1024);
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString(
+    "client_max_uri_length 2k;\n"
+    "client_max_header_count 50;\n"
+    "client_max_header_line_size 4k;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.session.max_uri_length, 2 * 1024);
+  EXPECT_EQ(options.session.max_header_count, 50);
+  EXPECT_EQ(options.session.max_header_line_size, 4 * 1024);
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("client_max_header_count 0;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("client_max_uri_length 0;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+}
+
+// TEST: Malformed or inconsistent buffer sizes are rejected
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_InvalidBufferSizes) {
+  ServerOptions options;
+
+  ASSERT_TRUE(ParseString("client_max_body_size 10g;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("client_header_buffer_size 0;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("client_header_buffer_size 32k;\nclient_max_header_size 8k;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("output_buffer_size 0;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+
+  // Sizes that wrap around once multiplied
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("client_max_body_size 18014398509481985k;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("client_max_body_size 17592186044417m;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+}
+
+// TEST: Connection and request limits default to unlimited and are read from the top level
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_Limits) {
+  ServerOptions options;
+  ASSERT_TRUE(ParseString("port 8080;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.max_connections, 0);
+  EXPECT_EQ(options.max_inflight_requests, 0);
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("max_connections 10000;\nmax_inflight_requests 512;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.max_connections, 10000);
+  EXPECT_EQ(options.max_inflight_requests, 512);
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("max_connections -1;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+}
+
+// TEST: Drain deadline and handoff socket are read from the top level
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_Shutdown) {
+  ServerOptions options;
+  ASSERT_TRUE(ParseString("port 8080;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.drain_timeout, std::chrono::seconds(30));
+  EXPECT_TRUE(options.handoff_socket.empty());
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("drain_timeout 5s;\nhandoff_socket /tmp/server.sock;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.drain_timeout, std::chrono::seconds(5));
+  EXPECT_EQ(options.handoff_socket, "/tmp/server.sock");
+}
+
+// TEST: Timeouts accept ms, s and m suffixes; plain numbers are seconds
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_Timeouts) {
+  const std::string config_string =
+    "client_header_timeout 500ms;\n"
+    "keepalive_timeout 2m;\n"
+    "send_timeout 30;\n";
+
+  ASSERT_TRUE(ParseString(config_string));
+
+  ServerOptions options;
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.session.header_timeout, std::chrono::milliseconds(500));
+  EXPECT_EQ(options.session.keepalive_timeout, std::chrono::minutes(2));
+  EXPECT_EQ(options.session.send_timeout, std::chrono::seconds(30));
+}
+
+// TEST: Malformed timeouts are rejected; 0 is allowed and disables the timeout
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_InvalidTimeouts) {
+  ServerOptions options;
+
+  ASSERT_TRUE(ParseString("keepalive_timeout 10h;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("send_timeout -5;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("keepalive_timeout 0;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.session.keepalive_timeout.count(), 0);
+}
+
+// TEST: Server options inside a location block are ignored
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_IgnoresLocationBlocks) {
+  const std::string config_string =
+    "location /echo EchoHandler {\n"
+    "  threads 16;\n"
+    "}\n";
+
+  ASSERT_TRUE(ParseString(config_string));
+
+  ServerOptions options;
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.thread_count, 4);
+}
+
+// TEST: Size of the blocking thread pool
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_BlockingThreads) {
+  ServerOptions options;
+  ASSERT_TRUE(ParseString("port 8080;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.blocking_threads, 4);
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("blocking_threads 16;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_EQ(options.blocking_threads, 16);
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("blocking_threads 0;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+}
+
+// TEST: HTTP/2 is on unless turned off, and only takes on/off
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_Http2) {
+  ServerOptions options;
+  ASSERT_TRUE(ParseString("port 8080;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_TRUE(options.session.http2);
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("http2 off;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_FALSE(options.session.http2);
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("http2 maybe;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+}
+
+// TEST: sendfile is on unless turned off, and only takes on/off
+TEST_F(ConfigParserExtendedTest, ExtractServerOptions_Sendfile) {
+  ServerOptions options;
+  ASSERT_TRUE(ParseString("port 8080;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_TRUE(options.session.sendfile);
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("sendfile off;\n"));
+  ASSERT_TRUE(out_config.ExtractServerOptions(options));
+  EXPECT_FALSE(options.session.sendfile);
+
+  out_config = NginxConfig();
+  ASSERT_TRUE(ParseString("sendfile yes;\n"));
+  EXPECT_FALSE(out_config.ExtractServerOptions(options));
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,73 @@
+#include "gtest/gtest.h"
+#include "connection_limiter.h"
+
+// TEST: Limits of 0 never pause accepting or shed requests
+TEST(ConnectionLimiterTest, ZeroMeansUnlimited) {
+  connection_limiter limiter(0, 0);
+  for (int i = 0; i < 1000; ++i) {
+    limiter.connection_opened();
+    EXPECT_TRUE(limiter.try_begin_request());
+  }
+  EXPECT_FALSE(limiter.pause_accepting(this, []() {}));
+  EXPECT_EQ(limiter.connections(), 1000);
+  EXPECT_EQ(limiter.inflight_requests(), 1000);
+}
+
+// TEST: Accepting pauses at max_connections and resumes once a connection closes
+TEST(ConnectionLimiterTest, PausesAtMaxConnections) {
+  connection_limiter limiter(2, 0);
+  int resumed = 0;
+
+  limiter.connection_opened();
+  EXPECT_FALSE(limiter.pause_accepting(this, [&resumed]() { ++resumed; }));
+  limiter.connection_opened();
+  EXPECT_TRUE(limiter.pause_accepting(this, [&resumed]() { ++resumed; }));
+  EXPECT_EQ(resumed, 0);
+
+  limiter.connection_closed();
+  EXPECT_EQ(resumed, 1);
+
+  // The waiter is only called once
+  limiter.connection_opened();
+  limiter.connection_closed();
+  EXPECT_EQ(resumed, 1);
+}
+
+// TEST: Every paused server is resumed
+TEST(ConnectionLimiterTest, ResumesAllWaiters) {
+  connection_limiter limiter(1, 0);
+  int first = 0;
+  int second = 0;
+  limiter.connection_opened();
+  EXPECT_TRUE(limiter.pause_accepting(&first, [&first]() { ++first; }));
+  EXPECT_TRUE(limiter.pause_accepting(&second, [&second]() { ++second; }));
+
+  limiter.connection_closed();
+  EXPECT_EQ(first, 1);
+  EXPECT_EQ(second, 1);
+}
+
+// TEST: A cancelled waiter is not resumed
+TEST(ConnectionLimiterTest, CancelWaitForgetsWaiter) {
+  connection_limiter limiter(1, 0);
+  int resumed = 0;
+  limiter.connection_opened();
+  EXPECT_TRUE(limiter.pause_accepting(this, [&resumed]() { ++resumed; }));
+  limiter.cancel_wait(this);
+
+  limiter.connection_closed();
+  EXPECT_EQ(resumed, 0);
+}
+
+// TEST: Requests past max_inflight_requests are refused until some finish
+TEST(ConnectionLimiterTest, LimitsInflightRequests) {
+  connection_limiter limiter(0, 2);
+  EXPECT_TRUE(limiter.try_begin_request());
+  EXPECT_TRUE(limiter.try_begin_request());
+  EXPECT_FALSE(limiter.try_begin_request());
+  EXPECT_EQ(limiter.inflight_requests(), 2);
+
+  limiter.end_requests(2);
+  EXPECT_TRUE(limiter.try_begin_request());
+  EXPECT_EQ(limiter.inflight_requests(), 1);
+}
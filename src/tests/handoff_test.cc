@@ -0,0 +1,108 @@
+#include "gtest/gtest.h"
+#include "handoff.h"
+#include <boost/asio.hpp>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using boost::asio::ip::tcp;
+
+class HandoffTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    path_ = "/tmp/handoff_test_" + std::to_string(::getpid()) + ".sock";
+  }
+
+  void TearDown() override {
+    ::unlink(path_.c_str());
+  }
+
+  // Port a listening socket is bound to
+  static unsigned short LocalPort(int fd) {
+    struct sockaddr_storage address;
+    socklen_t length = sizeof(address);
+    ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&address), &length);
+    return ntohs(reinterpret_cast<struct sockaddr_in*>(&address)->sin_port);
+  }
+
+  std::string path_;
+};
+
+// TEST: Descriptors sent over a Unix socket refer to the same open files
+TEST_F(HandoffTest, SendsAndReceivesFds) {
+  int pair[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+  int pipe_fds[2];
+  ASSERT_EQ(::pipe(pipe_fds), 0);
+
+  ASSERT_TRUE(send_fds(pair[0], {pipe_fds[1]}));
+  std::vector<int> received = receive_fds(pair[1]);
+  ASSERT_EQ(received.size(), 1);
+
+  // Writing through the received descriptor reaches the original pipe
+  ASSERT_EQ(::write(received[0], "x", 1), 1);
+  char c = 0;
+  ASSERT_EQ(::read(pipe_fds[0], &c, 1), 1);
+  EXPECT_EQ(c, 'x');
+
+  for (int fd : {pair[0], pair[1], pipe_fds[0], pipe_fds[1], received[0]}) {
+    ::close(fd);
+  }
+}
+
+// TEST: Nothing is inherited when no server listens at the path
+TEST_F(HandoffTest, ColdStartInheritsNothing) {
+  handoff_client client;
+  EXPECT_TRUE(client.inherit(path_).empty());
+}
+
+// TEST: A new process receives the listening socket, and the old one drains only after the acknowledgement
+TEST_F(HandoffTest, HandsOverListeningSocket) {
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor(io_service, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  bool handed_off = false;
+  handoff_listener listener(io_service, path_,
+                            [&acceptor]() { return std::vector<int>{acceptor.native_handle()}; },
+                            [&handed_off]() { handed_off = true; });
+  std::thread io_thread([&io_service]() { io_service.run(); });
+
+  handoff_client client;
+  std::vector<int> fds = client.inherit(path_);
+  ASSERT_EQ(fds.size(), 1);
+  EXPECT_NE(fds[0], acceptor.native_handle());
+  EXPECT_EQ(LocalPort(fds[0]), acceptor.local_endpoint().port());
+
+  client.acknowledge();
+  io_thread.join();
+  EXPECT_TRUE(handed_off);
+  ::close(fds[0]);
+}
+
+// TEST: A new process that never acknowledges leaves the old one serving
+TEST_F(HandoffTest, KeepsServingWithoutAcknowledgement) {
+  boost::asio::io_service io_service;
+  tcp::acceptor acceptor(io_service, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  bool handed_off = false;
+  handoff_listener listener(io_service, path_,
+                            [&acceptor]() { return std::vector<int>{acceptor.native_handle()}; },
+                            [&handed_off]() { handed_off = true; });
+  std::thread io_thread([&io_service]() { io_service.run(); });
+
+  {
+    handoff_client abandoned;
+    std::vector<int> fds = abandoned.inherit(path_);
+    ASSERT_EQ(fds.size(), 1);
+    ::close(fds[0]);
+  }
+
+  // The listener takes the next process instead
+  handoff_client client;
+  std::vector<int> fds = client.inherit(path_);
+  ASSERT_EQ(fds.size(), 1);
+  EXPECT_FALSE(handed_off);
+  client.acknowledge();
+  io_thread.join();
+  EXPECT_TRUE(handed_off);
+  ::close(fds[0]);
+}
@@ -38,5 +38,19 @@ class HealthHandlerTest : public ::testing::Test {
         EXPECT_TRUE(found_content_length);
         EXPECT_TRUE(found_content_type);
     }
+
+    TEST_F(HealthHandlerTest, ViewRequestSendsPrebuiltResponse) {
+        auto first = handler.handle_request_view(request_view(req));
+        auto second = handler.handle_request_view(request_view(req));
+
+        // Every request shares the same serialized bytes
+        ASSERT_NE(first->prebuilt, nullptr);
+        EXPECT_EQ(first->prebuilt, second->prebuilt);
+        EXPECT_EQ(first->status, http::server::reply::ok);
+        EXPECT_EQ(first->prebuilt->content(), "OK\r\n");
+        EXPECT_EQ(first->prebuilt->head(true),
+                  "HTTP/1.1 200 OK\r\nContent-Length: 4\r\nContent-Type: text/plain\r\n"
+                  "Connection: keep-alive\r\n\r\n");
+    }
 }
 }
\ No newline at end of file
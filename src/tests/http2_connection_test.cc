@@ -0,0 +1,200 @@
+#include "gtest/gtest.h"
+#include "http2_connection.h"
+#include <nghttp2/nghttp2.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A response as the client saw it
+struct client_response {
+  std::string status;
+  std::string body;
+  bool closed = false;
+};
+
+// A minimal nghttp2 client exchanging frames with an http2_connection in memory
+class test_client {
+public:
+  test_client() {
+    nghttp2_session_callbacks* cbs;
+    nghttp2_session_callbacks_new(&cbs);
+    nghttp2_session_callbacks_set_on_header_callback(cbs, on_header);
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(cbs, on_data_chunk);
+    nghttp2_session_callbacks_set_on_stream_close_callback(cbs, on_stream_close);
+    nghttp2_session_client_new(&session_, cbs, this);
+    nghttp2_session_callbacks_del(cbs);
+    nghttp2_submit_settings(session_, NGHTTP2_FLAG_NONE, nullptr, 0);
+  }
+
+  ~test_client() {
+    nghttp2_session_del(session_);
+  }
+
+  std::int32_t get(const std::string& path,
+                   const std::vector<std::pair<std::string, std::string>>& extra = {}) {
+    std::vector<std::pair<std::string, std::string>> headers = {
+      {":method", "GET"}, {":scheme", "http"}, {":authority", "localhost"}, {":path", path}
+    };
+    headers.insert(headers.end(), extra.begin(), extra.end());
+
+    std::vector<nghttp2_nv> nva;
+    for (auto& header : headers) {
+      nva.push_back({reinterpret_cast<std::uint8_t*>(&header.first[0]),
+                     reinterpret_cast<std::uint8_t*>(&header.second[0]),
+                     header.first.size(), header.second.size(), NGHTTP2_NV_FLAG_NONE});
+    }
+    return nghttp2_submit_request(session_, nullptr, nva.data(), nva.size(), nullptr, nullptr);
+  }
+
+  // Moves frames both ways until neither side has anything left to send
+  void exchange(http2_connection& server) {
+    for (;;) {
+      std::string to_server;
+      const std::uint8_t* data;
+      ssize_t length;
+      while ((length = nghttp2_session_mem_send(session_, &data)) > 0) {
+        to_server.append(reinterpret_cast<const char*>(data), length);
+      }
+      server.receive(to_server.data(), to_server.size());
+
+      std::string to_client;
+      server.send(to_client);
+      nghttp2_session_mem_recv(session_, reinterpret_cast<const std::uint8_t*>(to_client.data()),
+                               to_client.size());
+      if (to_server.empty() && to_client.empty()) {
+        return;
+      }
+    }
+  }
+
+  std::map<std::int32_t, client_response> responses;
+
+private:
+  static int on_header(nghttp2_session*, const nghttp2_frame* frame,
+                       const std::uint8_t* name, std::size_t namelen,
+                       const std::uint8_t* value, std::size_t valuelen,
+                       std::uint8_t, void* user_data) {
+    auto* client = static_cast<test_client*>(user_data);
+    if (std::string(reinterpret_cast<const char*>(name), namelen) == ":status") {
+      client->responses[frame->hd.stream_id].status.assign(
+        reinterpret_cast<const char*>(value), valuelen);
+    }
+    return 0;
+  }
+
+  static int on_data_chunk(nghttp2_session*, std::uint8_t, std::int32_t stream_id,
+                           const std::uint8_t* data, std::size_t len, void* user_data) {
+    auto* client = static_cast<test_client*>(user_data);
+    client->responses[stream_id].body.append(reinterpret_cast<const char*>(data), len);
+    return 0;
+  }
+
+  static int on_stream_close(nghttp2_session*, std::int32_t stream_id, std::uint32_t,
+                             void* user_data) {
+    auto* client = static_cast<test_client*>(user_data);
+    client->responses[stream_id].closed = true;
+    return 0;
+  }
+
+  nghttp2_session* session_ = nullptr;
+};
+
+std::unique_ptr<http::server::reply> make_reply(const std::string& content) {
+  auto rep = http::server::reply::stock_reply(http::server::reply::ok, content);
+  rep->headers.push_back({"Connection", "keep-alive"});
+  return rep;
+}
+
+}  // namespace
+
+// TEST: Requests arrive in HTTP/1 form, with Host and Title-Case header names
+TEST(Http2ConnectionTest, TranslatesRequests) {
+  http2_connection server{SessionOptions()};
+  test_client client;
+  client.get("/echo", {{"x-request-id", "42"}});
+  client.exchange(server);
+
+  auto requests = server.take_requests();
+  ASSERT_EQ(requests.size(), 1);
+  const http::server::request& req = requests[0].request;
+  EXPECT_EQ(req.method, "GET");
+  EXPECT_EQ(req.uri, "/echo");
+  EXPECT_EQ(req.http_version_major, 2);
+  ASSERT_EQ(req.headers.size(), 2);
+  EXPECT_EQ(req.headers[0].name, "Host");
+  EXPECT_EQ(req.headers[0].value, "localhost");
+  EXPECT_EQ(req.headers[1].name, "X-Request-Id");
+  EXPECT_EQ(req.headers[1].value, "42");
+}
+
+// TEST: Streams on one connection are answered in whatever order replies arrive
+TEST(Http2ConnectionTest, MultiplexesStreams) {
+  http2_connection server{SessionOptions()};
+  test_client client;
+  std::int32_t first = client.get("/first");
+  std::int32_t second = client.get("/second");
+  client.exchange(server);
+  ASSERT_EQ(server.take_requests().size(), 2);
+
+  server.submit_reply(second, make_reply("second"));
+  client.exchange(server);
+  EXPECT_TRUE(client.responses[second].closed);
+  EXPECT_FALSE(client.responses[first].closed);
+
+  server.submit_reply(first, make_reply("first"));
+  client.exchange(server);
+  EXPECT_EQ(client.responses[first].status, "200");
+  EXPECT_EQ(client.responses[first].body, "first");
+  EXPECT_EQ(client.responses[second].body, "second");
+}
+
+// TEST: Headers past max_header_size reset the stream, not the connection
+TEST(Http2ConnectionTest, ResetsStreamWithOversizedHeaders) {
+  SessionOptions options;
+  options.max_header_size = 64;
+  http2_connection server(options);
+  test_client client;
+  std::int32_t large = client.get("/large", {{"x-padding", std::string(100, 'a')}});
+  std::int32_t small = client.get("/small");
+  client.exchange(server);
+
+  auto requests = server.take_requests();
+  ASSERT_EQ(requests.size(), 1);
+  EXPECT_EQ(requests[0].stream_id, small);
+  EXPECT_TRUE(client.responses[large].closed);
+}
+
+// TEST: Garbage instead of frames is a connection error
+TEST(Http2ConnectionTest, RejectsInvalidPreface) {
+  http2_connection server{SessionOptions()};
+  std::string garbage = "GET / HTTP/1.1\r\n\r\nPRI * HTTP/2.0";
+  EXPECT_FALSE(server.receive(garbage.data(), garbage.size()));
+}
+
+// TEST: After GOAWAY the connection finishes once its streams are answered
+TEST(Http2ConnectionTest, FinishesAfterShutdown) {
+  http2_connection server{SessionOptions()};
+  test_client client;
+  std::int32_t stream = client.get("/echo");
+  client.exchange(server);
+  ASSERT_EQ(server.take_requests().size(), 1);
+
+  server.shutdown();
+  server.submit_reply(stream, make_reply("done"));
+  client.exchange(server);
+  EXPECT_EQ(client.responses[stream].body, "done");
+  EXPECT_FALSE(server.want_read());
+  EXPECT_TRUE(server.finished());
+}
+
+// TEST: An undecodable HTTP2-Settings header refuses the upgrade
+TEST(Http2ConnectionTest, RejectsInvalidUpgradeSettings) {
+  http2_connection server{SessionOptions()};
+  EXPECT_FALSE(server.upgrade("not base64!", false));
+
+  http2_connection upgraded{SessionOptions()};
+  EXPECT_TRUE(upgraded.upgrade("AAMAAABkAAQAoAAAAAIAAAAA", false));
+}
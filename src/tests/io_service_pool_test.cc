@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+#include "io_service_pool.h"
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+// TEST: Pool rejects a size of zero
+TEST(IoServicePoolTest, ZeroSizeThrows) {
+  EXPECT_THROW(io_service_pool(0, 1, false), std::runtime_error);
+  EXPECT_THROW(io_service_pool(1, 0, false), std::runtime_error);
+}
+
+// TEST: Per-core layout exposes one io_service per thread
+TEST(IoServicePoolTest, PerCoreHasDistinctServices) {
+  io_service_pool pool(3, 1, false);
+  ASSERT_EQ(pool.size(), 3);
+  EXPECT_NE(&pool.get_io_service(0), &pool.get_io_service(1));
+  EXPECT_NE(&pool.get_io_service(1), &pool.get_io_service(2));
+  EXPECT_THROW(pool.get_io_service(3), std::out_of_range);
+}
+
+// TEST: Each io_service runs its work on its own thread
+TEST(IoServicePoolTest, RunsEachServiceOnOwnThread) {
+  io_service_pool pool(2, 1, false);
+  std::mutex mutex;
+  std::set<std::thread::id> thread_ids;
+
+  for (std::size_t i = 0; i < pool.size(); ++i) {
+    boost::asio::post(pool.get_io_service(i), [&]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      thread_ids.insert(std::this_thread::get_id());
+    });
+  }
+
+  // run() returns once every io_service is out of work
+  pool.run();
+  EXPECT_EQ(thread_ids.size(), 2);
+}
+
+// TEST: Shared layout runs one io_service on several threads
+TEST(IoServicePoolTest, SharedServiceRunsAllWork) {
+  io_service_pool pool(1, 4, false);
+  std::atomic<int> count{0};
+  for (int i = 0; i < 100; ++i) {
+    boost::asio::post(pool.get_io_service(0), [&]() { ++count; });
+  }
+  pool.run();
+  EXPECT_EQ(count.load(), 100);
+}
+
+// TEST: Pinned threads still run their work
+TEST(IoServicePoolTest, PinnedThreadsRun) {
+  io_service_pool pool(2, 1, true);
+  std::atomic<int> count{0};
+  for (std::size_t i = 0; i < pool.size(); ++i) {
+    boost::asio::post(pool.get_io_service(i), [&]() { ++count; });
+  }
+  pool.run();
+  EXPECT_EQ(count.load(), 2);
+}
+
+// TEST: Exceptions thrown on an io thread are rethrown by run()
+TEST(IoServicePoolTest, RethrowsThreadException) {
+  io_service_pool pool(1, 1, false);
+  boost::asio::post(pool.get_io_service(0), []() {
+    throw std::runtime_error("handler failure");
+  });
+  EXPECT_THROW(pool.run(), std::runtime_error);
+}
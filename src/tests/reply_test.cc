@@ -9,7 +9,7 @@ TEST(ReplyTest, StockReply) {
     EXPECT_EQ(rep->content, "Hello, World!");
     EXPECT_EQ(rep->headers.size(), 2); // Expecting Content-Length and Content-Type
     EXPECT_EQ(rep->headers[0].name, "Content-Length");
-    EXPECT_EQ(rep->headers[0].value, std::to_string(rep->content.size()));
+    EXPECT_EQ(std::string(rep->headers[0].value), std::to_string(rep->content.size()));
     EXPECT_EQ(rep->headers[1].name, "Content-Type");
     EXPECT_EQ(rep->headers[1].value, "text/plain");
 }
@@ -34,11 +34,12 @@ TEST(ReplyTest, OutputFormatting) {
 TEST(ReplyTest, AllStatusCodes) {
     // Helper function to extract status line from buffers
     auto get_status_line = [](const std::vector<boost::asio::const_buffer>& buffers) -> std::string {
-        // Status line is always the first buffer
-        return std::string(
+        // The first buffer holds the whole head; the status line is its first line
+        std::string head(
             boost::asio::buffer_cast<const char*>(buffers[0]), 
             boost::asio::buffer_size(buffers[0])
         );
+        return head.substr(0, head.find("\r\n") + 2);
     };
     
     // Test each status code
@@ -116,8 +117,12 @@ TEST(ReplyTest, MultipleHeaders) {
     
     auto buffers = rep->to_buffers();
     
-    // We expect status line + 4 headers (name, separator, value, CRLF for each) + CRLF + content
-    EXPECT_EQ(buffers.size(), 1 + 4*4 + 1 + 1);
+    // We expect the serialized status line and headers, then the content
+    EXPECT_EQ(buffers.size(), 2);
+    EXPECT_EQ(std::string(boost::asio::buffer_cast<const char*>(buffers[0]),
+                         boost::asio::buffer_size(buffers[0])),
+             "HTTP/1.1 200 OK\r\nContent-Length: 12\r\nContent-Type: text/plain\r\n"
+             "Connection: close\r\nServer: Boost-Asio-HTTP-Server\r\n\r\n");
     
     // Verify the content is the last buffer
     EXPECT_EQ(std::string(boost::asio::buffer_cast<const char*>(buffers.back()), 
@@ -153,8 +158,8 @@ TEST(ReplyTest, MalformedReqReply) {
     auto rep = std::make_unique<http::server::reply>();
     rep = rep->build_malformed_req_response();
 
-    // buffer contains status line (1), 2 headers (2 * 4), CRLF (1), and content (1)
-    EXPECT_EQ(rep->to_buffers().size(), 1 + 2*4 + 1 + 1);
+    // buffers hold the serialized head and the content
+    EXPECT_EQ(rep->to_buffers().size(), 2);
 
     // check reply's content is same as expected content
     EXPECT_EQ(to_str(rep->to_buffers()), "HTTP/1.1 400 Bad Request\r\nContent-Length: 46\r\nContent-Type: text/plain\r\n\r\nRequest is malformed and cannot be processed\r\n");
@@ -192,4 +197,67 @@ TEST(ReplyTest, DifferentContentTypes) {
     
     EXPECT_TRUE(html_response.find("Content-Type: text/html") != std::string::npos);
     EXPECT_TRUE(json_response.find("Content-Type: application/json") != std::string::npos);
-}
\ No newline at end of file
+}
+
+// Test that the head is rebuilt in one block and a streamed body adds no buffer
+TEST(ReplyTest, SerializedHead) {
+    http::server::reply rep;
+    rep.status = http::server::reply::not_found;
+    rep.headers.push_back({"Content-Length", "0"});
+    EXPECT_EQ(rep.serialize_head(), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+
+    // Changing the reply afterwards is picked up by the next serialization
+    rep.status = http::server::reply::ok;
+    rep.headers[0].value = "12345";
+    rep.headers.push_back({"X-Trace", "a"});
+    EXPECT_EQ(rep.serialize_head(), "HTTP/1.1 200 OK\r\nContent-Length: 12345\r\nX-Trace: a\r\n\r\n");
+
+    rep.body = std::make_unique<http::server::string_body>("streamed");
+    auto buffers = rep.to_buffers();
+    ASSERT_EQ(buffers.size(), 1);
+    EXPECT_EQ(boost::asio::buffer_cast<const char*>(buffers[0]), rep.serialize_head().data());
+
+    // Several replies share one scatter-gather list, two buffers each at most
+    std::vector<boost::asio::const_buffer> batch;
+    auto first = http::server::reply::stock_reply(http::server::reply::ok, "one");
+    auto second = http::server::reply::stock_reply(http::server::reply::created, "two");
+    first->append_buffers(batch);
+    second->append_buffers(batch);
+    EXPECT_EQ(batch.size(), 4);
+    EXPECT_EQ(http::server::status_strings::status_line(http::server::reply::created), "HTTP/1.1 201 Created\r\n");
+}
+
+// Test that a prebuilt response is sent from its own bytes and can be expanded
+TEST(ReplyTest, PrebuiltReply) {
+    auto source = http::server::reply::stock_reply(http::server::reply::ok, "OK\r\n");
+    auto response = std::make_shared<const http::server::prebuilt_response>(*source);
+    EXPECT_EQ(response->head(true), "HTTP/1.1 200 OK\r\nContent-Length: 4\r\nContent-Type: text/plain\r\n"
+                                    "Connection: keep-alive\r\n\r\n");
+    EXPECT_EQ(response->head(false), "HTTP/1.1 200 OK\r\nContent-Length: 4\r\nContent-Type: text/plain\r\n"
+                                     "Connection: close\r\n\r\n");
+
+    // The reply points at the shared bytes rather than copying them
+    auto rep = http::server::reply::prebuilt_reply(response);
+    EXPECT_EQ(rep->status, http::server::reply::ok);
+    EXPECT_TRUE(rep->headers.empty());
+    EXPECT_TRUE(rep->content.empty());
+    rep->set_keep_alive(true);
+    auto buffers = rep->to_buffers();
+    ASSERT_EQ(buffers.size(), 2);
+    EXPECT_EQ(boost::asio::buffer_cast<const char*>(buffers[0]), response->head(true).data());
+    EXPECT_EQ(boost::asio::buffer_cast<const char*>(buffers[1]), response->content().data());
+
+    // Expanding gives an ordinary reply with the same fields
+    rep->expand();
+    EXPECT_EQ(rep->prebuilt, nullptr);
+    EXPECT_EQ(rep->content, "OK\r\n");
+    ASSERT_EQ(rep->headers.size(), 2);
+    EXPECT_EQ(rep->headers[0].value, "4");
+    rep->set_keep_alive(false);
+    EXPECT_EQ(rep->headers.back().value, "close");
+
+    // A streamed body cannot be prebuilt
+    http::server::reply streamed;
+    streamed.body = std::make_unique<http::server::string_body>("streamed");
+    EXPECT_THROW(http::server::prebuilt_response{streamed}, std::invalid_argument);
+}
@@ -0,0 +1,46 @@
+#include "gtest/gtest.h"
+#include "request_arena.h"
+#include "reply.hpp"
+#include "request.hpp"
+#include <string>
+
+// TEST: A request built in the arena draws every string from it
+TEST(RequestArenaTest, RequestUsesArena) {
+  request_arena arena;
+  http::server::request req(arena.allocator());
+  req.method = "GET";
+  req.headers.emplace_back("Host", "localhost");
+
+  EXPECT_EQ(req.get_allocator(), arena.allocator());
+  EXPECT_EQ(req.headers[0].name.get_allocator(), arena.allocator());
+}
+
+// TEST: release(live) keeps a partly parsed request intact
+TEST(RequestArenaTest, ReleaseCarriesLiveRequest) {
+  request_arena arena;
+  http::server::request req(arena.allocator());
+  req.method = "POST";
+  req.uri = "/upload/" + std::string(200, 'a');
+  req.headers.emplace_back("Content-Type", "text/plain");
+  req.body.assign(2 * request_arena::half_size, 'b');
+
+  // Each release moves the request to the other half and frees the first
+  arena.release(req);
+  arena.release(req);
+
+  EXPECT_EQ(req.method, "POST");
+  EXPECT_EQ(std::string(req.uri), "/upload/" + std::string(200, 'a'));
+  ASSERT_EQ(req.headers.size(), 1);
+  EXPECT_EQ(req.headers[0].value, "text/plain");
+  EXPECT_EQ(std::string(req.body), std::string(2 * request_arena::half_size, 'b'));
+  EXPECT_EQ(req.get_allocator(), arena.allocator());
+}
+
+// TEST: Replies built with the request's allocator share its arena
+TEST(RequestArenaTest, StockReplyUsesAllocator) {
+  request_arena arena;
+  auto rep = http::server::reply::stock_reply(http::server::reply::ok, "hello", arena.allocator());
+
+  EXPECT_EQ(rep->get_allocator(), arena.allocator());
+  EXPECT_EQ(rep->content, "hello");
+}
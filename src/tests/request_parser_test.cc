@@ -202,7 +202,7 @@ TEST_F(RequestParserTest, LongMethodHandling) {
   auto result = parser.parse(req, request_str.c_str(), request_str.c_str() + request_str.length());
   
   EXPECT_EQ(std::get<0>(result), http::server::request_parser::result_type::good);
-  EXPECT_EQ(req.method, long_method);
+  EXPECT_EQ(std::string(req.method), long_method);
 }
 
 // Test maximum URI length handling
@@ -213,7 +213,283 @@ TEST_F(RequestParserTest, LongUriHandling) {
   auto result = parser.parse(req, request_str.c_str(), request_str.c_str() + request_str.length());
   
   EXPECT_EQ(std::get<0>(result), http::server::request_parser::result_type::good);
-  EXPECT_EQ(req.uri, "/" + long_uri);
+  EXPECT_EQ(std::string(req.uri), "/" + long_uri);
+}
+
+// Test that a view points into the parsed bytes instead of copying them
+TEST_F(RequestParserTest, ViewPointsIntoBuffer) {
+  std::string data = "POST /submit?x=1 HTTP/1.1\r\nHost: example.com\r\n\r\n";
+  auto result = parser.parse(data.data(), data.data(), data.data() + data.size());
+  ASSERT_EQ(std::get<0>(result), http::server::request_parser::result_type::good);
+
+  http::server::request_view view;
+  parser.view(view, data.data());
+  EXPECT_EQ(view.method, http::server::request_method::post);
+  EXPECT_EQ(view.method_name, "POST");
+  EXPECT_EQ(view.uri, "/submit?x=1");
+  EXPECT_EQ(view.uri.data(), data.data() + 5);
+  ASSERT_EQ(view.headers.size(), 1);
+  EXPECT_EQ(view.headers[0].name, "Host");
+  EXPECT_EQ(view.headers[0].value, "example.com");
+  EXPECT_EQ(view.headers[0].value.data(), data.data() + data.find("example.com"));
+}
+
+// Test that bytes parsed earlier may move between calls, as when a session
+// compacts its read buffer
+TEST_F(RequestParserTest, ViewAfterBytesMove) {
+  std::string first = "GET /moved HTTP/1.1\r\nHo";
+  auto result = parser.parse(first.data(), first.data(), first.data() + first.size());
+  EXPECT_EQ(std::get<0>(result), http::server::request_parser::result_type::indeterminate);
+
+  std::string moved = first + "st: example.com\r\n\r\n";
+  first.assign(first.size(), 'x');
+  result = parser.parse(moved.data(), moved.data() + first.size(), moved.data() + moved.size());
+  ASSERT_EQ(std::get<0>(result), http::server::request_parser::result_type::good);
+
+  http::server::request_view view;
+  parser.view(view, moved.data());
+  EXPECT_EQ(view.uri, "/moved");
+  ASSERT_EQ(view.headers.size(), 1);
+  EXPECT_EQ(view.headers[0].name, "Host");
+  EXPECT_EQ(view.headers[0].value, "example.com");
+  // A name split across calls is still recognized
+  EXPECT_EQ(view.find_header(http::server::known_header::host), &view.headers[0]);
+}
+
+// Test that known headers are indexed whatever their case, and that other
+// headers are still found by name
+TEST_F(RequestParserTest, ViewIndexesKnownHeaders) {
+  std::string data = "POST /upload HTTP/1.1\r\n"
+                     "content-length: 5\r\n"
+                     "X-Request-Id: abc\r\n"
+                     "CONTENT-TYPE: text/plain\r\n"
+                     "Content-Length: 7\r\n"
+                     "\r\n";
+  auto result = parser.parse(data.data(), data.data(), data.data() + data.size());
+  ASSERT_EQ(std::get<0>(result), http::server::request_parser::result_type::good);
+
+  http::server::request_view view;
+  parser.view(view, data.data());
+  ASSERT_EQ(view.headers.size(), 4);
+
+  // The first of repeated headers wins
+  const http::server::header_view* length = view.find_header(http::server::known_header::content_length);
+  ASSERT_NE(length, nullptr);
+  EXPECT_EQ(length->value, "5");
+  EXPECT_EQ(view.find_header("Content-Type"), &view.headers[2]);
+  EXPECT_EQ(view.find_header("x-request-id"), &view.headers[1]);
+  EXPECT_EQ(view.find_header(http::server::known_header::cookie), nullptr);
+  EXPECT_EQ(view.find_header("X-Missing"), nullptr);
+
+  // Viewing the next request clears the index
+  parser.reset();
+  std::string next = "GET / HTTP/1.1\r\n\r\n";
+  parser.parse(next.data(), next.data(), next.data() + next.size());
+  parser.view(view, next.data());
+  EXPECT_EQ(view.find_header(http::server::known_header::content_length), nullptr);
+}
+
+// Test that the owning request finds headers without regard to case
+TEST_F(RequestParserTest, RequestFindsHeadersIgnoringCase) {
+  const char* request_data = "GET / HTTP/1.1\r\ncookie: session_token=t\r\n\r\n";
+  auto result = parser.parse(req, request_data, request_data + strlen(request_data));
+  ASSERT_EQ(std::get<0>(result), http::server::request_parser::result_type::good);
+  const http::server::header* cookie = req.find_header(http::server::known_header::cookie);
+  ASSERT_NE(cookie, nullptr);
+  EXPECT_EQ(cookie->value, "session_token=t");
+
+  // A view of the request carries the same index
+  http::server::request_view view(req);
+  EXPECT_EQ(view.find_header("COOKIE"), &view.headers[0]);
+}
+
+// Test that names are classified by their whole spelling, not a prefix
+TEST(KnownHeaderTest, ClassifiesWholeNames) {
+  using http::server::known_header;
+  EXPECT_EQ(http::server::to_known_header("Host"), known_header::host);
+  EXPECT_EQ(http::server::to_known_header("hOST"), known_header::host);
+  EXPECT_EQ(http::server::to_known_header("http2-settings"), known_header::http2_settings);
+  EXPECT_EQ(http::server::to_known_header("Hosts"), known_header::other);
+  EXPECT_EQ(http::server::to_known_header("Content-Lengths"), known_header::other);
+  EXPECT_EQ(http::server::to_known_header(""), known_header::other);
+  for (std::size_t i = 0; i < http::server::known_header_count; ++i) {
+    known_header name = static_cast<known_header>(i);
+    EXPECT_EQ(http::server::to_known_header(http::server::known_header_name(name)), name);
+  }
+}
+
+// Test that a folded header value is joined for the view as well
+TEST_F(RequestParserTest, ViewJoinsFoldedHeader) {
+  std::string data = "GET / HTTP/1.1\r\nHeader: value1\r\n continued-value\r\nNext: 2\r\n\r\n";
+  auto result = parser.parse(data.data(), data.data(), data.data() + data.size());
+  ASSERT_EQ(std::get<0>(result), http::server::request_parser::result_type::good);
+
+  http::server::request_view view;
+  parser.view(view, data.data());
+  ASSERT_EQ(view.headers.size(), 2);
+  EXPECT_EQ(view.headers[0].value, "value1continued-value");
+  EXPECT_EQ(view.headers[1].name, "Next");
+  EXPECT_EQ(view.headers[1].value, "2");
+}
+
+// Parses data in one call, so runs of field bytes take the vectorized path,
+// and one byte per call, which is the byte-at-a-time state machine; both
+// must agree on the result, where parsing stopped and every field
+void ExpectSameAsByteAtATime(const std::string& data) {
+  SCOPED_TRACE(data);
+  http::server::request_parser whole;
+  auto [whole_result, whole_end] = whole.parse(data.data(), data.data(), data.data() + data.size());
+
+  http::server::request_parser bytes;
+  auto bytes_result = http::server::request_parser::indeterminate;
+  const char* bytes_end = data.data();
+  while (bytes_end != data.data() + data.size() &&
+         bytes_result == http::server::request_parser::indeterminate) {
+    std::tie(bytes_result, bytes_end) = bytes.parse(data.data(), bytes_end, bytes_end + 1);
+  }
+
+  EXPECT_EQ(whole_result, bytes_result);
+  EXPECT_EQ(whole_end - data.data(), bytes_end - data.data());
+  if (whole_result != http::server::request_parser::good) {
+    return;
+  }
+  http::server::request_view whole_view, bytes_view;
+  whole.view(whole_view, data.data());
+  bytes.view(bytes_view, data.data());
+  EXPECT_EQ(whole_view.method_name, bytes_view.method_name);
+  EXPECT_EQ(whole_view.uri, bytes_view.uri);
+  EXPECT_EQ(whole_view.http_version_major, bytes_view.http_version_major);
+  EXPECT_EQ(whole_view.http_version_minor, bytes_view.http_version_minor);
+  ASSERT_EQ(whole_view.headers.size(), bytes_view.headers.size());
+  for (size_t i = 0; i < whole_view.headers.size(); ++i) {
+    EXPECT_EQ(whole_view.headers[i].name, bytes_view.headers[i].name);
+    EXPECT_EQ(whole_view.headers[i].value, bytes_view.headers[i].value);
+  }
+}
+
+// Test that scanning runs of bytes a block at a time changes nothing,
+// including where a run ends inside, at the edge of or after a block
+TEST_F(RequestParserTest, VectorizedScanMatchesStateMachine) {
+  const std::string long_uri = "/notes/search?course=CS130&title=" + std::string(70, 'q');
+  const std::string long_value = "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 " + std::string(40, 'v');
+  const std::string requests[] = {
+    "GET " + long_uri + " HTTP/1.1\r\nHost: example.com\r\nUser-Agent: " + long_value + "\r\n\r\n",
+    "POST /upload HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=" +
+      std::string(50, '-') + "\r\nX-Very-Long-Header-Name-For-Testing: 1\r\n\r\nbody",
+    "GET /caf\xc3\xa9/" + std::string(40, '\x80') + " HTTP/1.1\r\nX-Bytes: \xff\xfe" +
+      std::string(33, '\xa0') + "\r\n\r\n",
+    "GET / HTTP/1.1\r\nFolded: " + std::string(20, 'a') + "\r\n " + std::string(40, 'b') +
+      "\r\nNext: " + std::string(31, 'c') + "\r\n\r\n",
+    "GET / HTTP/1.1\r\nEmpty: \r\nSpaces: a   b   c" + std::string(29, ' ') + "d\r\n\r\n",
+  };
+  for (const std::string& request : requests) {
+    ExpectSameAsByteAtATime(request);
+  }
+
+  // A byte that ends a run badly at every position of a 32 byte block
+  for (size_t position = 0; position < 40; ++position) {
+    for (char bad : {'\x01', '\t', '\x7f', '\0'}) {
+      std::string uri(48, 'u');
+      uri[position] = bad;
+      ExpectSameAsByteAtATime("GET /" + uri + " HTTP/1.1\r\n\r\n");
+      std::string value(48, 'v');
+      value[position] = bad;
+      ExpectSameAsByteAtATime("GET / HTTP/1.1\r\nX-Value: " + value + "\r\n\r\n");
+    }
+    std::string name(48, 'n');
+    name[position] = '@';
+    ExpectSameAsByteAtATime("GET / HTTP/1.1\r\n" + name + ": 1\r\n\r\n");
+    std::string method(48, 'M');
+    method[position] = '(';
+    ExpectSameAsByteAtATime(method + " / HTTP/1.1\r\n\r\n");
+  }
+}
+
+// Test that methods and header names, scanned a block at a time, take and
+// refuse exactly the bytes the state machine does, wherever they fall
+TEST_F(RequestParserTest, VectorizedTokenScanMatchesStateMachine) {
+  for (int c = 0; c < 256; ++c) {
+    for (size_t position : {0, 1, 15, 16, 17, 31, 32, 39}) {
+      std::string name(40, 'n');
+      name[position] = static_cast<char>(c);
+      ExpectSameAsByteAtATime("GET / HTTP/1.1\r\n" + name + ": 1\r\n\r\n");
+      std::string method(40, 'M');
+      method[position] = static_cast<char>(c);
+      ExpectSameAsByteAtATime(method + " / HTTP/1.1\r\n\r\n");
+    }
+  }
+}
+
+// Test that bytes from 0x80 up are accepted in the URI and header values
+TEST_F(RequestParserTest, AcceptsHighBytesInFields) {
+  std::string data = "GET /caf\xc3\xa9 HTTP/1.1\r\nX-Name: \xe2\x9c\x93\r\n\r\n";
+  auto result = parser.parse(data.data(), data.data(), data.data() + data.size());
+  ASSERT_EQ(std::get<0>(result), http::server::request_parser::result_type::good);
+  http::server::request_view view;
+  parser.view(view, data.data());
+  EXPECT_EQ(view.uri, "/caf\xc3\xa9");
+  ASSERT_EQ(view.headers.size(), 1);
+  EXPECT_EQ(view.headers[0].value, "\xe2\x9c\x93");
+}
+
+// Parses data with the given limits, split at every position so the limit
+// is met both in the vectorized runs and byte by byte
+void ExpectRejected(const std::string& data, const http::server::request_limits& limits,
+                    http::server::request_parser::error_type error) {
+  SCOPED_TRACE(data);
+  for (size_t split = 0; split <= data.size(); split += 7) {
+    http::server::request_parser parser(limits);
+    auto [result, stop] = parser.parse(data.data(), data.data(), data.data() + split);
+    if (result == http::server::request_parser::indeterminate) {
+      std::tie(result, stop) = parser.parse(data.data(), stop, data.data() + data.size());
+    }
+    ASSERT_EQ(result, http::server::request_parser::bad);
+    EXPECT_EQ(parser.error(), error);
+  }
+}
+
+// Test that requests over each limit are refused with the matching error,
+// and that requests exactly at the limits are not
+TEST(RequestLimitsTest, RejectsOversizedFields) {
+  http::server::request_limits limits;
+  limits.max_uri_length = 32;
+  limits.max_header_count = 3;
+  limits.max_header_line = 24;
+
+  ExpectRejected("GET /" + std::string(32, 'u') + " HTTP/1.1\r\n\r\n", limits,
+                 http::server::request_parser::uri_too_long);
+  ExpectRejected("GET / HTTP/1.1\r\nA: 1\r\nB: 2\r\nC: 3\r\nD: 4\r\n\r\n", limits,
+                 http::server::request_parser::header_fields_too_large);
+  ExpectRejected("GET / HTTP/1.1\r\nX-Name: " + std::string(19, 'v') + "\r\n\r\n", limits,
+                 http::server::request_parser::header_fields_too_large);
+  ExpectRejected("GET / HTTP/1.1\r\n" + std::string(25, 'N') + ": 1\r\n\r\n", limits,
+                 http::server::request_parser::header_fields_too_large);
+  // Folded lines count toward the header they continue
+  ExpectRejected("GET / HTTP/1.1\r\nX: " + std::string(12, 'a') + "\r\n " + std::string(12, 'b') + "\r\n\r\n",
+                 limits, http::server::request_parser::header_fields_too_large);
+
+  std::string at_limits = "GET /" + std::string(31, 'u') + " HTTP/1.1\r\n"
+                          "A: 1\r\nB: 2\r\nX-Name: " + std::string(18, 'v') + "\r\n\r\n";
+  http::server::request_parser parser(limits);
+  auto result = parser.parse(at_limits.data(), at_limits.data(), at_limits.data() + at_limits.size());
+  EXPECT_EQ(std::get<0>(result), http::server::request_parser::good);
+
+  // A syntax error is reported as such
+  http::server::request_parser syntax(limits);
+  std::string bad = "G@T / HTTP/1.1\r\n\r\n";
+  EXPECT_EQ(std::get<0>(syntax.parse(bad.data(), bad.data(), bad.data() + bad.size())),
+            http::server::request_parser::bad);
+  EXPECT_EQ(syntax.error(), http::server::request_parser::malformed);
+}
+
+// Test method decoding; methods are case-sensitive
+TEST(RequestMethodTest, DecodesMethods) {
+  EXPECT_EQ(http::server::to_request_method("GET"), http::server::request_method::get);
+  EXPECT_EQ(http::server::to_request_method("HEAD"), http::server::request_method::head);
+  EXPECT_EQ(http::server::to_request_method("DELETE"), http::server::request_method::delete_);
+  EXPECT_EQ(http::server::to_request_method("OPTIONS"), http::server::request_method::options);
+  EXPECT_EQ(http::server::to_request_method("get"), http::server::request_method::other);
+  EXPECT_EQ(http::server::to_request_method("BREW"), http::server::request_method::other);
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "gtest/gtest.h"
+#include "router.h"
+#include <string>
+
+using http::server::route_params;
+using http::server::router;
+
+namespace {
+
+// The value uri matches, or -1
+int Match(const router& r, std::string_view uri, route_params& params) {
+  const std::size_t* value = r.match(uri, params);
+  return value ? static_cast<int>(*value) : -1;
+}
+
+router Build(std::initializer_list<std::string_view> patterns) {
+  router r;
+  std::size_t value = 0;
+  for (std::string_view pattern : patterns) {
+    EXPECT_TRUE(r.add(pattern, value++)) << pattern;
+  }
+  r.compile();
+  return r;
+}
+
+} // namespace
+
+// TEST: Locations match whole segments, never part of one
+TEST(RouterTest, MatchesOnSegmentBoundaries) {
+  router r = Build({"/echo", "/api/notes"});
+  route_params params;
+  EXPECT_EQ(Match(r, "/echo", params), 0);
+  EXPECT_EQ(Match(r, "/echo/", params), 0);
+  EXPECT_EQ(Match(r, "/echo/a/b", params), 0);
+  EXPECT_EQ(Match(r, "/echo?x=1", params), 0);
+  EXPECT_EQ(Match(r, "/echoes", params), -1);
+  EXPECT_EQ(Match(r, "/api/notesX", params), -1);
+  EXPECT_EQ(Match(r, "/api", params), -1);
+  EXPECT_EQ(Match(r, "", params), -1);
+  EXPECT_EQ(Match(r, "echo", params), -1);
+  EXPECT_FALSE(params.matched());
+}
+
+// TEST: The longest location wins, and "/" takes whatever is left
+TEST(RouterTest, PrefersLongestLocation) {
+  router r = Build({"/", "/api", "/api/notes", "/api/notes/archive/old"});
+  route_params params;
+  EXPECT_EQ(Match(r, "/", params), 0);
+  EXPECT_EQ(Match(r, "/other", params), 0);
+  EXPECT_EQ(Match(r, "/api/users", params), 1);
+  EXPECT_EQ(Match(r, "/api/notes/7", params), 2);
+  EXPECT_EQ(Match(r, "/api/notes/archive", params), 2);
+  EXPECT_EQ(Match(r, "/api/notes/archive/old/1", params), 3);
+}
+
+// TEST: The remainder is what follows the location in the path
+TEST(RouterTest, ReportsRemainder) {
+  router r = Build({"/", "/static"});
+  route_params params;
+  std::string uri = "/static/css/site.css?v=2";
+  ASSERT_EQ(Match(r, uri, params), 1);
+  EXPECT_TRUE(params.matched());
+  EXPECT_EQ(params.remainder(uri), "/css/site.css");
+
+  uri = "/static";
+  ASSERT_EQ(Match(r, uri, params), 1);
+  EXPECT_EQ(params.remainder(uri), "");
+
+  uri = "/index.html";
+  ASSERT_EQ(Match(r, uri, params), 0);
+  EXPECT_EQ(params.remainder(uri), "/index.html");
+}
+
+// TEST: {name} segments capture one non-empty segment each
+TEST(RouterTest, CapturesParams) {
+  router r = Build({"/api/{entity}", "/api/{entity}/{id}", "/users/{user}/files"});
+  route_params params;
+  std::string uri = "/api/Shoes/42/extra?q";
+  ASSERT_EQ(Match(r, uri, params), 1);
+  EXPECT_EQ(params.size(), 2);
+  EXPECT_EQ(params.get("entity", uri), "Shoes");
+  EXPECT_EQ(params.get("id", uri), "42");
+  EXPECT_EQ(params.get("missing", uri), "");
+  EXPECT_EQ(params.remainder(uri), "/extra");
+
+  uri = "/api/Shoes";
+  ASSERT_EQ(Match(r, uri, params), 0);
+  EXPECT_EQ(params.size(), 1);
+  EXPECT_EQ(params.get("id", uri), "");
+
+  uri = "/users/ana/files/a.txt";
+  ASSERT_EQ(Match(r, uri, params), 2);
+  EXPECT_EQ(params.get("user", uri), "ana");
+
+  // A captured segment that leads nowhere is given back
+  uri = "/users/ana/photos";
+  EXPECT_EQ(Match(r, uri, params), -1);
+  EXPECT_EQ(params.size(), 0);
+  EXPECT_EQ(Match(r, "/api//1", params), -1);
+}
+
+// TEST: At each segment a literal is tried before a {name}, which is tried
+// if the literal's subtree has no match
+TEST(RouterTest, PrefersLiteralsAndBacktracks) {
+  router r = Build({"/api/{entity}/{id}", "/api/notes", "/api/notes/search/all"});
+  route_params params;
+  std::string uri = "/api/notes/3";
+  ASSERT_EQ(Match(r, uri, params), 1);
+  EXPECT_EQ(params.size(), 0);
+
+  uri = "/api/notes/search/all";
+  EXPECT_EQ(Match(r, uri, params), 2);
+
+  uri = "/api/shoes/3";
+  ASSERT_EQ(Match(r, uri, params), 0);
+  EXPECT_EQ(params.get("entity", uri), "shoes");
+  EXPECT_EQ(params.get("id", uri), "3");
+}
+
+// TEST: Compressed edges still split where the locations do
+TEST(RouterTest, CompressesSingleChildChains) {
+  router r = Build({"/a/b/c/d", "/a/b/x"});
+  route_params params;
+  EXPECT_EQ(Match(r, "/a/b/c/d/e", params), 0);
+  EXPECT_EQ(Match(r, "/a/b/x", params), 1);
+  EXPECT_EQ(Match(r, "/a/b/c", params), -1);
+  EXPECT_EQ(Match(r, "/a/b/cd", params), -1);
+}
+
+// TEST: Malformed, duplicate and conflicting locations are refused
+TEST(RouterTest, RejectsBadPatterns) {
+  EXPECT_TRUE(router::valid_pattern("/"));
+  EXPECT_TRUE(router::valid_pattern("/a.b/{id}/c-d"));
+  EXPECT_FALSE(router::valid_pattern(""));
+  EXPECT_FALSE(router::valid_pattern("echo"));
+  EXPECT_FALSE(router::valid_pattern("/echo/"));
+  EXPECT_FALSE(router::valid_pattern("/a//b"));
+  EXPECT_FALSE(router::valid_pattern("/{}"));
+  EXPECT_FALSE(router::valid_pattern("/x{id}"));
+  EXPECT_FALSE(router::valid_pattern("/{a}{b}"));
+  EXPECT_FALSE(router::valid_pattern("/{a/b}"));
+  EXPECT_FALSE(router::valid_pattern("/{a}/{b}/{c}/{d}/{e}/{f}/{g}/{h}/{i}"));
+
+  router r;
+  EXPECT_TRUE(r.add("/api/{entity}", 0));
+  EXPECT_FALSE(r.add("/api/{entity}", 1));
+  EXPECT_FALSE(r.add("/api/{kind}/list", 2));
+  EXPECT_TRUE(r.add("/api/{entity}/list", 3));
+  EXPECT_FALSE(r.add("/api/", 4));
+}
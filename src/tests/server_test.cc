@@ -1,8 +1,11 @@
 #include "gtest/gtest.h"
 #include "server.h"
 #include <boost/asio.hpp>
+#include <chrono>
 #include <map>
 #include <string>
+#include <thread>
+#include <vector>
 
 using boost::asio::ip::tcp;
 
@@ -63,6 +66,159 @@ TEST_F(ServerTest, ServerUsesSpecifiedPort) {
     });
 }
 
+// Test SO_REUSEPORT lets one acceptor per io_service share a port
+TEST_F(ServerTest, ReusePortAllowsSharedPort) {
+    const short shared_port = 8083;
+    boost::asio::io_service another_io_service;
+    ServerOptions options;
+    options.io_model = "per_core";
+
+    ASSERT_NO_THROW({
+        server server1(io_service_, shared_port, handler_configs_, options);
+        server server2(another_io_service, shared_port, handler_configs_, options);
+    });
+}
+
+// Test the server stops accepting at max_connections and resumes when one closes
+TEST_F(ServerTest, MaxConnectionsPausesAccepting) {
+    const short limited_port = 8084;
+    ServerOptions options;
+    options.max_connections = 1;
+    server test_server(io_service_, limited_port, handler_configs_, options);
+    std::thread io_thread([this]() { io_service_.run(); });
+
+    const std::string request = "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), limited_port);
+    char buffer[1024];
+
+    // The first connection is served and stays open
+    tcp::socket first(io_service_);
+    first.connect(endpoint);
+    boost::asio::write(first, boost::asio::buffer(request));
+    EXPECT_GT(first.read_some(boost::asio::buffer(buffer)), 0);
+
+    // The second completes its handshake in the backlog but is not served
+    tcp::socket second(io_service_);
+    second.connect(endpoint);
+    boost::asio::write(second, boost::asio::buffer(request));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_EQ(second.available(), 0);
+
+    // Closing the first lets the server accept and answer the second
+    first.close();
+    size_t n = second.read_some(boost::asio::buffer(buffer));
+    EXPECT_NE(std::string(buffer, n).find("200 OK"), std::string::npos);
+
+    second.close();
+    io_service_.stop();
+    io_thread.join();
+}
+
+// Test a server with several io threads serves exactly max_connections
+// connections at once, counting each one before it accepts the next
+TEST_F(ServerTest, MaxConnectionsIsExact) {
+    const short limited_port = 8086;
+    const std::size_t limit = 3;
+    ServerOptions options;
+    auto limiter = std::make_shared<connection_limiter>(limit, 0);
+    server test_server(io_service_, limited_port, handler_configs_, options, limiter);
+    std::vector<std::thread> io_threads;
+    for (int i = 0; i < 4; ++i) {
+        io_threads.emplace_back([this]() { io_service_.run(); });
+    }
+
+    const std::string request = "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), limited_port);
+    char buffer[1024];
+
+    // Every client connects and sends before any is read, so accepts run
+    // back to back
+    std::vector<std::unique_ptr<tcp::socket>> clients;
+    for (std::size_t i = 0; i < limit + 2; ++i) {
+        clients.push_back(std::make_unique<tcp::socket>(io_service_));
+        clients.back()->connect(endpoint);
+        boost::asio::write(*clients.back(), boost::asio::buffer(request));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    std::size_t served = 0;
+    for (const auto& client : clients) {
+        if (client->available() > 0) {
+            ++served;
+        }
+    }
+    EXPECT_EQ(served, limit);
+    EXPECT_EQ(limiter->connections(), limit);
+
+    // Each close lets exactly one more in
+    for (auto& client : clients) {
+        if (client->available() > 0) {
+            client->close();
+            break;
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_EQ(limiter->connections(), limit);
+
+    for (auto& client : clients) {
+        client->close();
+    }
+    io_service_.stop();
+    for (std::thread& t : io_threads) {
+        t.join();
+    }
+}
+
+// Test shutdown() stops accepting, closes idle connections and lets the io_service run out of work
+TEST_F(ServerTest, ShutdownDrainsAndStops) {
+    const short drain_port = 8085;
+    server test_server(io_service_, drain_port, handler_configs_);
+    std::thread io_thread([this]() { io_service_.run(); });
+
+    tcp::socket client(io_service_);
+    client.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), drain_port));
+    boost::asio::write(client, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    char buffer[1024];
+    EXPECT_GT(client.read_some(boost::asio::buffer(buffer)), 0);
+
+    // The idle keep-alive connection is closed by the drain
+    test_server.shutdown();
+    boost::system::error_code ec;
+    while (!ec) {
+        client.read_some(boost::asio::buffer(buffer), ec);
+    }
+    EXPECT_EQ(ec, boost::asio::error::eof);
+
+    // No stop() needed: nothing is left to run
+    io_thread.join();
+
+    tcp::socket late(io_service_);
+    late.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), drain_port), ec);
+    EXPECT_TRUE(ec);
+}
+
+// Test a server can serve an acceptor opened elsewhere, as after a handoff
+TEST_F(ServerTest, AdoptsListeningAcceptor) {
+    const short adopted_port = 8086;
+    tcp::acceptor acceptor = server::open_acceptor(io_service_, adopted_port, ServerOptions());
+    int handle = acceptor.native_handle();
+    server test_server(io_service_, std::move(acceptor), handler_configs_);
+    EXPECT_EQ(test_server.listen_handle(), handle);
+
+    std::thread io_thread([this]() { io_service_.run(); });
+    tcp::socket client(io_service_);
+    client.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), adopted_port));
+    boost::asio::write(client, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    char buffer[1024];
+    size_t n = client.read_some(boost::asio::buffer(buffer));
+    EXPECT_NE(std::string(buffer, n).find("200 OK"), std::string::npos);
+
+    client.close();
+    test_server.shutdown();
+    io_thread.join();
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
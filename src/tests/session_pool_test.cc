@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+#include "session_pool.h"
+#include "session.h"
+#include <boost/asio.hpp>
+#include <memory>
+
+class SessionPoolTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    std::map<std::string, HandlerConfig> handler_configs;
+    HandlerConfig echo_config;
+    echo_config.type = "EchoHandler";
+    handler_configs["/echo"] = std::move(echo_config);
+    handler_registry_.Init(handler_configs);
+  }
+
+  boost::asio::io_service io_service_;
+  http::server::RequestHandlerRegistry handler_registry_;
+};
+
+// TEST: Live sessions are distinct objects
+TEST_F(SessionPoolTest, AcquireReturnsDistinctSessions) {
+  auto pool = session_pool::create(io_service_, handler_registry_, SessionOptions());
+  auto first = pool->acquire();
+  auto second = pool->acquire();
+  EXPECT_NE(first.get(), second.get());
+  EXPECT_EQ(pool->free_count(), 0);
+}
+
+// TEST: A released session is recycled by the next acquire
+TEST_F(SessionPoolTest, ReleasedSessionIsReused) {
+  auto pool = session_pool::create(io_service_, handler_registry_, SessionOptions());
+  session* raw = nullptr;
+  {
+    auto s = pool->acquire();
+    raw = s.get();
+  }
+  EXPECT_EQ(pool->free_count(), 1);
+
+  auto reused = pool->acquire();
+  EXPECT_EQ(reused.get(), raw);
+  EXPECT_EQ(pool->free_count(), 0);
+}
+
+// TEST: A session is not recycled while another owner still holds it
+TEST_F(SessionPoolTest, SharedOwnerDelaysRelease) {
+  auto pool = session_pool::create(io_service_, handler_registry_, SessionOptions());
+  auto s = pool->acquire();
+  std::shared_ptr<session> pending_handler = s;
+  s.reset();
+  EXPECT_EQ(pool->free_count(), 0);
+
+  pending_handler.reset();
+  EXPECT_EQ(pool->free_count(), 1);
+}
+
+// TEST: Recycled sessions come back with a closed socket
+TEST_F(SessionPoolTest, ReleasedSessionIsReset) {
+  auto pool = session_pool::create(io_service_, handler_registry_, SessionOptions());
+  {
+    auto s = pool->acquire();
+    s->socket().open(boost::asio::ip::tcp::v4());
+    ASSERT_TRUE(s->socket().is_open());
+  }
+  auto reused = pool->acquire();
+  EXPECT_FALSE(reused->socket().is_open());
+}
+
+// TEST: The free list never grows past its limit
+TEST_F(SessionPoolTest, FreeListIsBounded) {
+  auto pool = session_pool::create(io_service_, handler_registry_, SessionOptions(), nullptr, 2);
+  {
+    auto a = pool->acquire();
+    auto b = pool->acquire();
+    auto c = pool->acquire();
+  }
+  EXPECT_EQ(pool->free_count(), 2);
+}
+
+// TEST: A session released after its pool is gone is deleted
+TEST_F(SessionPoolTest, SessionOutlivesPool) {
+  auto pool = session_pool::create(io_service_, handler_registry_, SessionOptions());
+  auto s = pool->acquire();
+  std::weak_ptr<session_pool> pool_watch = pool;
+  std::weak_ptr<session> session_watch = s;
+  pool.reset();
+  EXPECT_TRUE(pool_watch.expired());
+
+  s.reset();
+  EXPECT_TRUE(session_watch.expired());
+}
+
+// TEST: Destroying the pool frees sessions on its free list
+TEST_F(SessionPoolTest, PoolIsFreedWithFreeSessions) {
+  auto pool = session_pool::create(io_service_, handler_registry_, SessionOptions());
+  pool->acquire().reset();
+  ASSERT_EQ(pool->free_count(), 1);
+
+  std::weak_ptr<session_pool> pool_watch = pool;
+  pool.reset();
+  EXPECT_TRUE(pool_watch.expired());
+}
@@ -2,14 +2,21 @@
 #include "session.h"
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <memory>
 #include <string>
 #include <thread>
 #include <chrono>
+#include <future>
+#include <stdexcept>
+#include <poll.h>
 #include "request_handler_registry.h"
 #include "echo_handler.hpp"  // Include all handler headers we'll test
 #include "not_found_handler.hpp"
 #include "static_handler.h"
+#include "health_handler.h"
 
 // Define boost placeholders to avoid deprecated warning
 #define BOOST_BIND_GLOBAL_PLACEHOLDERS
@@ -67,6 +74,7 @@ protected:
         statement->tokens_.push_back("/usr/src/static");
         static_config.config->statements_.push_back(statement);
         handler_configs["/static"] = std::move(static_config);
+        AddHandlers(handler_configs);
         
         // Initialize the registry
         ASSERT_TRUE(handler_registry_->Init(handler_configs));
@@ -80,6 +88,9 @@ protected:
             session_->socket().close();
         }
     }
+
+    // Lets a fixture route extra paths before the registry is initialized
+    virtual void AddHandlers(std::map<std::string, HandlerConfig>& handler_configs) {}
     
     std::shared_ptr<boost::asio::io_service> io_service_;
     std::shared_ptr<http::server::RequestHandlerRegistry> handler_registry_;
@@ -284,6 +295,1070 @@ TEST_F(SessionWithConnectedSocketsTest, HandlesStaticFileRequest) {
                 response.find("200 OK") != std::string::npos);
 }
 
+// Fixture for connection-reuse tests. The fixture drops its reference after
+// start() so the session is freed as soon as the connection closes.
+class SessionKeepAliveTest : public server_session_test {
+protected:
+    void SetUp() override {
+        server_session_test::SetUp();
+
+        boost::asio::ip::tcp::acceptor acceptor(*io_service_, boost::asio::ip::tcp::endpoint(
+            boost::asio::ip::address_v4::loopback(), 0));
+        acceptor.listen();
+
+        client_socket_ = std::make_shared<boost::asio::ip::tcp::socket>(*io_service_);
+        client_socket_->connect(acceptor.local_endpoint());
+
+        auto s = std::make_shared<session>(*io_service_, *handler_registry_, Options(), limiter_);
+        acceptor.accept(s->socket());
+        s->start();
+        session_watch_ = s;
+        io_thread_ = std::thread([this]() { io_service_->run(); });
+    }
+
+    void TearDown() override {
+        // Closing the client lets the session see EOF and free itself
+        if (client_socket_->is_open()) {
+            client_socket_->close();
+        }
+        io_thread_.join();
+        server_session_test::TearDown();
+    }
+
+    virtual SessionOptions Options() {
+        return SessionOptions();
+    }
+
+    // Reads until the connection closes or count complete responses have arrived
+    std::string ReadResponses(size_t count) {
+        std::string received;
+        char buffer[1024];
+        boost::system::error_code ec;
+        while (!ResponsesComplete(received, count)) {
+            size_t n = client_socket_->read_some(boost::asio::buffer(buffer), ec);
+            if (ec) break;
+            received.append(buffer, n);
+        }
+        return received;
+    }
+
+    // Returns true once the server has closed its side of the connection,
+    // false if it has not within a few seconds (well short of the default
+    // keepalive_timeout, so only an actual close passes)
+    bool ServerClosed() {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        char buffer[1024];
+        boost::system::error_code ec;
+        while (!ec) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            pollfd readable{client_socket_->native_handle(), POLLIN, 0};
+            if (left.count() <= 0 || ::poll(&readable, 1, left.count()) <= 0) {
+                return false;
+            }
+            client_socket_->read_some(boost::asio::buffer(buffer), ec);
+        }
+        return ec == boost::asio::error::eof;
+    }
+
+    // True once count status lines and the last response's full body are present
+    static bool ResponsesComplete(const std::string& received, size_t count) {
+        if (CountOf(received, "HTTP/1.1 ") < count) return false;
+        size_t last = received.rfind("HTTP/1.1 ");
+        size_t headers_end = received.find("\r\n\r\n", last);
+        if (headers_end == std::string::npos) return false;
+        size_t length_pos = received.find("Content-Length: ", last);
+        if (length_pos == std::string::npos || length_pos > headers_end) return true;
+        size_t length = std::stoul(received.substr(length_pos + 16));
+        return received.size() >= headers_end + 4 + length;
+    }
+
+    static size_t CountOf(const std::string& haystack, const std::string& needle) {
+        size_t count = 0;
+        for (size_t pos = haystack.find(needle); pos != std::string::npos;
+             pos = haystack.find(needle, pos + needle.size())) {
+            ++count;
+        }
+        return count;
+    }
+
+    std::shared_ptr<boost::asio::ip::tcp::socket> client_socket_;
+    std::thread io_thread_;
+    std::weak_ptr<session> session_watch_;
+    std::shared_ptr<connection_limiter> limiter_;
+};
+
+// Two requests in one segment get two replies, in order
+TEST_F(SessionKeepAliveTest, AnswersPipelinedRequestsInOrder) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo/first HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET /echo/second HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+
+    std::string response = ReadResponses(2);
+    EXPECT_EQ(CountOf(response, "200 OK"), 2);
+    size_t first = response.find("GET /echo/first");
+    size_t second = response.find("GET /echo/second");
+    ASSERT_NE(first, std::string::npos);
+    ASSERT_NE(second, std::string::npos);
+    EXPECT_LT(first, second);
+}
+
+// An HTTP/1.1 connection stays open between requests
+TEST_F(SessionKeepAliveTest, ReusesConnection) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("Connection: keep-alive"), std::string::npos);
+
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+}
+
+// A request split across two segments is answered once it is complete
+TEST_F(SessionKeepAliveTest, WaitsForSplitRequest) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHo")));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "st: localhost\r\n\r\n")));
+
+    std::string response = ReadResponses(1);
+    EXPECT_NE(response.find("Host: localhost"), std::string::npos);
+}
+
+// "Connection: close" is honored after the reply is written
+TEST_F(SessionKeepAliveTest, ClosesOnConnectionClose) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nConnection: close\r\n\r\n"
+        "GET /echo/ignored HTTP/1.1\r\n\r\n")));
+
+    std::string response = ReadResponses(2);
+    EXPECT_EQ(CountOf(response, "200 OK"), 1);
+    EXPECT_NE(response.find("Connection: close"), std::string::npos);
+    EXPECT_EQ(response.find("/echo/ignored"), std::string::npos);
+}
+
+// HTTP/1.0 closes by default and persists with "Connection: keep-alive"
+TEST_F(SessionKeepAliveTest, Http10DefaultsToClose) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("Connection: keep-alive"), std::string::npos);
+
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.0\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("Connection: close"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// A malformed request gets a 400 and the connection is closed
+TEST_F(SessionKeepAliveTest, ClosesAfterMalformedRequest) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "G@T /echo HTTP/1.1\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("400 Bad Request"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// A request body is read from the bytes following the headers
+TEST_F(SessionKeepAliveTest, ReadsBodyBeforeNextRequest) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /echo HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"
+        "GET /echo/next HTTP/1.1\r\n\r\n")));
+
+    std::string response = ReadResponses(2);
+    EXPECT_EQ(CountOf(response, "200 OK"), 2);
+    EXPECT_NE(response.find("GET /echo/next"), std::string::npos);
+}
+
+// Header names are case-insensitive, so a lowercase content-length still
+// frames the body
+TEST_F(SessionKeepAliveTest, ReadsBodyWithLowercaseContentLength) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /echo HTTP/1.1\r\ncontent-length: 5\r\n\r\nhello"
+        "GET /echo/next HTTP/1.1\r\nconnection: close\r\n\r\n")));
+
+    std::string response = ReadResponses(2);
+    EXPECT_EQ(CountOf(response, "200 OK"), 2);
+    EXPECT_NE(response.find("GET /echo/next"), std::string::npos);
+    EXPECT_NE(response.find("Connection: close"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// The session is released once the client disconnects and its handlers finish
+TEST_F(SessionKeepAliveTest, ReleasedAfterClientCloses) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\n\r\n")));
+    ReadResponses(1);
+    EXPECT_FALSE(session_watch_.expired());
+
+    client_socket_->close();
+    io_thread_.join();
+    EXPECT_TRUE(session_watch_.expired());
+    io_thread_ = std::thread([]() {});
+}
+
+// Session with small buffers so growth and limits are easy to reach
+class SessionBufferLimitsTest : public SessionKeepAliveTest {
+protected:
+    SessionOptions Options() override {
+        SessionOptions options;
+        options.header_buffer_size = 64;
+        options.max_header_size = 512;
+        options.max_body_size = 64 * 1024;
+        options.max_uri_length = 128;
+        options.max_header_count = 8;
+        options.max_header_line_size = 400;
+        return options;
+    }
+
+    // /echo/small accepts smaller bodies than the server does
+    void AddHandlers(std::map<std::string, HandlerConfig>& handler_configs) override {
+        HandlerConfig small;
+        small.type = "EchoHandler";
+        small.max_body_size = 16;
+        handler_configs["/echo/small"] = std::move(small);
+    }
+};
+
+// Headers larger than the initial buffer are parsed as the buffer grows
+TEST_F(SessionBufferLimitsTest, GrowsBufferForLargeHeaders) {
+    std::string request = "GET /echo HTTP/1.1\r\nX-Padding: " + std::string(300, 'a') + "\r\n\r\n";
+    boost::asio::write(*client_socket_, boost::asio::buffer(request));
+
+    std::string response = ReadResponses(1);
+    EXPECT_NE(response.find("200 OK"), std::string::npos);
+    EXPECT_NE(response.find(std::string(300, 'a')), std::string::npos);
+}
+
+// Headers beyond the configured limit are rejected
+TEST_F(SessionBufferLimitsTest, RejectsOversizedHeaders) {
+    std::string request = "GET /echo HTTP/1.1\r\n";
+    for (int i = 0; i < 6; ++i) {
+        request += "X-Padding-" + std::to_string(i) + ": " + std::string(100, 'a') + "\r\n";
+    }
+    boost::asio::write(*client_socket_, boost::asio::buffer(request + "\r\n"));
+
+    EXPECT_NE(ReadResponses(1).find("431 Request Header Fields Too Large"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// A single header line over its limit is refused without waiting for the rest
+TEST_F(SessionBufferLimitsTest, RejectsLongHeaderLine) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(
+        "GET /echo HTTP/1.1\r\nX-Padding: " + std::string(450, 'a')));
+
+    EXPECT_NE(ReadResponses(1).find("431 Request Header Fields Too Large"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// Too many headers are refused even when each is short
+TEST_F(SessionBufferLimitsTest, RejectsTooManyHeaders) {
+    std::string request = "GET /echo HTTP/1.1\r\n";
+    for (int i = 0; i < 9; ++i) {
+        request += "X-" + std::to_string(i) + ": 1\r\n";
+    }
+    boost::asio::write(*client_socket_, boost::asio::buffer(request + "\r\n"));
+
+    EXPECT_NE(ReadResponses(1).find("431 Request Header Fields Too Large"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// A URI over its limit gets 414
+TEST_F(SessionBufferLimitsTest, RejectsLongUri) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(
+        "GET /echo/" + std::string(200, 'u') + " HTTP/1.1\r\n\r\n"));
+
+    EXPECT_NE(ReadResponses(1).find("414 URI Too Long"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// A body sent in several segments is only dispatched once complete
+TEST_F(SessionBufferLimitsTest, ReadsBodyAcrossSegments) {
+    std::string body(32 * 1024, 'b');
+    boost::asio::write(*client_socket_, boost::asio::buffer(
+        "POST /echo HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n"));
+    for (size_t sent = 0; sent < body.size(); sent += 4096) {
+        boost::asio::write(*client_socket_, boost::asio::buffer(body.data() + sent, 4096));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo/after HTTP/1.1\r\n\r\n")));
+
+    std::string response = ReadResponses(2);
+    EXPECT_EQ(CountOf(response, "200 OK"), 2);
+    EXPECT_NE(response.find("GET /echo/after"), std::string::npos);
+}
+
+// A declared body beyond the configured limit is rejected
+TEST_F(SessionBufferLimitsTest, RejectsOversizedBody) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /echo HTTP/1.1\r\nContent-Length: 1048576\r\n\r\n")));
+
+    EXPECT_NE(ReadResponses(1).find("413 Payload Too Large"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// A location's own body limit applies below the server's
+TEST_F(SessionBufferLimitsTest, RejectsBodyOverLocationLimit) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /echo/small HTTP/1.1\r\nContent-Length: 17\r\n\r\n")));
+
+    EXPECT_NE(ReadResponses(1).find("413 Payload Too Large"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// A body within the location's limit is still read
+TEST_F(SessionBufferLimitsTest, AcceptsBodyWithinLocationLimit) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /echo/small HTTP/1.1\r\nContent-Length: 16\r\n\r\n0123456789abcdef")));
+
+    EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+}
+
+// A Content-Length that is not a plain number cannot frame the body
+TEST_F(SessionBufferLimitsTest, RejectsInvalidContentLength) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /echo HTTP/1.1\r\nContent-Length: -1\r\n\r\n")));
+
+    EXPECT_NE(ReadResponses(1).find("400 Bad Request"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// Transfer-Encoding bodies are refused rather than read as the next request
+TEST_F(SessionBufferLimitsTest, RejectsTransferEncoding) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "5\r\nhello\r\n0\r\n\r\n")));
+
+    std::string response = ReadResponses(1);
+    EXPECT_NE(response.find("501 Not Implemented"), std::string::npos);
+    EXPECT_EQ(CountOf(response, "HTTP/1.1 "), 1);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// A body framed by both Transfer-Encoding and Content-Length is ambiguous
+TEST_F(SessionBufferLimitsTest, RejectsTransferEncodingWithContentLength) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /echo HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "0\r\n\r\n")));
+
+    EXPECT_NE(ReadResponses(1).find("400 Bad Request"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// Repeated Content-Length headers must agree
+TEST_F(SessionBufferLimitsTest, RejectsConflictingContentLengths) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /echo HTTP/1.1\r\nContent-Length: 3\r\nHost: a\r\ncontent-length: 5\r\n\r\nabcde")));
+
+    EXPECT_NE(ReadResponses(1).find("400 Bad Request"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+TEST_F(SessionBufferLimitsTest, AcceptsRepeatedEqualContentLengths) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /echo HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 3\r\n\r\nabc")));
+
+    EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+}
+
+// Many pipelined requests overflow the initial buffer and are all answered
+TEST_F(SessionBufferLimitsTest, AnswersManyPipelinedRequests) {
+    std::string requests;
+    for (int i = 0; i < 20; ++i) {
+        requests += "GET /echo/" + std::to_string(i) + " HTTP/1.1\r\n\r\n";
+    }
+    boost::asio::write(*client_socket_, boost::asio::buffer(requests));
+
+    std::string response = ReadResponses(20);
+    EXPECT_EQ(CountOf(response, "200 OK"), 20);
+    EXPECT_NE(response.find("GET /echo/19 "), std::string::npos);
+}
+
+class SessionTimeoutTest : public SessionKeepAliveTest {
+protected:
+    SessionOptions Options() override {
+        SessionOptions options;
+        options.max_body_size = 32 * 1024 * 1024;
+        options.header_timeout = std::chrono::milliseconds(300);
+        options.keepalive_timeout = std::chrono::milliseconds(300);
+        options.send_timeout = std::chrono::milliseconds(300);
+        return options;
+    }
+
+    std::chrono::steady_clock::duration Elapsed() {
+        return std::chrono::steady_clock::now() - start_;
+    }
+
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+};
+
+// A connection that never sends a request is closed after client_header_timeout
+TEST_F(SessionTimeoutTest, ClosesSilentConnection) {
+    EXPECT_TRUE(ServerClosed());
+    EXPECT_GE(Elapsed(), std::chrono::milliseconds(300));
+}
+
+// Trickling header bytes does not extend client_header_timeout
+TEST_F(SessionTimeoutTest, ClosesSlowHeaders) {
+    boost::system::error_code ec;
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string("GET /echo HTTP/1.1\r\n")), ec);
+    for (int i = 0; i < 10 && !ec; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        boost::asio::write(*client_socket_, boost::asio::buffer(std::string("X-Slow: 1\r\n")), ec);
+    }
+
+    EXPECT_TRUE(ServerClosed() || ec);
+    EXPECT_LT(Elapsed(), std::chrono::milliseconds(900));
+}
+
+// An idle keep-alive connection is closed after keepalive_timeout
+TEST_F(SessionTimeoutTest, ClosesIdleKeepAlive) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+
+    // The server armed the timeout slightly before the response reached us
+    auto answered = std::chrono::steady_clock::now();
+    EXPECT_TRUE(ServerClosed());
+    EXPECT_GE(std::chrono::steady_clock::now() - answered, std::chrono::milliseconds(250));
+}
+
+// A client that stops reading its response is dropped after send_timeout
+TEST_F(SessionTimeoutTest, ClosesStalledWrite) {
+    // Large enough that the echoed reply cannot fit in the socket buffers
+    std::string body(24 * 1024 * 1024, 'a');
+    std::string request = "POST /echo HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) +
+                          "\r\n\r\n" + body;
+    boost::asio::write(*client_socket_, boost::asio::buffer(request));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(800));
+    size_t received = 0;
+    char buffer[64 * 1024];
+    boost::system::error_code ec;
+    while (!ec) {
+        received += client_socket_->read_some(boost::asio::buffer(buffer), ec);
+    }
+    EXPECT_LT(received, request.size());
+}
+
+// Answered requests re-arm the timeout, so a busy connection stays open
+TEST_F(SessionTimeoutTest, KeepsActiveConnectionOpen) {
+    for (int i = 0; i < 4; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+            "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+        EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+    }
+}
+
+class SessionNoTimeoutTest : public SessionKeepAliveTest {
+protected:
+    SessionOptions Options() override {
+        SessionOptions options;
+        options.keepalive_timeout = std::chrono::milliseconds(0);
+        return options;
+    }
+};
+
+// A keepalive_timeout of 0 leaves idle connections open
+TEST_F(SessionNoTimeoutTest, ZeroDisablesTimeout) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+}
+
+class SessionLoadSheddingTest : public SessionKeepAliveTest {
+protected:
+    void SetUp() override {
+        limiter_ = std::make_shared<connection_limiter>(0, 1);
+        SessionKeepAliveTest::SetUp();
+    }
+};
+
+// Requests past max_inflight_requests get a 503 with Retry-After on a connection that stays open
+TEST_F(SessionLoadSheddingTest, ShedsRequestsPastInflightLimit) {
+    // Occupy the only in-flight slot, as a slow request elsewhere would
+    ASSERT_TRUE(limiter_->try_begin_request());
+
+    const std::string request = "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    boost::asio::write(*client_socket_, boost::asio::buffer(request));
+    std::string response = ReadResponses(1);
+    EXPECT_NE(response.find("503 Service Unavailable"), std::string::npos);
+    EXPECT_NE(response.find("Retry-After: 1"), std::string::npos);
+    EXPECT_NE(response.find("Connection: keep-alive"), std::string::npos);
+
+    // Once the slot frees up the same connection is served normally
+    limiter_->end_requests(1);
+    boost::asio::write(*client_socket_, boost::asio::buffer(request));
+    EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+}
+
+// The connection and its requests are released back to the limiter
+TEST_F(SessionLoadSheddingTest, ReleasesLimitsOnClose) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+    EXPECT_EQ(limiter_->connections(), 1);
+
+    // The request stays in flight until the write handler has run
+    for (int i = 0; i < 100 && limiter_->inflight_requests() > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(limiter_->inflight_requests(), 0);
+
+    client_socket_->close();
+    for (int i = 0; i < 100 && limiter_->connections() > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(limiter_->connections(), 0);
+}
+
+// Draining closes an idle keep-alive connection right away
+TEST_F(SessionKeepAliveTest, DrainClosesIdleConnection) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("Connection: keep-alive"), std::string::npos);
+
+    session_watch_.lock()->drain();
+    EXPECT_TRUE(ServerClosed());
+}
+
+// Draining lets a request in progress finish, then closes the connection
+TEST_F(SessionKeepAliveTest, DrainFinishesRequestInProgress) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /echo HTTP/1.1\r\nContent-Length: 10\r\n\r\n01234")));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    session_watch_.lock()->drain();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string("56789")));
+
+    std::string response = ReadResponses(1);
+    EXPECT_NE(response.find("200 OK"), std::string::npos);
+    EXPECT_NE(response.find("Connection: close"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// Replies after a short timer wait, like SleepHandler but quicker
+class DelayedHandler : public http::server::AsyncRequestHandler {
+public:
+    static http::server::RequestHandler* Init(const std::string&, const NginxConfig*) {
+        return new DelayedHandler();
+    }
+
+    boost::asio::awaitable<std::unique_ptr<http::server::reply>> handle_request_async(
+        const http::server::request& request) override {
+        boost::asio::steady_timer timer(co_await boost::asio::this_coro::executor,
+                                        std::chrono::milliseconds(200));
+        co_await timer.async_wait(boost::asio::use_awaitable);
+        co_return BuildResponse(http::server::reply::ok, "delayed " + request.uri + "\r\n",
+                                std::vector<http::server::header>());
+    }
+};
+
+// Fails after suspending once
+class FailingAsyncHandler : public http::server::AsyncRequestHandler {
+public:
+    static http::server::RequestHandler* Init(const std::string&, const NginxConfig*) {
+        return new FailingAsyncHandler();
+    }
+
+    boost::asio::awaitable<std::unique_ptr<http::server::reply>> handle_request_async(
+        const http::server::request& request) override {
+        co_await boost::asio::post(co_await boost::asio::this_coro::executor,
+                                   boost::asio::use_awaitable);
+        throw std::runtime_error("backend unavailable");
+    }
+};
+
+class SessionAsyncHandlerTest : public SessionKeepAliveTest {
+protected:
+    void AddHandlers(std::map<std::string, HandlerConfig>& handler_configs) override {
+        http::server::RequestHandlerRegistry::RegisterHandler("DelayedHandler", DelayedHandler::Init);
+        http::server::RequestHandlerRegistry::RegisterHandler("FailingAsyncHandler",
+                                                              FailingAsyncHandler::Init);
+        HandlerConfig delayed_config;
+        delayed_config.type = "DelayedHandler";
+        handler_configs["/delayed"] = std::move(delayed_config);
+        HandlerConfig failing_config;
+        failing_config.type = "FailingAsyncHandler";
+        handler_configs["/failing"] = std::move(failing_config);
+    }
+};
+
+// The session waits for the coroutine and writes its reply
+TEST_F(SessionAsyncHandlerTest, AnswersAsyncHandler) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /delayed HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    std::string response = ReadResponses(1);
+    EXPECT_NE(response.find("200 OK"), std::string::npos);
+    EXPECT_NE(response.find("delayed /delayed"), std::string::npos);
+    EXPECT_NE(response.find("Connection: keep-alive"), std::string::npos);
+}
+
+// A request pipelined behind an async one is answered after it
+TEST_F(SessionAsyncHandlerTest, PipelinedRequestWaitsForAsyncHandler) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /delayed HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    std::string response = ReadResponses(2);
+    size_t delayed = response.find("delayed /delayed");
+    size_t echo = response.find("GET /echo");
+    ASSERT_NE(delayed, std::string::npos);
+    ASSERT_NE(echo, std::string::npos);
+    EXPECT_LT(delayed, echo);
+}
+
+// Other work on the io thread runs while the handler is suspended
+TEST_F(SessionAsyncHandlerTest, DoesNotBlockIoThread) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /delayed HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto start = std::chrono::steady_clock::now();
+    std::promise<void> ran;
+    boost::asio::post(*io_service_, [&ran]() { ran.set_value(); });
+    ran.get_future().wait();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+
+    EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+}
+
+// An exception from the coroutine becomes a 500 and the connection stays usable
+TEST_F(SessionAsyncHandlerTest, HandlerExceptionBecomesServerError) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /failing HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("500 Internal Server Error"), std::string::npos);
+
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+}
+
+// Draining waits for a suspended handler instead of cutting it off
+TEST_F(SessionAsyncHandlerTest, DrainWaitsForAsyncHandler) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /delayed HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    session_watch_.lock()->drain();
+
+    std::string response = ReadResponses(1);
+    EXPECT_NE(response.find("200 OK"), std::string::npos);
+    EXPECT_NE(response.find("Connection: close"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// A connection opening with the HTTP/2 preface is answered with a SETTINGS frame
+TEST_F(SessionKeepAliveTest, PrefaceSwitchesToHttp2) {
+    std::string settings_frame("\x00\x00\x00\x04\x00\x00\x00\x00\x00", 9);
+    boost::asio::write(*client_socket_, boost::asio::buffer(
+        http2_connection::client_preface + settings_frame));
+
+    char header[9];
+    boost::asio::read(*client_socket_, boost::asio::buffer(header));
+    EXPECT_EQ(header[3], 0x04);  // SETTINGS
+    EXPECT_EQ(header[5] | header[6] | header[7] | header[8], 0);  // stream 0
+}
+
+// "Upgrade: h2c" gets a 101 and the server's SETTINGS right behind it
+TEST_F(SessionKeepAliveTest, UpgradesToHttp2) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\nConnection: Upgrade, HTTP2-Settings\r\n"
+        "Upgrade: h2c\r\nHTTP2-Settings: AAMAAABkAAQAoAAAAAIAAAAA\r\n\r\n")));
+
+    std::string expected = "HTTP/1.1 101 Switching Protocols\r\n";
+    std::string received;
+    char buffer[1024];
+    boost::system::error_code ec;
+    while (received.find("\r\n\r\n") == std::string::npos && !ec) {
+        size_t n = client_socket_->read_some(boost::asio::buffer(buffer), ec);
+        received.append(buffer, n);
+    }
+    EXPECT_EQ(received.compare(0, expected.size(), expected), 0);
+    EXPECT_NE(received.find("Upgrade: h2c"), std::string::npos);
+}
+
+class SessionHttp2DisabledTest : public SessionKeepAliveTest {
+protected:
+    SessionOptions Options() override {
+        SessionOptions options;
+        options.http2 = false;
+        return options;
+    }
+};
+
+// With "http2 off;" an upgrade request is answered over HTTP/1.1
+TEST_F(SessionHttp2DisabledTest, IgnoresUpgrade) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\nConnection: Upgrade, HTTP2-Settings\r\n"
+        "Upgrade: h2c\r\nHTTP2-Settings: AAMAAABkAAQAoAAAAAIAAAAA\r\n\r\n")));
+    EXPECT_NE(ReadResponses(1).find("200 OK"), std::string::npos);
+}
+
+class SessionPrebuiltReplyTest : public SessionKeepAliveTest {
+protected:
+    void AddHandlers(std::map<std::string, HandlerConfig>& handler_configs) override {
+        http::server::RequestHandlerRegistry::RegisterHandler("HealthHandler",
+                                                              http::server::HealthHandler::Init);
+        HandlerConfig health_config;
+        health_config.type = "HealthHandler";
+        handler_configs["/health"] = std::move(health_config);
+    }
+};
+
+// Prebuilt replies go out byte for byte, with the Connection header each
+// request asked for
+TEST_F(SessionPrebuiltReplyTest, SendsPrebuiltBytes) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /health HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET /health HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n")));
+    std::string head = "HTTP/1.1 200 OK\r\nContent-Length: 4\r\nContent-Type: text/plain\r\n";
+    EXPECT_EQ(ReadResponses(2), head + "Connection: keep-alive\r\n\r\nOK\r\n" +
+                                head + "Connection: close\r\n\r\nOK\r\n");
+    EXPECT_TRUE(ServerClosed());
+}
+
+// Answers with what its location captured
+class RouteParamsHandler : public http::server::RequestHandler {
+public:
+    static http::server::RequestHandler* Init(const std::string&, const NginxConfig*) {
+        return new RouteParamsHandler();
+    }
+
+    std::unique_ptr<http::server::reply> handle_request(
+        const http::server::request& request) override {
+        return BuildResponse(http::server::reply::ok,
+                             "owner=" + std::string(request.path_param("owner")) +
+                             " rest=" + std::string(request.path_remainder()) + ";",
+                             std::vector<http::server::header>());
+    }
+};
+
+class SessionRouteParamsTest : public SessionKeepAliveTest {
+protected:
+    void AddHandlers(std::map<std::string, HandlerConfig>& handler_configs) override {
+        http::server::RequestHandlerRegistry::RegisterHandler("RouteParamsHandler",
+                                                              RouteParamsHandler::Init);
+        handler_configs["/files/{owner}"].type = "RouteParamsHandler";
+    }
+};
+
+// Captures reach the handler, whether it was picked before or after the body
+TEST_F(SessionRouteParamsTest, PassesCapturesToHandler) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /files/ana/a.txt?x=1 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "POST /files/bo HTTP/1.1\r\nHost: localhost\r\nContent-Length: 3\r\n\r\nabc"
+        "GET /filesX/ana HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    std::string response = ReadResponses(3);
+    EXPECT_NE(response.find("owner=ana rest=/a.txt;"), std::string::npos);
+    EXPECT_NE(response.find("owner=bo rest=;"), std::string::npos);
+    EXPECT_NE(response.find("404 Not Found"), std::string::npos);
+}
+
+// Answers with a body too large for the socket buffers, so its write stays
+// outstanding until the client reads
+class LargeReplyHandler : public http::server::RequestHandler {
+public:
+    static http::server::RequestHandler* Init(const std::string&, const NginxConfig*) {
+        return new LargeReplyHandler();
+    }
+
+    std::unique_ptr<http::server::reply> handle_request(const http::server::request&) override {
+        return BuildResponse(http::server::reply::ok, std::string(256 * 1024, 'x'),
+                             std::vector<http::server::header>());
+    }
+};
+
+class SessionDrainWriteTest : public SessionKeepAliveTest {
+protected:
+    void AddHandlers(std::map<std::string, HandlerConfig>& handler_configs) override {
+        http::server::RequestHandlerRegistry::RegisterHandler("LargeReplyHandler",
+                                                              LargeReplyHandler::Init);
+        handler_configs["/large"].type = "LargeReplyHandler";
+    }
+};
+
+// Draining while the last reply is still being written closes the
+// connection once the write completes
+TEST_F(SessionDrainWriteTest, ClosesAfterPendingWrite) {
+    client_socket_->set_option(boost::asio::socket_base::receive_buffer_size(4096));
+    session_watch_.lock()->socket().set_option(boost::asio::socket_base::send_buffer_size(4096));
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /large HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    // Lets the reply fill the socket buffers before the drain
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    session_watch_.lock()->drain();
+    client_socket_->set_option(boost::asio::socket_base::receive_buffer_size(1024 * 1024));
+    EXPECT_NE(ReadResponses(1).find("Connection: keep-alive"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// Streams its reply: /stream/sized from a string_body, /stream/file from
+// stream_file, anything else from a generator of unknown length
+class StreamingHandler : public http::server::RequestHandler {
+public:
+    static http::server::RequestHandler* Init(const std::string&, const NginxConfig*) {
+        return new StreamingHandler();
+    }
+
+    static constexpr const char* stream_file = "./session_stream_test.txt";
+
+    std::unique_ptr<http::server::reply> handle_request(
+        const http::server::request& request) override {
+        if (request.uri == "/stream/file") {
+            return BuildStreamingResponse(http::server::reply::ok,
+                http::server::file_body::open(stream_file));
+        }
+        if (request.uri == "/stream/sized") {
+            return BuildStreamingResponse(http::server::reply::ok,
+                std::make_unique<http::server::string_body>(std::string(5000, 's')));
+        }
+        auto pieces = std::make_shared<int>(3);
+        return BuildStreamingResponse(http::server::reply::ok,
+            std::make_unique<http::server::generator_body>(
+                [pieces](char* out, size_t capacity) -> size_t {
+                    if ((*pieces)-- == 0) return 0;
+                    std::memcpy(out, "piece;", 6);
+                    return 6;
+                }));
+    }
+};
+
+class SessionStreamingTest : public SessionKeepAliveTest {
+protected:
+    void AddHandlers(std::map<std::string, HandlerConfig>& handler_configs) override {
+        http::server::RequestHandlerRegistry::RegisterHandler("StreamingHandler",
+                                                              StreamingHandler::Init);
+        HandlerConfig streaming_config;
+        streaming_config.type = "StreamingHandler";
+        handler_configs["/stream"] = std::move(streaming_config);
+    }
+
+    SessionOptions Options() override {
+        SessionOptions options;
+        options.output_buffer_size = 1024;
+        return options;
+    }
+
+    // Reads until terminator has arrived or the connection closes
+    std::string ReadUntil(const std::string& terminator) {
+        std::string received;
+        char buffer[1024];
+        boost::system::error_code ec;
+        while (received.find(terminator) == std::string::npos) {
+            size_t n = client_socket_->read_some(boost::asio::buffer(buffer), ec);
+            if (ec) break;
+            received.append(buffer, n);
+        }
+        return received;
+    }
+};
+
+// A body of known size goes out in output buffer sized writes under its Content-Length
+TEST_F(SessionStreamingTest, StreamsSizedBody) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /stream/sized HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    std::string response = ReadResponses(1);
+    EXPECT_NE(response.find("Content-Length: 5000"), std::string::npos);
+    EXPECT_EQ(response.find("Transfer-Encoding"), std::string::npos);
+    size_t body = response.find("\r\n\r\n");
+    ASSERT_NE(body, std::string::npos);
+    EXPECT_EQ(response.substr(body + 4), std::string(5000, 's'));
+}
+
+// A file body is sent straight from the file, larger than the socket buffers
+// can take at once, and the connection carries on after it
+TEST_F(SessionStreamingTest, SendsFileBody) {
+    std::string contents;
+    for (int i = 0; contents.size() < 1024 * 1024; ++i) {
+        contents += std::to_string(i) + "\n";
+    }
+    {
+        std::ofstream file(StreamingHandler::stream_file, std::ios::binary);
+        file << contents;
+    }
+
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /stream/file HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    std::string response = ReadUntil("GET /echo");
+    std::remove(StreamingHandler::stream_file);
+    EXPECT_NE(response.find("Content-Length: " + std::to_string(contents.size())),
+              std::string::npos);
+    size_t body = response.find("\r\n\r\n");
+    ASSERT_NE(body, std::string::npos);
+    EXPECT_EQ(response.compare(body + 4, contents.size(), contents), 0);
+    EXPECT_EQ(response.compare(body + 4 + contents.size(), 15, "HTTP/1.1 200 OK"), 0);
+}
+
+// A body of unknown size is sent chunked and the connection stays open
+TEST_F(SessionStreamingTest, StreamsChunkedBody) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /stream/chunked HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n")));
+    std::string response = ReadUntil("GET /echo");
+    EXPECT_NE(response.find("Transfer-Encoding: chunked"), std::string::npos);
+    EXPECT_NE(response.find("\r\n\r\n6\r\npiece;\r\n6\r\npiece;\r\n6\r\npiece;\r\n0\r\n\r\n"
+                            "HTTP/1.1 200 OK"), std::string::npos);
+    EXPECT_NE(response.find("Connection: keep-alive"), std::string::npos);
+}
+
+// HTTP/1.0 has no chunked encoding, so the body ends with the connection
+TEST_F(SessionStreamingTest, Http10UnknownLengthClosesConnection) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /stream/chunked HTTP/1.0\r\nConnection: keep-alive\r\n\r\n")));
+    std::string response = ReadUntil("\r\n\r\npiece;piece;piece;");
+    EXPECT_NE(response.find("Connection: close"), std::string::npos);
+    EXPECT_EQ(response.find("Transfer-Encoding"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// Replies with the request body it was handed whole
+class BodyHandler : public http::server::RequestHandler {
+public:
+    static http::server::RequestHandler* Init(const std::string&, const NginxConfig*) {
+        return new BodyHandler();
+    }
+
+    std::unique_ptr<http::server::reply> handle_request(
+        const http::server::request& request) override {
+        return BuildResponse(http::server::reply::ok, request.body);
+    }
+};
+
+// Consumes bodies as they arrive and reports how they came in; refuses
+// requests under /streamed/reject from their headers
+class StreamedBodyHandler : public http::server::RequestHandler {
+public:
+    static http::server::RequestHandler* Init(const std::string&, const NginxConfig*) {
+        return new StreamedBodyHandler();
+    }
+
+    std::unique_ptr<http::server::reply> handle_request(
+        const http::server::request& request) override {
+        return BuildResponse(http::server::reply::ok, "buffered\r\n");
+    }
+
+    bool streams_body() const override { return true; }
+
+    std::unique_ptr<http::server::reply> on_headers(
+        const http::server::request_view& request) override {
+        if (request.uri.starts_with("/streamed/reject")) {
+            return BuildResponse(http::server::reply::forbidden, "rejected\r\n");
+        }
+        return nullptr;
+    }
+
+    void on_body_chunk(std::string_view chunk) override {
+        bytes_ += chunk.size();
+        all_same_ &= chunk.find_first_not_of('b') == std::string_view::npos;
+        ++chunks_;
+    }
+
+    std::unique_ptr<http::server::reply> on_complete() override {
+        return BuildResponse(http::server::reply::ok,
+            std::to_string(bytes_) + " bytes in " + std::to_string(chunks_) + " chunks" +
+            (all_same_ ? "" : " (corrupt)") + "\r\n");
+    }
+
+private:
+    size_t bytes_ = 0;
+    size_t chunks_ = 0;
+    bool all_same_ = true;
+};
+
+class SessionRequestBodyTest : public SessionKeepAliveTest {
+protected:
+    void AddHandlers(std::map<std::string, HandlerConfig>& handler_configs) override {
+        http::server::RequestHandlerRegistry::RegisterHandler("BodyHandler", BodyHandler::Init);
+        http::server::RequestHandlerRegistry::RegisterHandler("StreamedBodyHandler",
+                                                              StreamedBodyHandler::Init);
+        HandlerConfig body_config;
+        body_config.type = "BodyHandler";
+        handler_configs["/body"] = std::move(body_config);
+        HandlerConfig streamed_config;
+        streamed_config.type = "StreamedBodyHandler";
+        handler_configs["/streamed"] = std::move(streamed_config);
+    }
+
+    SessionOptions Options() override {
+        SessionOptions options;
+        options.body_buffer_size = 1024;
+        return options;
+    }
+
+    // Sends headers, then body in pieces with pauses so they arrive as
+    // separate reads
+    void SendInPieces(const std::string& headers, const std::string& body, size_t piece) {
+        boost::asio::write(*client_socket_, boost::asio::buffer(headers));
+        for (size_t sent = 0; sent < body.size(); sent += piece) {
+            boost::asio::write(*client_socket_,
+                boost::asio::buffer(body.data() + sent, std::min(piece, body.size() - sent)));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+};
+
+// A body past client_body_buffer_size is spooled and handed over whole
+TEST_F(SessionRequestBodyTest, SpoolsLargeBody) {
+    std::string body;
+    for (int i = 0; body.size() < 8192; ++i) {
+        body += std::to_string(i) + ",";
+    }
+    SendInPieces("POST /body HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) +
+                 "\r\n\r\n", body, 2048);
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /body HTTP/1.1\r\n\r\n")));
+
+    std::string response = ReadResponses(2);
+    EXPECT_EQ(CountOf(response, "200 OK"), 2);
+    EXPECT_NE(response.find("\r\n\r\n" + body + "HTTP/1.1 200 OK"), std::string::npos);
+}
+
+// A streaming handler gets the body piece by piece, never all at once
+TEST_F(SessionRequestBodyTest, StreamsBodyToHandler) {
+    std::string body(8192, 'b');
+    SendInPieces("POST /streamed HTTP/1.1\r\nContent-Length: 8192\r\n\r\n", body, 2048);
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "GET /streamed HTTP/1.1\r\n\r\n")));
+
+    std::string response = ReadResponses(2);
+    size_t report = response.find("8192 bytes in ");
+    ASSERT_NE(report, std::string::npos);
+    EXPECT_GT(std::stoul(response.substr(report + 14)), 1);
+    EXPECT_EQ(response.find("corrupt"), std::string::npos);
+    // Requests without a body still go to handle_request()
+    EXPECT_NE(response.find("buffered"), std::string::npos);
+}
+
+// A reply from on_headers() leaves an unsent body unread and closes
+TEST_F(SessionRequestBodyTest, EarlyReplyClosesConnection) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /streamed/reject HTTP/1.1\r\nContent-Length: 100000\r\n\r\n")));
+
+    std::string response = ReadResponses(1);
+    EXPECT_NE(response.find("403 Forbidden"), std::string::npos);
+    EXPECT_NE(response.find("Connection: close"), std::string::npos);
+    EXPECT_TRUE(ServerClosed());
+}
+
+// An early reply skips a body that is already buffered and keeps the connection
+TEST_F(SessionRequestBodyTest, EarlyReplySkipsBufferedBody) {
+    boost::asio::write(*client_socket_, boost::asio::buffer(std::string(
+        "POST /streamed/reject HTTP/1.1\r\nContent-Length: 5\r\n\r\nbbbbb"
+        "POST /streamed HTTP/1.1\r\nContent-Length: 3\r\n\r\nbbb")));
+
+    std::string response = ReadResponses(2);
+    EXPECT_NE(response.find("403 Forbidden"), std::string::npos);
+    EXPECT_NE(response.find("3 bytes in 1 chunks"), std::string::npos);
+    EXPECT_EQ(response.find("Connection: close"), std::string::npos);
+}
+
 // New test for handler registration mechanism
 TEST_F(HandlerRegistryTest, CanCreateHandlerFromRegistry) {
     http::server::RequestHandlerRegistry registry;
@@ -308,6 +1383,68 @@ TEST_F(HandlerRegistryTest, CanCreateHandlerFromRegistry) {
     EXPECT_NE(not_found_handler, nullptr);
 }
 
+// Reusable handlers are built once per location; others for every request
+TEST_F(HandlerRegistryTest, SharesReusableHandlers) {
+    http::server::RequestHandlerRegistry::RegisterHandler("BodyHandler", BodyHandler::Init);
+    std::map<std::string, HandlerConfig> handler_configs;
+    handler_configs["/echo"].type = "EchoHandler";
+    handler_configs["/echo2"].type = "EchoHandler";
+    handler_configs["/body"].type = "BodyHandler";
+    http::server::RequestHandlerRegistry registry;
+    ASSERT_TRUE(registry.Init(handler_configs));
+
+    std::string handler_name;
+    auto echo = registry.CreateHandler("/echo/a", handler_name);
+    EXPECT_EQ(echo, registry.CreateHandler("/echo/b", handler_name));
+    EXPECT_NE(echo, registry.CreateHandler("/echo2", handler_name));
+    EXPECT_EQ(handler_name, "EchoHandler");
+
+    auto body = registry.CreateHandler("/body", handler_name);
+    EXPECT_FALSE(body->is_reusable());
+    EXPECT_NE(body, registry.CreateHandler("/body", handler_name));
+
+    EXPECT_EQ(registry.CreateHandler("/unknown", handler_name),
+              registry.CreateHandler("/missing", handler_name));
+}
+
+// Locations match whole path segments and hand their captures to the request
+TEST_F(HandlerRegistryTest, RoutesOnSegmentsWithParams) {
+    std::map<std::string, HandlerConfig> handler_configs;
+    handler_configs["/echo"].type = "EchoHandler";
+    handler_configs["/files/{owner}"].type = "EchoHandler";
+    handler_configs["/files/{owner}"].max_body_size = 10;
+    http::server::RequestHandlerRegistry registry;
+    ASSERT_TRUE(registry.Init(handler_configs));
+
+    std::string handler_name;
+    http::server::route_params params;
+    auto not_found = registry.CreateHandler("/unknown", handler_name);
+    EXPECT_EQ(registry.CreateHandler("/echoes", handler_name, &params), not_found);
+    EXPECT_FALSE(params.matched());
+    EXPECT_NE(registry.CreateHandler("/echo/a", handler_name, &params), not_found);
+
+    std::string uri = "/files/ana/notes.txt";
+    EXPECT_NE(registry.CreateHandler(uri, handler_name, &params), not_found);
+    EXPECT_EQ(params.get("owner", uri), "ana");
+    EXPECT_EQ(params.remainder(uri), "/notes.txt");
+    EXPECT_EQ(registry.MaxBodySize(uri, 100), 10);
+    EXPECT_EQ(registry.MaxBodySize("/files", 100), 100);
+
+    // A location routed once serves both the body limit and the handler
+    const auto* location = registry.Route(uri, params);
+    ASSERT_NE(location, nullptr);
+    EXPECT_EQ(params.get("owner", uri), "ana");
+    EXPECT_EQ(registry.MaxBodySize(location, 100), 10);
+    EXPECT_NE(registry.CreateHandler(location, handler_name), not_found);
+    EXPECT_EQ(registry.Route("/echoes", params), nullptr);
+    EXPECT_EQ(registry.MaxBodySize(nullptr, 100), 100);
+    EXPECT_EQ(registry.CreateHandler(nullptr, handler_name), not_found);
+
+    // Locations the router cannot take fail the whole configuration
+    handler_configs["/bad//path"].type = "EchoHandler";
+    EXPECT_FALSE(registry.Init(handler_configs));
+}
+
 int main(int argc, char** argv) {
     // Explicitly register all handlers at program start
     http::server::EchoHandler::Register();
@@ -0,0 +1,28 @@
+#include "gtest/gtest.h"
+#include "spooled_body.h"
+#include <string>
+
+using http::server::spooled_body;
+
+// TEST: Appended pieces read back as one contiguous body
+TEST(SpooledBodyTest, ContentsJoinAppendedPieces) {
+  spooled_body spool;
+  std::string expected;
+  for (int i = 0; i < 1000; ++i) {
+    std::string piece = std::to_string(i) + ",";
+    spool.append(piece.data(), piece.size());
+    expected += piece;
+  }
+  EXPECT_EQ(spool.size(), expected.size());
+  EXPECT_EQ(spool.contents(), expected);
+
+  // Mapped once; later calls see the same bytes
+  EXPECT_EQ(spool.contents().data(), spool.contents().data());
+}
+
+// TEST: An empty spool has empty contents
+TEST(SpooledBodyTest, EmptySpool) {
+  spooled_body spool;
+  EXPECT_EQ(spool.size(), 0);
+  EXPECT_TRUE(spool.contents().empty());
+}
@@ -53,7 +53,7 @@ class TextViewHandlerTest : public ::testing::Test {
             return true;
         }
 
-        void check_headers(std::vector<header> headers, const std::string content_length, const std::string content_type,  bool& found_content_length, bool& found_content_type) {
+        void check_headers(const std::pmr::vector<header>& headers, std::string_view content_length, std::string_view content_type,  bool& found_content_length, bool& found_content_type) {
             // Find content type and content length header
             for (const auto& header : headers) {
                 if (header.name == "Content-Type" && header.value == content_type)
@@ -79,7 +79,7 @@ class TextViewHandlerTest : public ::testing::Test {
 
         // check OK status
         EXPECT_EQ(rep->status, http::server::reply::ok);
-        EXPECT_EQ(rep->content, text_content+"\r\n");
+        EXPECT_EQ(std::string(rep->content), text_content+"\r\n");
 
         // Find content type and content length header
         bool found_content_length = false;
@@ -125,7 +125,7 @@ class TextViewHandlerTest : public ::testing::Test {
                                         "<li>Num 2</li>\n" \
                                         "</ol>\n" \
                                         "</html>";
-        EXPECT_EQ(rep->content, rendered_markdown + "\r\n");
+        EXPECT_EQ(std::string(rep->content), rendered_markdown + "\r\n");
 
         // Find content type and content length header
         bool found_content_length = false;
@@ -149,7 +149,7 @@ class TextViewHandlerTest : public ::testing::Test {
         std::string expected_content = "This is a test pdf.\r\n";
         // check OK status
         EXPECT_EQ(rep->status, http::server::reply::ok);
-        EXPECT_EQ(rep->content, expected_content);
+        EXPECT_EQ(std::string(rep->content), expected_content);
 
         // Find content type and content length header
         bool found_content_length = false;
@@ -187,7 +187,7 @@ class TextViewHandlerTest : public ::testing::Test {
 
         // check ok status
         EXPECT_EQ(rep->status, http::server::reply::ok);
-        EXPECT_EQ(rep->content, text_content+"\r\n");
+        EXPECT_EQ(std::string(rep->content), text_content+"\r\n");
 
         // Find content type and content length header
         bool found_content_length = false;
@@ -0,0 +1,125 @@
+#include "gtest/gtest.h"
+#include "timing_wheel.h"
+#include <boost/asio.hpp>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// Records every expiry it receives
+class counting_entry : public timing_wheel::entry {
+public:
+  void on_expire(std::uint64_t sequence) override {
+    ++expired;
+    last_sequence = sequence;
+    expired_at = std::chrono::steady_clock::now();
+  }
+
+  int expired = 0;
+  std::uint64_t last_sequence = 0;
+  std::chrono::steady_clock::time_point expired_at;
+};
+
+}  // namespace
+
+// TEST: Each io_service gets its own wheel
+TEST(TimingWheelTest, OneWheelPerIoService) {
+  boost::asio::io_service first;
+  boost::asio::io_service second;
+  timing_wheel& wheel = boost::asio::use_service<timing_wheel>(first);
+  EXPECT_EQ(&wheel, &boost::asio::use_service<timing_wheel>(first));
+  EXPECT_NE(&wheel, &boost::asio::use_service<timing_wheel>(second));
+}
+
+// TEST: An entry expires no earlier than its timeout, and the wheel then stops ticking
+TEST(TimingWheelTest, ExpiresAfterTimeout) {
+  boost::asio::io_service io_service;
+  timing_wheel& wheel = boost::asio::use_service<timing_wheel>(io_service);
+  counting_entry entry;
+
+  auto start = std::chrono::steady_clock::now();
+  std::uint64_t sequence = wheel.schedule(entry, std::chrono::milliseconds(250));
+  EXPECT_EQ(wheel.size(), 1);
+
+  // run() returns once the wheel is empty
+  io_service.run();
+  EXPECT_EQ(entry.expired, 1);
+  EXPECT_EQ(entry.last_sequence, sequence);
+  EXPECT_GE(entry.expired_at - start, std::chrono::milliseconds(250));
+  EXPECT_EQ(wheel.size(), 0);
+}
+
+// TEST: A cancelled entry never expires
+TEST(TimingWheelTest, CancelPreventsExpiry) {
+  boost::asio::io_service io_service;
+  timing_wheel& wheel = boost::asio::use_service<timing_wheel>(io_service);
+  counting_entry entry;
+
+  wheel.schedule(entry, std::chrono::milliseconds(100));
+  wheel.cancel(entry);
+  EXPECT_EQ(wheel.size(), 0);
+
+  io_service.run();
+  EXPECT_EQ(entry.expired, 0);
+}
+
+// TEST: Scheduling again replaces the earlier deadline
+TEST(TimingWheelTest, RescheduleReplacesDeadline) {
+  boost::asio::io_service io_service;
+  timing_wheel& wheel = boost::asio::use_service<timing_wheel>(io_service);
+  counting_entry entry;
+
+  auto start = std::chrono::steady_clock::now();
+  std::uint64_t first = wheel.schedule(entry, std::chrono::milliseconds(100));
+  std::uint64_t second = wheel.schedule(entry, std::chrono::milliseconds(400));
+  EXPECT_NE(first, second);
+  EXPECT_EQ(wheel.size(), 1);
+
+  io_service.run();
+  EXPECT_EQ(entry.expired, 1);
+  EXPECT_EQ(entry.last_sequence, second);
+  EXPECT_GE(entry.expired_at - start, std::chrono::milliseconds(400));
+}
+
+// TEST: Destroying a scheduled entry removes it from the wheel
+TEST(TimingWheelTest, DestroyedEntryIsRemoved) {
+  boost::asio::io_service io_service;
+  timing_wheel& wheel = boost::asio::use_service<timing_wheel>(io_service);
+  {
+    counting_entry entry;
+    wheel.schedule(entry, std::chrono::milliseconds(100));
+    EXPECT_EQ(wheel.size(), 1);
+  }
+  EXPECT_EQ(wheel.size(), 0);
+  io_service.run();
+}
+
+// TEST: Many entries sharing buckets all expire, in deadline order
+TEST(TimingWheelTest, ExpiresManyEntries) {
+  boost::asio::io_service io_service;
+  timing_wheel& wheel = boost::asio::use_service<timing_wheel>(io_service);
+  std::vector<std::unique_ptr<counting_entry>> entries;
+  for (int i = 0; i < 10000; ++i) {
+    entries.push_back(std::make_unique<counting_entry>());
+    wheel.schedule(*entries.back(), std::chrono::milliseconds(100 + (i % 3) * 100));
+  }
+  EXPECT_EQ(wheel.size(), 10000);
+
+  io_service.run();
+  EXPECT_EQ(wheel.size(), 0);
+  for (int i = 0; i < 10000; ++i) {
+    EXPECT_EQ(entries[i]->expired, 1);
+  }
+  EXPECT_LT(entries[0]->expired_at, entries[2]->expired_at);
+}
+
+// TEST: Entries left on the wheel are detached when the io_service goes away
+TEST(TimingWheelTest, ShutdownDetachesEntries) {
+  counting_entry entry;
+  {
+    boost::asio::io_service io_service;
+    boost::asio::use_service<timing_wheel>(io_service).schedule(entry, std::chrono::seconds(60));
+  }
+  EXPECT_EQ(entry.expired, 0);
+}
@@ -367,4 +367,55 @@ TEST_F(UploadHandlerTest, AcceptsValidSubpaths) {
         ASSERT_NE(response, nullptr);
         EXPECT_NE(response->status, reply::not_found) << "Should accept path: " << path;
     }
-}
\ No newline at end of file
+}
+
+// Test an upload streamed in small pieces, split across delimiters
+TEST_F(UploadHandlerTest, StreamedUploadIsWrittenAsItArrives) {
+    std::string boundary = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+    std::string file_content;
+    for (int i = 0; file_content.size() < 100 * 1024; ++i) {
+        file_content += "line " + std::to_string(i) + "\r\n";
+    }
+    std::string form_body = create_multipart_form(boundary, "streamed.txt", file_content);
+    request req = create_post_request("", boundary);
+
+    ASSERT_EQ(handler_->on_headers(request_view(req)), nullptr);
+    for (size_t sent = 0; sent < form_body.size(); sent += 7) {
+        handler_->on_body_chunk(std::string_view(form_body).substr(sent, 7));
+    }
+    auto response = handler_->on_complete();
+
+    ASSERT_NE(response, nullptr);
+    EXPECT_EQ(response->status, reply::ok);
+    EXPECT_THAT(response->content, HasSubstr("streamed.txt"));
+
+    // Exactly the file, with nothing left over from the upload
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(test_upload_dir_)) {
+        files.push_back(entry.path());
+    }
+    ASSERT_EQ(files.size(), 1);
+    std::ifstream saved(files[0], std::ios::binary);
+    std::string saved_content((std::istreambuf_iterator<char>(saved)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(saved_content, file_content);
+}
+
+// Test that a streamed upload past the size limit stops and leaves no file
+TEST_F(UploadHandlerTest, StreamedUploadTooLargeLeavesNoFile) {
+    std::string boundary = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+    request req = create_post_request("", boundary);
+    ASSERT_EQ(handler_->on_headers(request_view(req)), nullptr);
+
+    handler_->on_body_chunk("--" + boundary + "\r\n"
+        "Content-Disposition: form-data; name=\"file\"; filename=\"big.txt\"\r\n\r\n");
+    std::string piece(64 * 1024, 'A');
+    for (int i = 0; i < 20; ++i) {
+        handler_->on_body_chunk(piece);
+    }
+    auto response = handler_->on_complete();
+
+    ASSERT_NE(response, nullptr);
+    EXPECT_EQ(response->status, reply::bad_request);
+    EXPECT_THAT(response->content, HasSubstr("File validation failed"));
+    EXPECT_TRUE(std::filesystem::is_empty(test_upload_dir_));
+}
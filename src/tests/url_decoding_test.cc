@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include "request.hpp"
+#include "url_decoding.h"
+#include <string>
+
+using http::server::parameter_map;
+using http::server::parse_cookies;
+using http::server::parse_query;
+using http::server::request;
+using http::server::url_decode;
+
+// TEST: Escapes become bytes; '+' is a space only where asked
+TEST(UrlDecodingTest, DecodesEscapes) {
+  EXPECT_EQ(url_decode("plain"), "plain");
+  EXPECT_EQ(url_decode("a%20b%2Fc"), "a b/c");
+  EXPECT_EQ(url_decode("%e2%9C%93"), "\xe2\x9c\x93");
+  EXPECT_EQ(url_decode("x+y"), "x y");
+  EXPECT_EQ(url_decode("x+y", false), "x+y");
+  EXPECT_EQ(url_decode("%00", false), std::string(1, '\0'));
+}
+
+// TEST: A '%' without two hex digits after it is kept as it is
+TEST(UrlDecodingTest, KeepsMalformedEscapes) {
+  EXPECT_EQ(url_decode("100%"), "100%");
+  EXPECT_EQ(url_decode("%4"), "%4");
+  EXPECT_EQ(url_decode("%zz%41"), "%zzA");
+  EXPECT_EQ(url_decode("%%41"), "%A");
+}
+
+// TEST: Decoding appends to what the output already holds
+TEST(UrlDecodingTest, AppendsToOutput) {
+  std::string out = "name=";
+  url_decode("J%C3%BCrgen", out);
+  EXPECT_EQ(out, "name=J\xc3\xbcrgen");
+}
+
+// TEST: The path and query of a URI are split at the first '?'
+TEST(UrlDecodingTest, SplitsUri) {
+  EXPECT_EQ(http::server::uri_path("/static/a.txt?v=1?x"), "/static/a.txt");
+  EXPECT_EQ(http::server::uri_query("/static/a.txt?v=1?x"), "v=1?x");
+  EXPECT_EQ(http::server::uri_path("/static/a.txt"), "/static/a.txt");
+  EXPECT_EQ(http::server::uri_query("/static/a.txt"), "");
+}
+
+// TEST: Query strings decode names and values and keep their order
+TEST(UrlDecodingTest, ParsesQuery) {
+  parameter_map params;
+  parse_query("q=hello+world&lang=en&&flag&q=second&e%3Dmc2=%26", params);
+  ASSERT_EQ(params.size(), 5);
+  EXPECT_EQ(params.get("q"), "hello world");
+  EXPECT_EQ(params.get("lang"), "en");
+  EXPECT_TRUE(params.contains("flag"));
+  EXPECT_EQ(params.get("flag"), "");
+  EXPECT_EQ(params.get("e=mc2"), "&");
+  EXPECT_EQ(params.find("missing"), nullptr);
+  EXPECT_EQ((params.begin() + 3)->second, "second");
+}
+
+// TEST: Cookies are split on ';' and trimmed but not decoded
+TEST(UrlDecodingTest, ParsesCookies) {
+  parameter_map cookies;
+  parse_cookies("session_token=abc%3D; theme=\"dark\" ;invalid; ; x=", cookies);
+  ASSERT_EQ(cookies.size(), 3);
+  EXPECT_EQ(cookies.get("session_token"), "abc%3D");
+  EXPECT_EQ(cookies.get("theme"), "dark");
+  EXPECT_TRUE(cookies.contains("x"));
+  EXPECT_FALSE(cookies.contains("invalid"));
+}
+
+// TEST: A request parses its query, form body and cookies when first asked
+TEST(UrlDecodingTest, RequestParsesParametersLazily) {
+  request req;
+  req.method = "POST";
+  req.uri = "/login?next=%2Fupload";
+  req.headers.push_back({"Content-Type", "application/x-www-form-urlencoded; charset=UTF-8"});
+  req.headers.push_back({"Cookie", "a=1"});
+  req.headers.push_back({"cookie", "session_token=t0k3n"});
+  req.body = "email=student%40ucla.edu&remember=on";
+
+  EXPECT_EQ(req.query_params().get("next"), "/upload");
+  EXPECT_EQ(req.form_params().get("email"), "student@ucla.edu");
+  EXPECT_EQ(req.cookies().get("a"), "1");
+  EXPECT_EQ(req.cookies().get("session_token"), "t0k3n");
+  // The same maps are returned afterwards
+  EXPECT_EQ(&req.form_params(), &req.form_params());
+
+  // Other body types are not taken as forms
+  request upload;
+  upload.headers.push_back({"Content-Type", "multipart/form-data; boundary=x"});
+  upload.body = "email=ignored";
+  EXPECT_TRUE(upload.form_params().empty());
+}
@@ -1,5 +1,6 @@
 
 #include "text_view_handler.h"
+#include "url_decoding.h"
 #include <sstream>
 #include <unistd.h> 
 #include <iostream> 
@@ -10,9 +11,7 @@ namespace http {
 namespace server {
 std::unique_ptr<reply> TextViewHandler::handle_request(const request& request) {
     std::string id;
-    // allow special chars in uri
-    std::string uri = urlDecode(request.uri);
-    if (!parse_uri(uri, id))
+    if (!parse_uri(request, id))
         return BuildResponse(reply::bad_request, "Invalid request uri\r\n");
     
     std::string content;
@@ -81,47 +80,23 @@ bool TextViewHandler::read_pdf(std::string& content, const std::string &id) {
         return false;
     return true;
 }
-bool TextViewHandler::parse_uri(const std::string& uri, std::string& id) {
-    boost::smatch match;
-    boost::regex id_pattern(R"(^\/view\/(.+)$)");
-    if (!boost::regex_match(uri, match, id_pattern)) // invalid uri path
+bool TextViewHandler::parse_uri(const request& request, std::string& id) {
+    // a routed request knows where its location ends; otherwise the location is /view
+    std::string_view rest = request.path_remainder();
+    if (!request.route.matched()) {
+        rest = uri_path(request.uri);
+        if (rest.compare(0, 5, "/view") != 0)
+            return false;
+        rest.remove_prefix(5);
+    }
+    if (rest.size() < 2 || rest.front() != '/') // invalid uri path
         return false;
-    id = match[1];
+    // allow special chars in uri
+    id = url_decode(rest.substr(1), false);
     if (id.find("..") != std::string::npos || id.front() == '/') // prevent path attacks
         return false;
     return true;
 }
-std::string TextViewHandler::urlDecode(const std::string& encoded) {
-    std::string decoded;
-    decoded.reserve(encoded.length());
-    
-    for (size_t i = 0; i < encoded.length(); ++i) {
-        if (encoded[i] == '%' && i + 2 < encoded.length()) {
-            // Extract the two hex digits after %
-            std::string hex = encoded.substr(i + 1, 2);
-            
-            // Convert hex to integer
-            int value;
-            std::stringstream ss;
-            ss << std::hex << hex;
-            ss >> value;
-            
-            // Add the decoded character
-            decoded += static_cast<char>(value);
-            
-            // Skip the next two characters (hex digits)
-            i += 2;
-        } else if (encoded[i] == '+') {
-            // + is often used to represent space in URL encoding
-            decoded += ' ';
-        } else {
-            // Regular character, add as-is
-            decoded += encoded[i];
-        }
-    }
-    
-    return decoded;
-}
 bool TextViewHandler::read_file(const std::string& id, std::string& file_content) {
     std::string filepath = view_dir_ + "/" + id;
     std::ifstream file(filepath);
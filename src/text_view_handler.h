@@ -5,6 +5,7 @@
 #include "config_parser.h"
 #include "request_handler_registry.h"
 #include <filesystem>
+#include <string_view>
 
 namespace http {
 namespace server {
@@ -42,6 +43,7 @@ namespace server {
     TextViewHandler(const std::string& view_dir) : view_dir_(view_dir) {}
     
     std::unique_ptr<reply> handle_request(const request& request) override;
+    bool is_reusable() const override { return true; }
     // converts markdown file to an html file
     std::string render_markdown(const std::string& content);
     // reads pdf file by converting to txt file
@@ -49,8 +51,7 @@ namespace server {
   private:
     std::string view_dir_;
     // request path and file parsing
-    std::string urlDecode(const std::string& encoded);
-    bool parse_uri(const std::string& uri, std::string& id);
+    bool parse_uri(const request& request, std::string& id);
     bool read_file(const std::string& id, std::string& file_content);
     bool parse_file_extension(const std::string& id, std::string& file_extension);
     // converts each markdown line to html
@@ -0,0 +1,145 @@
+#include "timing_wheel.h"
+#include <algorithm>
+
+boost::asio::execution_context::id timing_wheel::id;
+
+timing_wheel::entry::~entry() {
+  if (wheel_) {
+    wheel_->cancel(*this);
+  }
+}
+
+timing_wheel::timing_wheel(boost::asio::io_context& io_context)
+  : boost::asio::execution_context::service(io_context),
+    timer_(io_context),
+    slots_(num_slots, nullptr) {
+}
+
+timing_wheel::~timing_wheel() {
+  shutdown();
+}
+
+std::chrono::milliseconds timing_wheel::tick_duration() {
+  return std::chrono::milliseconds(100);
+}
+
+std::uint64_t timing_wheel::schedule(entry& e, std::chrono::milliseconds timeout) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (e.wheel_) {
+    unlink(e);
+  }
+
+  // Round up so an entry never fires early
+  std::size_t ticks = (timeout.count() + tick_duration().count() - 1) / tick_duration().count();
+  insert(e, std::max<std::size_t>(ticks, 1));
+  start_ticking();
+  return ++e.sequence_;
+}
+
+void timing_wheel::cancel(entry& e) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (e.wheel_) {
+    unlink(e);
+  }
+  ++e.sequence_;
+}
+
+std::size_t timing_wheel::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return count_;
+}
+
+void timing_wheel::shutdown() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (entry*& head : slots_) {
+    while (head) {
+      entry* e = head;
+      head = e->next_;
+      e->wheel_ = nullptr;
+      e->prev_ = e->next_ = nullptr;
+    }
+  }
+  count_ = 0;
+  boost::system::error_code ignored_ec;
+  timer_.cancel(ignored_ec);
+  ticking_ = false;
+}
+
+void timing_wheel::start_ticking() {
+  if (ticking_) {
+    return;
+  }
+  ticking_ = true;
+  next_tick_ = std::chrono::steady_clock::now() + tick_duration();
+  timer_.expires_at(next_tick_);
+  timer_.async_wait([this](const boost::system::error_code& error) {
+    handle_tick(error);
+  });
+}
+
+void timing_wheel::handle_tick(const boost::system::error_code& error) {
+  if (error == boost::asio::error::operation_aborted) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!ticking_) {
+    return;
+  }
+
+  // Catch up on every tick that has elapsed, in case the io thread was busy
+  auto now = std::chrono::steady_clock::now();
+  while (next_tick_ <= now) {
+    cursor_ = (cursor_ + 1) % num_slots;
+    next_tick_ += tick_duration();
+
+    entry* e = slots_[cursor_];
+    while (e) {
+      entry* next = e->next_;
+      if (e->rounds_ == 0) {
+        unlink(*e);
+        e->on_expire(e->sequence_);
+      } else {
+        --e->rounds_;
+      }
+      e = next;
+    }
+  }
+
+  // Stop when idle so the io_service can run out of work
+  if (count_ == 0) {
+    ticking_ = false;
+    return;
+  }
+  timer_.expires_at(next_tick_);
+  timer_.async_wait([this](const boost::system::error_code& error) {
+    handle_tick(error);
+  });
+}
+
+void timing_wheel::insert(entry& e, std::size_t ticks) {
+  e.wheel_ = this;
+  e.slot_ = (cursor_ + ticks) % num_slots;
+  e.rounds_ = (ticks - 1) / num_slots;
+  e.prev_ = nullptr;
+  e.next_ = slots_[e.slot_];
+  if (e.next_) {
+    e.next_->prev_ = &e;
+  }
+  slots_[e.slot_] = &e;
+  ++count_;
+}
+
+void timing_wheel::unlink(entry& e) {
+  if (e.prev_) {
+    e.prev_->next_ = e.next_;
+  } else {
+    slots_[e.slot_] = e.next_;
+  }
+  if (e.next_) {
+    e.next_->prev_ = e.prev_;
+  }
+  e.wheel_ = nullptr;
+  e.prev_ = e.next_ = nullptr;
+  --count_;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Hashed timing wheel shared by every connection on one io_service.
+//
+// Instead of one steady_timer per connection, entries are hashed into
+// num_slots buckets by expiry tick and a single steady_timer advances the
+// wheel one bucket per tick. Scheduling and cancelling are O(1), and a tick
+// only visits the bucket under the cursor, so idle connections cost nothing
+// until their bucket comes up. Timeouts longer than one revolution wait
+// extra rounds in their bucket. The timer only runs while entries exist, so
+// an io_service with no pending timeouts can still run out of work.
+//
+// Obtain the wheel for an io_service with
+//   boost::asio::use_service<timing_wheel>(io_service)
+class timing_wheel : public boost::asio::execution_context::service {
+public:
+  typedef timing_wheel key_type;
+  static boost::asio::execution_context::id id;
+
+  enum { num_slots = 512 };
+
+  // Something that can be scheduled on the wheel
+  class entry {
+  public:
+    entry() = default;
+    entry(const entry&) = delete;
+    entry& operator=(const entry&) = delete;
+    virtual ~entry();
+
+    // Called from an io thread when the entry expires, with the sequence
+    // number returned by the schedule() call that armed it. The wheel's lock
+    // is held, so implementations must not block or touch the wheel; they
+    // should post any real work elsewhere.
+    virtual void on_expire(std::uint64_t sequence) = 0;
+
+  private:
+    friend class timing_wheel;
+    timing_wheel* wheel_ = nullptr;
+    entry* prev_ = nullptr;
+    entry* next_ = nullptr;
+    std::size_t slot_ = 0;
+    std::size_t rounds_ = 0;
+    std::uint64_t sequence_ = 0;
+  };
+
+  explicit timing_wheel(boost::asio::io_context& io_context);
+  ~timing_wheel();
+
+  // Arms e to expire after timeout, replacing any earlier schedule.
+  // Returns the sequence number passed to on_expire().
+  std::uint64_t schedule(entry& e, std::chrono::milliseconds timeout);
+
+  // Disarms e if it is scheduled; on_expire() will not be called afterwards
+  void cancel(entry& e);
+
+  // Number of scheduled entries
+  std::size_t size();
+
+  // Granularity of the wheel; timeouts are rounded up to whole ticks
+  static std::chrono::milliseconds tick_duration();
+
+private:
+  void shutdown() override;
+
+  // Starts the tick timer if it is not running. Requires mutex_.
+  void start_ticking();
+  void handle_tick(const boost::system::error_code& error);
+
+  // Links e into or out of its bucket. Require mutex_.
+  void insert(entry& e, std::size_t ticks);
+  void unlink(entry& e);
+
+  std::mutex mutex_;
+  boost::asio::steady_timer timer_;
+  std::vector<entry*> slots_;
+  std::size_t cursor_ = 0;
+  std::size_t count_ = 0;
+  bool ticking_ = false;
+  std::chrono::steady_clock::time_point next_tick_;
+};
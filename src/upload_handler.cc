@@ -44,67 +44,290 @@ UploadHandler::UploadHandler(const std::string& upload_dir, const std::string& p
     }
 }
 
+UploadHandler::~UploadHandler() {
+    // An upload that never completed leaves nothing behind
+    discard_file();
+}
+
 std::unique_ptr<reply> UploadHandler::handle_request(const request& request) {
+    std::unique_ptr<reply> rep = handle_request_view(request_view(request));
+    rep->expand();
+    return rep;
+}
+
+std::unique_ptr<reply> UploadHandler::handle_request_view(const request_view& request) {
+    // A buffered request goes through the same parser as a streamed one,
+    // with its whole body as a single chunk
+    if (std::unique_ptr<reply> rep = on_headers(request)) {
+        return rep;
+    }
+    on_body_chunk(request.body);
+    return on_complete();
+}
+
+std::unique_ptr<reply> UploadHandler::on_headers(const request_view& request) {
     // Check if URI matches our path prefix exactly
     if (!is_valid_upload_path(request.uri)) {
         return BuildResponse(reply::not_found, "404 Not Found");
     }
     
-    if (request.method == "GET") {
+    if (request.method == request_method::get) {
         // Serve upload form
         return create_upload_form();
-    } else if (request.method == "POST") {
-        // Handle file upload
-        
-        // Find Content-Type header
-        std::string content_type;
-        for (const auto& header : request.headers) {
-            if (header.name == "Content-Type") {
-                content_type = header.value;
+    } else if (request.method != request_method::post) {
+        return BuildResponse(reply::bad_request, "Method not allowed");
+    }
+
+    // Handle file upload
+    
+    // Find Content-Type header
+    std::string content_type;
+    if (const header_view* header = request.find_header(known_header::content_type)) {
+        content_type = header->value;
+    }
+    
+    if (content_type.find("multipart/form-data") == std::string::npos) {
+        return create_error_response("Invalid content type. Expected multipart/form-data.");
+    }
+    
+    // Extract boundary
+    std::string boundary = extract_boundary(content_type);
+    if (boundary.empty()) {
+        return create_error_response("Missing boundary in Content-Type header.");
+    }
+
+    // Every delimiter but the first follows the CRLF that ends a part, so
+    // the body is parsed as if it started with one
+    discard_file();
+    delimiter_ = "\r\n--" + boundary;
+    pending_ = "\r\n";
+    state_ = FormState::preamble;
+    field_ = FormField::ignored;
+    form_data_ = FormData();
+    error_.clear();
+    return nullptr;
+}
+
+void UploadHandler::on_body_chunk(std::string_view chunk) {
+    if (state_ == FormState::done || !error_.empty()) {
+        return;
+    }
+    pending_.append(chunk);
+    parse_form();
+}
+
+std::unique_ptr<reply> UploadHandler::on_complete() {
+    if (!error_.empty()) {
+        discard_file();
+        return create_error_response(error_);
+    }
+    if (!form_data_.has_file || form_data_.filename.empty() || form_data_.file_size == 0) {
+        discard_file();
+        return create_error_response("Failed to parse form data.");
+    }
+    
+    // Validate file
+    if (!validate_file(form_data_.filename, form_data_.file_size)) {
+        discard_file();
+        return create_error_response("File validation failed. Check file type and size.");
+    }
+    
+    // Generate unique file ID and sanitize filename
+    std::string file_id = generate_file_id();
+    std::string sanitized_name = sanitize_filename(form_data_.filename);
+    
+    // Create file path
+    std::string file_path = upload_dir_ + "/" + file_id + "_" + sanitized_name;
+    
+    // Move the finished upload into place; readers never see it half written
+    std::error_code ec;
+    std::filesystem::rename(temp_path_, file_path, ec);
+    if (ec) {
+        discard_file();
+        return create_error_response("Failed to save file to disk.");
+    }
+    temp_path_.clear();
+    
+    return create_success_response(file_id, form_data_.filename);
+}
+
+void UploadHandler::parse_form() {
+    // Longest part header block accepted
+    static const size_t max_part_headers = 8 * 1024;
+
+    while (error_.empty()) {
+        switch (state_) {
+        case FormState::preamble:
+        case FormState::part_body: {
+            size_t delimiter_pos = pending_.find(delimiter_);
+            size_t consumed = delimiter_pos;
+            if (delimiter_pos == std::string::npos) {
+                // Everything but a possible partial delimiter at the end is data
+                consumed = pending_.size() - std::min(pending_.size(), delimiter_.size() - 1);
+            }
+            if (state_ == FormState::part_body) {
+                append_to_part(std::string_view(pending_).substr(0, consumed));
+            }
+            if (delimiter_pos == std::string::npos) {
+                pending_.erase(0, consumed);
+                return;
+            }
+            pending_.erase(0, delimiter_pos + delimiter_.size());
+            if (state_ == FormState::part_body) {
+                finish_part();
+            }
+            state_ = FormState::delimiter_end;
+            break;
+        }
+        case FormState::delimiter_end:
+            // "--" closes the form; otherwise a CRLF leads into the next part
+            if (pending_.size() < 2) {
+                return;
+            }
+            if (pending_.compare(0, 2, "--") == 0) {
+                state_ = FormState::done;
                 break;
             }
+            if (pending_.compare(0, 2, "\r\n") == 0) {
+                pending_.erase(0, 2);
+            }
+            state_ = FormState::part_headers;
+            break;
+        case FormState::part_headers: {
+            size_t headers_end = pending_.find("\r\n\r\n");
+            if (headers_end == std::string::npos) {
+                if (pending_.size() > max_part_headers) {
+                    error_ = "Failed to parse form data.";
+                }
+                return;
+            }
+            std::string headers = pending_.substr(0, headers_end);
+            pending_.erase(0, headers_end + 4);
+            if (!start_part(headers)) {
+                return;
+            }
+            state_ = FormState::part_body;
+            break;
         }
-        
-        if (content_type.find("multipart/form-data") == std::string::npos) {
-            return create_error_response("Invalid content type. Expected multipart/form-data.");
+        case FormState::done:
+            // The epilogue after the closing delimiter is ignored
+            pending_.clear();
+            return;
         }
-        
-        // Extract boundary
-        std::string boundary = extract_boundary(content_type);
-        if (boundary.empty()) {
-            return create_error_response("Missing boundary in Content-Type header.");
+    }
+}
+
+bool UploadHandler::start_part(const std::string& headers) {
+    field_ = FormField::ignored;
+
+    // Parse field name and filename from headers
+    if (headers.find("name=\"file\"") != std::string::npos) {
+        if (form_data_.has_file || temp_file_.is_open()) {
+            // Only the first file of a form is kept
+            return true;
         }
-        
-        // Parse form data
-        FormData form_data;
-        if (!parse_multipart_form(request.body, boundary, form_data)) {
-            return create_error_response("Failed to parse form data.");
+
+        // This is the file field
+        size_t filename_pos = headers.find("filename=\"");
+        if (filename_pos != std::string::npos) {
+            filename_pos += 10; // length of "filename=\""
+            size_t filename_end = headers.find("\"", filename_pos);
+            if (filename_end != std::string::npos) {
+                form_data_.filename = headers.substr(filename_pos, filename_end - filename_pos);
+            }
         }
         
-        // Validate file
-        if (!validate_file(form_data.filename, form_data.content.size())) {
-            return create_error_response("File validation failed. Check file type and size.");
+        // Extract content type
+        size_t content_type_pos = headers.find("Content-Type: ");
+        if (content_type_pos != std::string::npos) {
+            content_type_pos += 14; // length of "Content-Type: "
+            size_t content_type_end = headers.find("\r\n", content_type_pos);
+            form_data_.content_type = headers.substr(content_type_pos, content_type_end - content_type_pos);
         }
-        
-        // Generate unique file ID and sanitize filename
-        std::string file_id = generate_file_id();
-        std::string sanitized_name = sanitize_filename(form_data.filename);
-        
-        // Create file path
-        std::string file_path = upload_dir_ + "/" + file_id + "_" + sanitized_name;
-        
-        // Save file to disk
-        if (!save_file_to_disk(form_data.content, file_path)) {
-            return create_error_response("Failed to save file to disk.");
+
+        if (form_data_.filename.empty()) {
+            error_ = "Failed to parse form data.";
+            return false;
         }
-        
-        return create_success_response(file_id, form_data.filename);
+
+        // Refuse a disallowed type before any of it is written
+        if (!has_allowed_extension(form_data_.filename)) {
+            error_ = "File validation failed. Check file type and size.";
+            return false;
+        }
+
+        temp_path_ = upload_dir_ + "/." + generate_file_id() + ".part";
+        temp_file_.open(temp_path_, std::ios::binary | std::ios::trunc);
+        if (!temp_file_.is_open()) {
+            temp_path_.clear();
+            error_ = "Failed to save file to disk.";
+            return false;
+        }
+        field_ = FormField::file;
+    } else if (headers.find("name=\"course_code\"") != std::string::npos) {
+        field_ = FormField::course_code;
+    } else if (headers.find("name=\"title\"") != std::string::npos) {
+        field_ = FormField::title;
+    }
+    return true;
+}
+
+void UploadHandler::append_to_part(std::string_view data) {
+    switch (field_) {
+    case FormField::file:
+        form_data_.file_size += data.size();
+        if (form_data_.file_size > max_file_size_) {
+            // Stop writing as soon as the limit is passed
+            error_ = "File validation failed. Check file type and size.";
+            discard_file();
+            field_ = FormField::ignored;
+            return;
+        }
+        temp_file_.write(data.data(), data.size());
+        if (!temp_file_) {
+            error_ = "Failed to save file to disk.";
+        }
+        break;
+    case FormField::course_code:
+    case FormField::title: {
+        // Text fields are kept in memory, so they are kept short
+        static const size_t max_field_size = 1024;
+        std::string& value = field_ == FormField::course_code ? form_data_.course_code : form_data_.title;
+        if (value.size() + data.size() > max_field_size) {
+            error_ = "Failed to parse form data.";
+            return;
+        }
+        value.append(data);
+        break;
+    }
+    case FormField::ignored:
+        break;
+    }
+}
+
+void UploadHandler::finish_part() {
+    if (field_ == FormField::file) {
+        temp_file_.close();
+        if (!temp_file_) {
+            error_ = "Failed to save file to disk.";
+        }
+        form_data_.has_file = true;
+    }
+    field_ = FormField::ignored;
+}
+
+void UploadHandler::discard_file() {
+    if (temp_file_.is_open()) {
+        temp_file_.close();
+    }
+    if (!temp_path_.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(temp_path_, ec);
+        temp_path_.clear();
     }
-    
-    return BuildResponse(reply::bad_request, "Method not allowed");
 }
 
-bool UploadHandler::is_valid_upload_path(const std::string& uri) const {
+bool UploadHandler::is_valid_upload_path(std::string_view uri) const {
     // Check for exact match or subpath
     if (uri == path_prefix_) {
         return true;
@@ -126,6 +349,10 @@ bool UploadHandler::validate_file(const std::string& filename, size_t size) {
         return false;
     }
     
+    return has_allowed_extension(filename);
+}
+
+bool UploadHandler::has_allowed_extension(const std::string& filename) {
     // Check file extension
     size_t dot_pos = filename.find_last_of('.');
     if (dot_pos == std::string::npos) {
@@ -164,23 +391,6 @@ std::string UploadHandler::sanitize_filename(const std::string& filename) {
     return sanitized;
 }
 
-bool UploadHandler::save_file_to_disk(const std::string& content, const std::string& file_path) {
-    try {
-        std::ofstream file(file_path, std::ios::binary);
-        if (!file.is_open()) {
-            return false;
-        }
-        
-        file.write(content.data(), content.size());
-        file.close();
-        
-        return true;
-    } catch (const std::exception& e) {
-        std::cerr << "Error saving file: " << e.what() << std::endl;
-        return false;
-    }
-}
-
 std::string UploadHandler::extract_boundary(const std::string& content_type) {
     size_t boundary_pos = content_type.find("boundary=");
     if (boundary_pos == std::string::npos) {
@@ -200,85 +410,8 @@ std::string UploadHandler::extract_boundary(const std::string& content_type) {
     return boundary;
 }
 
-bool UploadHandler::parse_multipart_form(const std::string& body, const std::string& boundary, FormData& form_data) {
-    std::string delimiter = "--" + boundary;
-    std::string end_delimiter = "--" + boundary + "--";
-    
-    size_t pos = 0;
-    while (pos < body.length()) {
-        // Find next boundary
-        size_t boundary_start = body.find(delimiter, pos);
-        if (boundary_start == std::string::npos) {
-            break;
-        }
-        
-        // Skip boundary
-        pos = boundary_start + delimiter.length();
-        
-        // Skip CRLF after boundary
-        if (pos + 1 < body.length() && body.substr(pos, 2) == "\r\n") {
-            pos += 2;
-        }
-        
-        // Find end of headers
-        size_t headers_end = body.find("\r\n\r\n", pos);
-        if (headers_end == std::string::npos) {
-            break;
-        }
-        
-        // Parse headers
-        std::string headers = body.substr(pos, headers_end - pos);
-        pos = headers_end + 4;
-        
-        // Find next boundary to get content
-        size_t next_boundary = body.find(delimiter, pos);
-        if (next_boundary == std::string::npos) {
-            break;
-        }
-        
-        // Extract content (remove trailing CRLF)
-        std::string content = body.substr(pos, next_boundary - pos);
-        if (content.length() >= 2 && content.substr(content.length() - 2) == "\r\n") {
-            content = content.substr(0, content.length() - 2);
-        }
-        
-        // Parse field name and filename from headers
-        if (headers.find("name=\"file\"") != std::string::npos) {
-            // This is the file field
-            size_t filename_pos = headers.find("filename=\"");
-            if (filename_pos != std::string::npos) {
-                filename_pos += 10; // length of "filename=\""
-                size_t filename_end = headers.find("\"", filename_pos);
-                if (filename_end != std::string::npos) {
-                    form_data.filename = headers.substr(filename_pos, filename_end - filename_pos);
-                }
-            }
-            
-            // Extract content type
-            size_t content_type_pos = headers.find("Content-Type: ");
-            if (content_type_pos != std::string::npos) {
-                content_type_pos += 14; // length of "Content-Type: "
-                size_t content_type_end = headers.find("\r\n", content_type_pos);
-                if (content_type_end != std::string::npos) {
-                    form_data.content_type = headers.substr(content_type_pos, content_type_end - content_type_pos);
-                }
-            }
-            
-            form_data.content = content;
-        } else if (headers.find("name=\"course_code\"") != std::string::npos) {
-            form_data.course_code = content;
-        } else if (headers.find("name=\"title\"") != std::string::npos) {
-            form_data.title = content;
-        }
-        
-        pos = next_boundary;
-    }
-    
-    return !form_data.filename.empty() && !form_data.content.empty();
-}
-
 std::unique_ptr<reply> UploadHandler::create_upload_form() {
-    std::string html = R"(
+    static constexpr std::string_view html = R"(
 <!DOCTYPE html>
 <html>
 <head>
@@ -321,14 +454,11 @@ std::unique_ptr<reply> UploadHandler::create_upload_form() {
 </body>
 </html>
 )";
-    
-    std::vector<header> headers;
-    header content_type;
-    content_type.name = "Content-Type";
-    content_type.value = "text/html";
-    headers.push_back(content_type);
-    
-    return BuildResponse(reply::ok, html, headers);
+
+    // The form never changes, so it is serialized once and shared
+    static const std::shared_ptr<const prebuilt_response> form =
+        BuildPrebuiltResponse(reply::ok, html, {{"Content-Type", "text/html"}});
+    return reply::prebuilt_reply(form);
 }
 
 std::unique_ptr<reply> UploadHandler::create_success_response(const std::string& file_id, const std::string& filename) {
@@ -2,6 +2,7 @@
 #define UPLOAD_HANDLER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <filesystem>
@@ -23,8 +24,17 @@ public:
     static bool Register();
     
     UploadHandler(const std::string& upload_dir, const std::string& path_prefix, size_t max_file_size = 10 * 1024 * 1024);
+    ~UploadHandler() override;
     
     std::unique_ptr<reply> handle_request(const request& request) override;
+    std::unique_ptr<reply> handle_request_view(const request_view& request) override;
+
+    // Uploads are parsed as they arrive: the file part is written straight
+    // to upload_dir_, so only the small form fields are held in memory
+    bool streams_body() const override { return true; }
+    std::unique_ptr<reply> on_headers(const request_view& request) override;
+    void on_body_chunk(std::string_view chunk) override;
+    std::unique_ptr<reply> on_complete() override;
 
 private:
     std::string upload_dir_;
@@ -34,21 +44,42 @@ private:
     
     // Core upload logic
     bool validate_file(const std::string& filename, size_t size);
+    bool has_allowed_extension(const std::string& filename);
     std::string generate_file_id();
     std::string sanitize_filename(const std::string& filename);
-    bool save_file_to_disk(const std::string& content, const std::string& file_path);
     
     // Form parsing
     struct FormData {
         std::string filename;
-        std::string content;
+        size_t file_size = 0;
+        bool has_file = false;
         std::string course_code;
         std::string title;
         std::string content_type;
     };
-    
-    bool parse_multipart_form(const std::string& body, const std::string& boundary, FormData& form_data);
+
+    // Incremental multipart/form-data parser. pending_ holds bytes that
+    // cannot be classified yet: an unfinished part header, or a tail that
+    // may be the start of the next delimiter.
+    enum class FormState { preamble, delimiter_end, part_headers, part_body, done };
+    enum class FormField { file, course_code, title, ignored };
+
+    void parse_form();
+    bool start_part(const std::string& headers);
+    void append_to_part(std::string_view data);
+    void finish_part();
+    void discard_file();
+
     std::string extract_boundary(const std::string& content_type);
+
+    std::string delimiter_;
+    std::string pending_;
+    FormState state_ = FormState::done;
+    FormField field_ = FormField::ignored;
+    FormData form_data_;
+    std::string error_;
+    std::string temp_path_;
+    std::ofstream temp_file_;
     
     // Response helpers
     std::unique_ptr<reply> create_upload_form();
@@ -56,7 +87,7 @@ private:
     std::unique_ptr<reply> create_error_response(const std::string& error_message);
     
     // Helper method for URI validation
-    bool is_valid_upload_path(const std::string& uri) const;
+    bool is_valid_upload_path(std::string_view uri) const;
 };
 
 } // namespace server
@@ -0,0 +1,156 @@
+#include "url_decoding.h"
+#include <array>
+#include <cstdint>
+
+namespace http {
+namespace server {
+
+namespace {
+
+// Value of each byte as a hex digit, or -1
+constexpr std::array<std::int8_t, 256> hex_values = [] {
+  std::array<std::int8_t, 256> values{};
+  for (int c = 0; c < 256; ++c) {
+    values[c] = -1;
+  }
+  for (int c = '0'; c <= '9'; ++c) {
+    values[c] = c - '0';
+  }
+  for (int c = 'a'; c <= 'f'; ++c) {
+    values[c] = c - 'a' + 10;
+    values[c - 'a' + 'A'] = c - 'a' + 10;
+  }
+  return values;
+}();
+
+int hex_value(char c) {
+  return hex_values[static_cast<unsigned char>(c)];
+}
+
+// Appends runs of plain bytes whole, so only escapes are handled one at a time
+template <typename String>
+void decode_into(std::string_view encoded, String& out, bool plus_as_space) {
+  out.reserve(out.size() + encoded.size());
+  const char* p = encoded.data();
+  const char* end = p + encoded.size();
+  while (p != end) {
+    const char* run = p;
+    while (p != end && *p != '%' && !(plus_as_space && *p == '+')) {
+      ++p;
+    }
+    out.append(run, p - run);
+    if (p == end) {
+      break;
+    }
+    if (*p == '+') {
+      out.push_back(' ');
+      ++p;
+      continue;
+    }
+    int high = end - p > 2 ? hex_value(p[1]) : -1;
+    int low = high >= 0 ? hex_value(p[2]) : -1;
+    if (low < 0) {
+      // Not an escape; keep the '%'
+      out.push_back('%');
+      ++p;
+      continue;
+    }
+    out.push_back(static_cast<char>(high * 16 + low));
+    p += 3;
+  }
+}
+
+std::string_view trim(std::string_view s) {
+  size_t begin = s.find_first_not_of(" \t");
+  if (begin == std::string_view::npos) {
+    return std::string_view();
+  }
+  return s.substr(begin, s.find_last_not_of(" \t") - begin + 1);
+}
+
+} // namespace
+
+void url_decode(std::string_view encoded, std::string& out, bool plus_as_space) {
+  decode_into(encoded, out, plus_as_space);
+}
+
+void url_decode(std::string_view encoded, std::pmr::string& out, bool plus_as_space) {
+  decode_into(encoded, out, plus_as_space);
+}
+
+std::string url_decode(std::string_view encoded, bool plus_as_space) {
+  std::string decoded;
+  decode_into(encoded, decoded, plus_as_space);
+  return decoded;
+}
+
+std::string_view uri_path(std::string_view uri) {
+  return uri.substr(0, uri.find('?'));
+}
+
+std::string_view uri_query(std::string_view uri) {
+  size_t question = uri.find('?');
+  return question == std::string_view::npos ? std::string_view() : uri.substr(question + 1);
+}
+
+const std::pmr::string* parameter_map::find(std::string_view name) const {
+  for (const value_type& entry : entries_) {
+    if (entry.first == name) {
+      return &entry.second;
+    }
+  }
+  return nullptr;
+}
+
+std::string_view parameter_map::get(std::string_view name) const {
+  const std::pmr::string* value = find(name);
+  return value ? std::string_view(*value) : std::string_view();
+}
+
+parameter_map::value_type& parameter_map::add(std::string_view name, std::string_view value) {
+  value_type& entry = entries_.emplace_back();
+  entry.first = name;
+  entry.second = value;
+  return entry;
+}
+
+void parse_query(std::string_view query, parameter_map& params) {
+  while (!query.empty()) {
+    size_t amp = query.find('&');
+    std::string_view pair = query.substr(0, amp);
+    query = amp == std::string_view::npos ? std::string_view() : query.substr(amp + 1);
+    if (pair.empty()) {
+      continue;
+    }
+    size_t equals = pair.find('=');
+    std::string_view name = pair.substr(0, equals);
+    std::string_view value = equals == std::string_view::npos ? std::string_view() : pair.substr(equals + 1);
+    // Decode straight into the entry's strings
+    parameter_map::value_type& entry = params.add(std::string_view(), std::string_view());
+    url_decode(name, entry.first);
+    url_decode(value, entry.second);
+  }
+}
+
+void parse_cookies(std::string_view cookie_header, parameter_map& cookies) {
+  while (!cookie_header.empty()) {
+    size_t semicolon = cookie_header.find(';');
+    std::string_view pair = cookie_header.substr(0, semicolon);
+    cookie_header = semicolon == std::string_view::npos ? std::string_view() : cookie_header.substr(semicolon + 1);
+    size_t equals = pair.find('=');
+    if (equals == std::string_view::npos) {
+      continue;
+    }
+    std::string_view name = trim(pair.substr(0, equals));
+    std::string_view value = trim(pair.substr(equals + 1));
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+      value = value.substr(1, value.size() - 2);
+    }
+    if (!name.empty()) {
+      cookies.add(name, value);
+    }
+  }
+}
+
+} // namespace server
+} // namespace http
@@ -0,0 +1,75 @@
+#ifndef HTTP_URL_DECODING_H
+#define HTTP_URL_DECODING_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace http {
+namespace server {
+
+// Appends the percent-decoded form of encoded to out. "%XX" with two hex
+// digits becomes that byte; a '%' not followed by two hex digits is kept as
+// it is. '+' becomes a space when plus_as_space is set, as in query strings
+// and form bodies, but not in paths.
+void url_decode(std::string_view encoded, std::string& out, bool plus_as_space = true);
+void url_decode(std::string_view encoded, std::pmr::string& out, bool plus_as_space = true);
+
+std::string url_decode(std::string_view encoded, bool plus_as_space = true);
+
+// The part of a request URI before the '?', and the part after it (empty if
+// there is no query)
+std::string_view uri_path(std::string_view uri);
+std::string_view uri_query(std::string_view uri);
+
+// Decoded name/value pairs in the order they appeared. Requests carry a
+// handful of them, so lookups scan rather than hash; a repeated name keeps
+// every value and find() returns the first.
+class parameter_map {
+public:
+  typedef std::pmr::polymorphic_allocator<char> allocator_type;
+  typedef std::pair<std::pmr::string, std::pmr::string> value_type;
+  typedef std::pmr::vector<value_type>::const_iterator const_iterator;
+
+  parameter_map() = default;
+  explicit parameter_map(const allocator_type& alloc) : entries_(alloc) {}
+
+  // The value of the first parameter named name, or nullptr
+  const std::pmr::string* find(std::string_view name) const;
+
+  // The value of the first parameter named name, or empty if there is none
+  std::string_view get(std::string_view name) const;
+
+  bool contains(std::string_view name) const { return find(name) != nullptr; }
+
+  std::size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+
+  // Appends a pair as given, without decoding; returns it so callers can
+  // decode into its strings
+  value_type& add(std::string_view name, std::string_view value);
+  void clear() { entries_.clear(); }
+
+private:
+  std::pmr::vector<value_type> entries_;
+};
+
+// Adds the pairs of an application/x-www-form-urlencoded string, such as a
+// query or a form body, to params: "a=1&b=x+y" gives a=1 and b="x y". A pair
+// without '=' has an empty value; empty pairs are skipped.
+void parse_query(std::string_view query, parameter_map& params);
+
+// Adds the pairs of a Cookie header value, "a=1; b=2", to cookies. Values
+// are taken as sent (cookies are not percent-encoded), less any surrounding
+// whitespace or double quotes.
+void parse_cookies(std::string_view cookie_header, parameter_map& cookies);
+
+} // namespace server
+} // namespace http
+
+#endif // HTTP_URL_DECODING_H